@@ -1,7 +1,10 @@
 #include "fileoperations.h"
 #include "strings.h"
-#include "replacefiledialog.h"
+#include "conflictdialog.h"
+#include "syncdialog.h"
 #include "pasteworker.h"
+#include "transferscheduler.h"
+#include "deviceinfo.h"
 #include "colors.h"
 #include <QDebug>
 #include <QDir>
@@ -11,6 +14,7 @@
 #include <QProcess>
 #include <QApplication>
 #include <QInputDialog>
+#include <QSettings>
 
 #ifdef Q_OS_WIN
 #include <shellapi.h>
@@ -25,6 +29,100 @@
 FileOperations::FileOperations(QObject *parent)
     : QObject(parent)
 {
+    // Прерванные задания продолжаем, когда главное окно уже готово показывать уведомления
+    QTimer::singleShot(RESUME_JOBS_DELAY_MS, this, &FileOperations::resumeInterruptedJobs);
+
+    TransferScheduler &scheduler = TransferScheduler::instance();
+    connect(&scheduler, &TransferScheduler::queueChanged, this, &FileOperations::onTransferQueueChanged);
+    connect(&scheduler, &TransferScheduler::jobStarted, this, [this](const QString &jobId) {
+        if (activeJobs.contains(jobId)) {
+            emit jobQueuedChanged(jobId, false);
+        }
+    });
+}
+
+void FileOperations::onTransferQueueChanged()
+{
+    // Ожидающим заданиям показываем их место в очереди
+    TransferScheduler &scheduler = TransferScheduler::instance();
+    const QStringList queued = scheduler.queuedJobs();
+    for (const QString &jobId : queued) {
+        if (!activeJobs.contains(jobId)) {
+            continue;
+        }
+        emit progressNotificationRequested(jobId, jobNames.value(jobId),
+                                           QString("В очереди: %1 из %2").arg(scheduler.queuePosition(jobId)).arg(queued.size()),
+                                           0);
+        emit jobQueuedChanged(jobId, true);
+    }
+}
+
+void FileOperations::resumeInterruptedJobs()
+{
+    const QStringList jobs = TransferJournal::pendingJobs();
+    for (const QString &jobId : jobs) {
+        if (activeJobs.contains(jobId)) {
+            continue;
+        }
+
+        TransferJournal::State state;
+        if (!TransferJournal::load(jobId, state)) {
+            // Журнал без плана продолжить нельзя
+            TransferJournal::discard(jobId);
+            continue;
+        }
+
+        QList<PasteWorker::PasteOperation> operations = PasteWorker::operationsFromJson(state.operations);
+        if (operations.isEmpty()) {
+            TransferJournal::discard(jobId);
+            continue;
+        }
+
+        qDebug() << "Resuming interrupted paste job:" << jobId << "finished files:" << state.finishedFiles.size();
+        emit progressNotificationRequested(jobId, state.title, "Продолжение прерванной операции...", 0);
+        runPasteJob(jobId, state.title, operations, &state);
+    }
+}
+
+void FileOperations::togglePauseJob(const QString &operationId)
+{
+    // Ожидающее в очереди задание и так ничего не делает
+    PasteWorker *worker = activeJobs.value(operationId);
+    if (!worker || TransferScheduler::instance().isQueued(operationId)) {
+        return;
+    }
+    if (worker->isPaused()) {
+        worker->resume();
+    } else {
+        worker->pause();
+    }
+}
+
+void FileOperations::cancelJob(const QString &operationId)
+{
+    PasteWorker *worker = activeJobs.value(operationId);
+    if (!worker) {
+        return;
+    }
+
+    // Задание еще в очереди - поток не запускался, просто убираем его
+    if (TransferScheduler::instance().remove(operationId)) {
+        qDebug() << "Queued paste job cancelled:" << operationId;
+        TransferJournal::discard(operationId);
+        emit finishProgressNotification(operationId, jobNames.value(operationId),
+                                        "Операция отменена пользователем", 1);
+        activeJobs.remove(operationId);
+        jobNames.remove(operationId);
+        worker->thread()->deleteLater();
+        worker->deleteLater();
+        return;
+    }
+    worker->cancel();
+}
+
+void FileOperations::prioritizeJob(const QString &operationId)
+{
+    TransferScheduler::instance().prioritize(operationId);
 }
 
 QString FileOperations::generateOperationId(const QString &operationName)
@@ -831,7 +929,7 @@ void FileOperations::cutFiles(const QStringList &files)
                                true, 3000);  // Автозакрытие через 3 секунды
 }
 
-void FileOperations::pasteFiles(const QString &destinationDir)
+void FileOperations::pasteFiles(const QString &destinationDir, bool verify, bool sync)
 {
     if (filesToPaste.isEmpty()) {
         qDebug() << "No files to paste";
@@ -842,102 +940,101 @@ void FileOperations::pasteFiles(const QString &destinationDir)
         return;
     }
 
+    QSettings settings;
+    bool deleteExtra = false;
+    bool compareContent = false;
+    if (sync) {
+        // Параметры показываются перед каждой синхронизацией и запоминаются
+        SyncDialog dialog(filesToPaste.size(), destinationDir,
+                          settings.value("transfer/syncDeleteExtra", false).toBool(),
+                          settings.value("transfer/syncCompareContent", false).toBool());
+        styleDialog(&dialog);
+        if (dialog.exec() != QDialog::Accepted) {
+            qDebug() << "Sync cancelled in options dialog";
+            return;
+        }
+        deleteExtra = dialog.deleteExtra();
+        compareContent = dialog.compareContent();
+        settings.setValue("transfer/syncDeleteExtra", deleteExtra);
+        settings.setValue("transfer/syncCompareContent", compareContent);
+
+        if (deleteExtra) {
+            QMessageBox *msgBox = createStyledMessageBox(nullptr, "Синхронизация",
+                QString("Файлы и папки в <b>%1</b>, которых нет в источнике, будут удалены "
+                        "(в корзину, а на дисках без корзины - безвозвратно).<br>Продолжить?")
+                    .arg(QDir::toNativeSeparators(destinationDir).toHtmlEscaped()),
+                QMessageBox::Warning);
+            msgBox->setStandardButtons(QMessageBox::Yes | QMessageBox::No);
+            msgBox->setDefaultButton(QMessageBox::No);
+            int answer = msgBox->exec();
+            msgBox->deleteLater();
+            if (answer != QMessageBox::Yes) {
+                qDebug() << "Sync with deletion not confirmed";
+                return;
+            }
+        }
+    }
+
+    // Синхронизация всегда копирует: источник остается эталоном для следующего раза
+    bool move = isCutOperation && !sync;
+
     // Генерируем ID операции
-    QString operationId = generateOperationId(isCutOperation ? "move" : "copy");
+    QString operationId = generateOperationId(sync ? "sync" : move ? "move" : "copy");
 
     // Показываем начальное уведомление
-    QString operationName = isCutOperation ? "Перемещение файлов" : "Копирование файлов";
+    QString operationName = sync ? "Синхронизация файлов" : move ? "Перемещение файлов" : "Копирование файлов";
     emit progressNotificationRequested(operationId, operationName,
-                                      QString("Подготовка к %1 %2 файлов...").arg(isCutOperation ? "перемещению" : "копированию").arg(filesToPaste.size()),
+                                      QString("Подготовка к %1 %2 файлов...")
+                                          .arg(sync ? "синхронизации" : move ? "перемещению" : "копированию")
+                                          .arg(filesToPaste.size()),
                                       0);
 
     qDebug() << "=== STARTING PASTE OPERATION ===";
     qDebug() << "Pasting" << filesToPaste.size() << "files to:" << destinationDir;
-    qDebug() << "Operation type:" << (isCutOperation ? "MOVE" : "COPY");
+    qDebug() << "Operation type:" << (sync ? "SYNC" : move ? "MOVE" : "COPY");
 
-    // Шаг 1: Проверяем все конфликты
-    QList<PasteWorker::PasteOperation> operations;
-    ReplaceFileDialog::Result lastDecision = ReplaceFileDialog::Replace;
-    bool applyToAll = false;
-    bool hasConflict = false;
+    verify = verify || settings.value("transfer/verifyCopies", false).toBool();
 
+    // Конфликты имен проверяет сам воркер: одно чтение папки назначения
+    // и один диалог на все задание, поэтому вставка начинается сразу
+    QList<PasteWorker::PasteOperation> operations;
     for (const QString &srcPath : filesToPaste) {
-        QFileInfo srcInfo(srcPath);
-        QString destPath = destinationDir + "/" + srcInfo.fileName();
-
         PasteWorker::PasteOperation op;
         op.sourcePath = srcPath;
-        op.destinationPath = destPath;
-        op.type = isCutOperation ? PasteWorker::Move : PasteWorker::Copy;
-
-        // Проверяем существование целевого файла
-        if (QFile::exists(destPath) && !applyToAll) {
-            qDebug() << "Target file exists, showing replace dialog";
-            hasConflict = true;
-
-            ReplaceFileDialog *dialog = new ReplaceFileDialog(srcInfo.fileName(), nullptr);
-            styleDialog(dialog);
-
-            if (dialog->exec() == QDialog::Accepted) {
-                lastDecision = dialog->getResult();
-                applyToAll = dialog->shouldApplyToAll();
-                qDebug() << "User decision:" << lastDecision << "apply to all:" << applyToAll;
-
-                switch (lastDecision) {
-                case ReplaceFileDialog::Skip:
-                    op.skip = true;
-                    break;
-
-                case ReplaceFileDialog::Copy:
-                    op.destinationPath = generateUniqueName(destinationDir, srcInfo.fileName());
-                    break;
-
-                case ReplaceFileDialog::Replace:
-                    op.replace = true;
-                    break;
-
-                case ReplaceFileDialog::Cancel:
-                    // Отменяем всю операцию
-                    operations.clear();
-                    break;
-                }
-            } else {
-                qDebug() << "User canceled replace dialog";
-                operations.clear();
-                dialog->deleteLater();
-                break;
-            }
-            dialog->deleteLater();
-        } else if (QFile::exists(destPath) && applyToAll) {
-            // Применяем предыдущее решение ко всем
-            if (lastDecision == ReplaceFileDialog::Copy) {
-                op.destinationPath = generateUniqueName(destinationDir, srcInfo.fileName());
-            } else if (lastDecision == ReplaceFileDialog::Skip) {
-                op.skip = true;
-            } else if (lastDecision == ReplaceFileDialog::Replace) {
-                op.replace = true;
-            }
-        }
-
-        // Если операция не была отменена, добавляем ее в список
-        if (lastDecision != ReplaceFileDialog::Cancel) {
-            operations.append(op);
-        } else {
-            break;
-        }
+        op.destinationPath = destinationDir + "/" + QFileInfo(srcPath).fileName();
+        op.type = move ? PasteWorker::Move : PasteWorker::Copy;
+        op.verify = verify;
+        op.sync = sync;
+        op.syncDeleteExtra = deleteExtra;
+        op.syncCompareContent = compareContent;
+        operations.append(op);
     }
 
-    if (operations.isEmpty() || (hasConflict && lastDecision == ReplaceFileDialog::Cancel)) {
-        emit finishProgressNotification(operationId, operationName,
-                                       "Операция отменена пользователем",
-                                       0);
-        return;
-    }
+    // Выполняем операции в отдельном потоке
+    runPasteJob(operationId, operationName, operations, nullptr);
+}
+
+void FileOperations::runPasteJob(const QString &operationId, const QString &operationName,
+                                 const QList<PasteWorker::PasteOperation> &operations,
+                                 const TransferJournal::State *resumeState)
+{
+    // Буфер обмена относится к текущей вставке, а не к продолженному заданию;
+    // синхронизация вырезанные файлы не перемещает - они остаются в буфере
+    bool clearCutOnFinish = !resumeState && !operations.first().sync;
 
-    // Шаг 2: Выполняем операции в отдельном потоке
     QThread *thread = new QThread();
     PasteWorker *worker = new PasteWorker();
+    if (resumeState) {
+        worker->setResumeState(*resumeState);
+    } else {
+        // Журнал пишется сразу: задание, ждущее своей очереди, тоже должно
+        // пережить закрытие программы
+        TransferJournal journal;
+        journal.create(operationId, operationName, PasteWorker::operationsToJson(operations));
+        worker->setJob(operationId, operationName);
+    }
     worker->moveToThread(thread);
+    activeJobs.insert(operationId, worker);
 
     // Подключаем сигналы и слоты
     connect(thread, &QThread::started, [worker, operations]() {
@@ -950,8 +1047,27 @@ void FileOperations::pasteFiles(const QString &destinationDir)
                                           currentFile, value);
     });
 
+    connect(worker, &PasteWorker::pausedChanged, this,
+            [this, operationId](bool paused) {
+        // Пока задание стоит, его тома достаются следующим в очереди
+        TransferScheduler::instance().setSuspended(operationId, paused);
+        emit jobPausedChanged(operationId, paused);
+    });
+
+    connect(worker, &PasteWorker::conflictsFound, this,
+            [this, operationId, worker](const QList<PasteWorker::Conflict> &conflicts) {
+        qDebug() << "Showing conflict summary for" << operationId << ":" << conflicts.size() << "items";
+        ConflictDialog dialog(conflicts);
+        styleDialog(&dialog);
+        if (dialog.exec() == QDialog::Accepted) {
+            worker->resolveConflicts(dialog.rules());
+        } else {
+            worker->cancel();
+        }
+    });
+
     connect(worker, &PasteWorker::adminRightsRequired, this,
-            [this, operationId, operationName, thread, worker, destinationDir]
+            [this, operationId, operationName, thread, worker, clearCutOnFinish]
             (const QList<PasteWorker::PasteOperation> &operations, const QStringList &/*errorFiles*/) {
 
         // Запрашиваем права администратора один раз для всех файлов
@@ -1000,7 +1116,7 @@ void FileOperations::pasteFiles(const QString &destinationDir)
                 emit requestRefresh();
 
                 // Очищаем операции cut после успешного выполнения
-                if (isCutOperation) {
+                if (isCutOperation && clearCutOnFinish) {
                     filesToPaste.clear();
                 }
             } else {
@@ -1022,6 +1138,9 @@ void FileOperations::pasteFiles(const QString &destinationDir)
         }
 
         // Очищаем память
+        activeJobs.remove(operationId);
+        jobNames.remove(operationId);
+        TransferScheduler::instance().finish(operationId);
         thread->quit();
         thread->wait();
         worker->deleteLater();
@@ -1029,7 +1148,7 @@ void FileOperations::pasteFiles(const QString &destinationDir)
     });
 
     connect(worker, &PasteWorker::operationCompleted, this,
-            [this, operationId, operationName, thread, worker, operations](bool success, const QString &message) {
+            [this, operationId, operationName, thread, worker, clearCutOnFinish](bool success, const QString &message) {
 
         if (success) {
             emit operationCompleted();
@@ -1043,11 +1162,14 @@ void FileOperations::pasteFiles(const QString &destinationDir)
         }
 
         // Очищаем операции cut после успешного выполнения
-        if (isCutOperation) {
+        if (isCutOperation && clearCutOnFinish) {
             filesToPaste.clear();
         }
 
         // Очищаем память
+        activeJobs.remove(operationId);
+        jobNames.remove(operationId);
+        TransferScheduler::instance().finish(operationId);
         thread->quit();
         thread->wait();
         worker->deleteLater();
@@ -1061,14 +1183,30 @@ void FileOperations::pasteFiles(const QString &destinationDir)
         QString errorMessage = "Ошибка при выполнении операции: " + error;
         emit finishProgressNotification(operationId, operationName, errorMessage, 2);
 
+        activeJobs.remove(operationId);
+        jobNames.remove(operationId);
+        TransferScheduler::instance().finish(operationId);
         thread->quit();
         thread->wait();
         worker->deleteLater();
         thread->deleteLater();
     });
 
-    // Запускаем поток
-    thread->start();
+    // Поток запустит планировщик, когда освободятся тома задания.
+    // Перемещение в пределах тома - переименования, тома оно не занимает
+    QStringList paths;
+    for (const PasteWorker::PasteOperation &op : operations) {
+        QString destinationDir = QFileInfo(op.destinationPath).absolutePath();
+        if (op.skip || (op.type == PasteWorker::Move && DeviceInfo::sameDevice(op.sourcePath, destinationDir))) {
+            continue;
+        }
+        paths << op.sourcePath << destinationDir;
+    }
+
+    jobNames.insert(operationId, operationName);
+    emit jobStarted(operationId);
+    TransferScheduler::instance().enqueue(operationId, TransferScheduler::devicesFor(paths),
+                                          [thread]() { thread->start(); });
 
     qDebug() << "=== PASTE OPERATION STARTED IN SEPARATE THREAD ===";
 }
@@ -1292,24 +1430,4 @@ void FileOperations::clearOperation()
     filesToPaste.clear();
     isCutOperation = false;
     qDebug() << "File operations cleared";
-}
-
-QString FileOperations::generateUniqueName(const QString &dir, const QString &fileName)
-{
-    QFileInfo fileInfo(fileName);
-    QString baseName = fileInfo.completeBaseName();
-    QString extension = fileInfo.suffix();
-    QString newName = fileName;
-
-    int counter = 1;
-    while (QFile::exists(dir + "/" + newName)) {
-        if (extension.isEmpty()) {
-            newName = QString("%1 (%2)").arg(baseName).arg(counter);
-        } else {
-            newName = QString("%1 (%2).%3").arg(baseName).arg(counter).arg(extension);
-        }
-        counter++;
-    }
-
-    return dir + "/" + newName;
 }
\ No newline at end of file
@@ -14,7 +14,9 @@
 #include <QDateTime>
 #include <QTimer>
 #include <QThread>
+#include <QHash>
 #include "pasteworker.h"
+#include "transferjournal.h"
 
 #ifdef Q_OS_WIN
 #include <windows.h>
@@ -36,7 +38,12 @@ public:
     void deleteFiles(const QStringList &files);
     void copyFiles(const QStringList &files);
     void cutFiles(const QStringList &files);
-    void pasteFiles(const QString &destinationDir);
+    // verify - сверять каждую копию с источником по контрольной сумме
+    // (всегда, если включена настройка transfer/verifyCopies)
+    // sync - копировать только новые и измененные файлы; перед запуском
+    // спрашивает, удалять ли лишнее в назначении и сравнивать ли содержимое
+    // (выбор хранится в transfer/syncDeleteExtra и transfer/syncCompareContent)
+    void pasteFiles(const QString &destinationDir, bool verify = false, bool sync = false);
     void renameFile(const QString &oldPath, const QString &newName);
     void undoDelete();
 
@@ -44,6 +51,12 @@ public:
     bool canUndo() const;
     void clearOperation();
 
+    // Управление идущими заданиями вставки
+    void togglePauseJob(const QString &operationId);
+    void cancelJob(const QString &operationId);
+    // Поставить ожидающее задание первым в очереди
+    void prioritizeJob(const QString &operationId);
+
 signals:
     void operationCompleted();
     void errorOccurred(const QString &message);
@@ -58,10 +71,25 @@ signals:
     void finishProgressNotification(const QString &operationId, const QString &title,
                                     const QString &message, int type);
 
+    // Задание вставки запущено и поддерживает паузу и отмену
+    void jobStarted(const QString &operationId);
+    void jobPausedChanged(const QString &operationId, bool paused);
+    // Задание ждет в очереди планировщика, пока заняты его тома
+    void jobQueuedChanged(const QString &operationId, bool queued);
+
+private slots:
+    // Задания, журналы которых остались после закрытия или падения
+    void resumeInterruptedJobs();
+    void onTransferQueueChanged();
+
 private:
+    // resumeState - состояние из журнала прерванного задания, nullptr для нового
+    void runPasteJob(const QString &operationId, const QString &operationName,
+                     const QList<PasteWorker::PasteOperation> &operations,
+                     const TransferJournal::State *resumeState);
+
     bool copyRecursive(const QString &src, const QString &dest);
     bool moveRecursive(const QString &src, const QString &dest);
-    QString generateUniqueName(const QString &dir, const QString &fileName);
 
     QString generateOperationId(const QString &operationName);
 
@@ -81,4 +109,8 @@ private:
     QStringList filesToPaste;
     bool isCutOperation = false;
     QStack<DeletedFile> deletedFilesStack;
+    QHash<QString, PasteWorker*> activeJobs;
+    QHash<QString, QString> jobNames;
+
+    const int RESUME_JOBS_DELAY_MS = 1000;
 };
\ No newline at end of file
@@ -45,13 +45,14 @@ void NotificationManager::showNotification(const QString &title, const QString &
 void NotificationManager::showProgressNotification(const QString &operationId, const QString &title,
                                                   const QString &message, int progress)
 {
-    // Закрываем предыдущее уведомление для этой операции, если оно есть
-    if (m_operationNotifications.contains(operationId)) {
-        NotificationWidget *oldNotification = m_operationNotifications[operationId];
-        if (oldNotification) {
-            oldNotification->close();
-            removeNotification(oldNotification);
-        }
+    // Уведомление операции уже показано - обновляем его: пересоздание
+    // сбрасывало бы кнопки управления и мигало при каждом отчете о прогрессе
+    NotificationWidget *existing = m_operationNotifications.value(operationId);
+    if (existing) {
+        existing->setTitle(title);
+        existing->setMessage(message);
+        existing->setProgress(progress);
+        return;
     }
 
     NotificationWidget *notification = new NotificationWidget(m_mainWindow);
@@ -68,6 +69,12 @@ void NotificationManager::showProgressNotification(const QString &operationId, c
                 m_operationNotifications.remove(operationId);
                 removeNotification(notification);
             });
+    connect(notification, &NotificationWidget::pauseRequested,
+            this, [this, operationId]() { emit pauseRequested(operationId); });
+    connect(notification, &NotificationWidget::cancelRequested,
+            this, [this, operationId]() { emit cancelRequested(operationId); });
+    connect(notification, &NotificationWidget::prioritizeRequested,
+            this, [this, operationId]() { emit prioritizeRequested(operationId); });
 
     m_notifications.append(notification);
     m_operationNotifications[operationId] = notification;
@@ -111,6 +118,30 @@ void NotificationManager::finishProgressNotification(const QString &operationId,
     }
 }
 
+void NotificationManager::enableProgressControls(const QString &operationId)
+{
+    NotificationWidget *notification = m_operationNotifications.value(operationId);
+    if (notification) {
+        notification->setControlsVisible(true);
+    }
+}
+
+void NotificationManager::setProgressPaused(const QString &operationId, bool paused)
+{
+    NotificationWidget *notification = m_operationNotifications.value(operationId);
+    if (notification) {
+        notification->setPaused(paused);
+    }
+}
+
+void NotificationManager::setProgressQueued(const QString &operationId, bool queued)
+{
+    NotificationWidget *notification = m_operationNotifications.value(operationId);
+    if (notification) {
+        notification->setQueued(queued);
+    }
+}
+
 void NotificationManager::closeAllNotifications()
 {
     for (NotificationWidget *notification : m_notifications) {
@@ -35,9 +35,19 @@ public:
     void finishProgressNotification(const QString &operationId, const QString &title,
                                    const QString &message, NotificationWidget::Type type);
 
+    // Кнопки паузы и отмены на уведомлении операции
+    void enableProgressControls(const QString &operationId);
+    void setProgressPaused(const QString &operationId, bool paused);
+    void setProgressQueued(const QString &operationId, bool queued);
+
     void closeAllNotifications();
     void closeNotificationByOperationId(const QString &operationId);
 
+signals:
+    void pauseRequested(const QString &operationId);
+    void cancelRequested(const QString &operationId);
+    void prioritizeRequested(const QString &operationId);
+
 private slots:
     void onNotificationClosed();
     void updatePositions();
@@ -0,0 +1,307 @@
+#include "animatedpreviews.h"
+#include <QImageReader>
+#include <QMovie>
+#include <QSettings>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <QDebug>
+
+namespace {
+    // Кольцевой буфер одной анимации: не больше стольких кадров и байт
+    constexpr int MAX_RING_FRAMES = 64;
+    constexpr qint64 MAX_RING_BYTES = 8LL * 1024 * 1024;
+    // Браузеры так же не дают кадрам с нулевой задержкой крутиться быстрее
+    constexpr int MIN_FRAME_DELAY_MS = 20;
+}
+
+class AnimatedPreviews::Animation
+{
+public:
+    Animation(AnimatedPreviews *owner, const QString& filePath, quint64 id)
+        : owner(owner)
+        , filePath(filePath)
+        , id(id)
+    {
+    }
+
+    ~Animation()
+    {
+        stopDecoder();
+        delete replayTimer;
+    }
+
+    // Проверка файла (imageCount читает GIF целиком) и декодирование кадров
+    // идут в потоке анимаций; сюда кадры приходят очередью через owner
+    void start(const QSize& frameSize)
+    {
+        decoder = new QObject();
+        decoder->moveToThread(owner->decodeThread);
+
+        AnimatedPreviews *previews = owner;
+        QObject *decoderObject = decoder;
+        const QString path = filePath;
+        const quint64 animationId = id;
+        QMetaObject::invokeMethod(decoder, [previews, decoderObject, path, animationId, frameSize]() {
+            QImageReader reader(path);
+            QSize sourceSize = reader.size();
+            if (!reader.supportsAnimation() || reader.imageCount() == 1 || !sourceSize.isValid()) {
+                previews->post(path, animationId, [](Animation *animation) { animation->onFailed(); });
+                return;
+            }
+
+            // Кадры сразу в размер миниатюры - полноразмерные кадры не храним
+            QSize fit = sourceSize;
+            if (fit.width() > frameSize.width() || fit.height() > frameSize.height()) {
+                fit = sourceSize.scaled(frameSize, Qt::KeepAspectRatio).expandedTo(QSize(1, 1));
+            }
+            const int frameCount = reader.imageCount();
+
+            QMovie *movie = new QMovie(path, reader.format(), decoderObject);
+            if (!movie->isValid()) {
+                previews->post(path, animationId, [](Animation *animation) { animation->onFailed(); });
+                return;
+            }
+            movie->setCacheMode(QMovie::CacheNone);
+            movie->setScaledSize(fit);
+
+            const qint64 frameBytes = qint64(fit.width()) * fit.height() * 4;
+            const int capacity = int(qBound<qint64>(1, MAX_RING_BYTES / frameBytes, MAX_RING_FRAMES));
+            previews->post(path, animationId, [frameCount, capacity](Animation *animation) {
+                animation->onStarted(frameCount, capacity);
+            });
+
+            QObject::connect(movie, &QMovie::frameChanged, decoderObject,
+                             [previews, movie, path, animationId](int frameNumber) {
+                const QImage frame = movie->currentImage();
+                const int delay = qMax(MIN_FRAME_DELAY_MS, movie->nextFrameDelay());
+                previews->post(path, animationId, [frame, frameNumber, delay](Animation *animation) {
+                    animation->onMovieFrame(frame, frameNumber, delay);
+                });
+            });
+            movie->start();
+        }, Qt::QueuedConnection);
+    }
+
+    void setPaused(bool paused)
+    {
+        if (decoder) {
+            QObject *decoderObject = decoder;
+            QMetaObject::invokeMethod(decoder, [decoderObject, paused]() {
+                QMovie *movie = decoderObject->findChild<QMovie*>();
+                if (movie) {
+                    movie->setPaused(paused);
+                }
+            }, Qt::QueuedConnection);
+        } else if (replayTimer) {
+            if (paused) {
+                replayTimer->stop();
+            } else if (!replayTimer->isActive()) {
+                replayTimer->start(ring[replayIndex].delay);
+            }
+        }
+    }
+
+    QPixmap currentFrame() const { return current; }
+    quint64 animationId() const { return id; }
+
+private:
+    struct Frame {
+        QPixmap pixmap;
+        int delay = 0;
+    };
+
+    // Декодер удаляется в своем потоке; кадры, которые он успел отправить,
+    // отбрасываются по идентификатору анимации
+    void stopDecoder()
+    {
+        if (decoder) {
+            decoder->deleteLater();
+            decoder = nullptr;
+        }
+    }
+
+    void onFailed()
+    {
+        owner->discard(filePath);
+    }
+
+    void onStarted(int count, int capacity)
+    {
+        frameCount = count;
+        ringCapacity = capacity;
+        ring.resize(ringCapacity);
+        qDebug() << "Animated preview started:" << filePath;
+    }
+
+    void onMovieFrame(const QImage& frame, int frameNumber, int delay)
+    {
+        if (!decoder) {
+            return; // Уже проигрываем из буфера
+        }
+
+        current = QPixmap::fromImage(frame);
+
+        Frame &slot = ring[ringHead];
+        slot.pixmap = current;
+        slot.delay = delay;
+        ringHead = (ringHead + 1) % ringCapacity;
+        ringSize = qMin(ringSize + 1, ringCapacity);
+
+        emit owner->frameChanged(filePath);
+
+        // Весь цикл поместился в буфер - декодер больше не нужен
+        if (frameCount > 1 && frameCount <= ringCapacity &&
+            frameNumber == frameCount - 1 && ringSize == frameCount) {
+            stopDecoder();
+
+            replayIndex = frameCount - 1;
+            replayTimer = new QTimer();
+            replayTimer->setSingleShot(true);
+            QObject::connect(replayTimer, &QTimer::timeout, replayTimer, [this]() { showNextCachedFrame(); });
+            if (!owner->paused) {
+                replayTimer->start(ring[replayIndex].delay);
+            }
+        }
+    }
+
+    void showNextCachedFrame()
+    {
+        replayIndex = (replayIndex + 1) % frameCount;
+        current = ring[replayIndex].pixmap;
+        emit owner->frameChanged(filePath);
+        replayTimer->start(ring[replayIndex].delay);
+    }
+
+    AnimatedPreviews *owner;
+    QString filePath;
+    quint64 id;
+    QObject *decoder = nullptr; // Живет в потоке анимаций, владеет QMovie
+    QTimer *replayTimer = nullptr;
+
+    QVector<Frame> ring;
+    int ringCapacity = 1;
+    int ringHead = 0;
+    int ringSize = 0;
+    int frameCount = 0; // 0 - обработчик не знает заранее
+    int replayIndex = 0;
+    QPixmap current;
+};
+
+AnimatedPreviews::AnimatedPreviews(QObject *parent)
+    : QObject(parent)
+    , decodeThread(new QThread(this))
+{
+    QSettings settings;
+    maxActiveCount = qMax(0, settings.value("thumbnailView/maxAnimatedPreviews", DEFAULT_MAX_ACTIVE).toInt());
+
+    decodeThread->setObjectName("AnimatedPreviews");
+    decodeThread->start(QThread::LowPriority);
+}
+
+AnimatedPreviews::~AnimatedPreviews()
+{
+    qDeleteAll(animations);
+    animations.clear();
+
+    // Декодеры, отложенно удаленные выше, поток удалит при завершении
+    decodeThread->quit();
+    decodeThread->wait();
+}
+
+bool AnimatedPreviews::isAnimatedSuffix(const QString& suffix)
+{
+    static const QStringList ANIMATED_SUFFIXES = {"gif", "webp"};
+    return ANIMATED_SUFFIXES.contains(suffix.toLower());
+}
+
+void AnimatedPreviews::post(const QString& filePath, quint64 id, std::function<void(Animation*)> handler)
+{
+    // Вызывается из потока анимаций; анимация к моменту доставки могла
+    // быть удалена или заменена новой для того же файла
+    QMetaObject::invokeMethod(this, [this, filePath, id, handler]() {
+        Animation *animation = animations.value(filePath);
+        if (animation && animation->animationId() == id) {
+            handler(animation);
+        }
+    }, Qt::QueuedConnection);
+}
+
+void AnimatedPreviews::discard(const QString& filePath)
+{
+    staticFiles.insert(filePath);
+    delete animations.take(filePath);
+}
+
+void AnimatedPreviews::setTargets(const QStringList& filePaths, const QSize& frameSize)
+{
+    // Размер миниатюр изменился - кадры в буферах больше не подходят
+    if (frameSize != currentFrameSize) {
+        qDeleteAll(animations);
+        animations.clear();
+        currentFrameSize = frameSize;
+    }
+
+    QStringList wanted = filePaths.mid(0, maxActiveCount);
+
+    for (auto it = animations.begin(); it != animations.end();) {
+        if (!wanted.contains(it.key())) {
+            QString filePath = it.key();
+            delete it.value();
+            it = animations.erase(it);
+            // Вернуть обычную миниатюру вместо последнего кадра
+            emit frameChanged(filePath);
+        } else {
+            ++it;
+        }
+    }
+
+    for (const QString& filePath : std::as_const(wanted)) {
+        if (animations.contains(filePath) || staticFiles.contains(filePath)) {
+            continue;
+        }
+
+        // Неанимированный файл отсеется в потоке анимаций и попадет в staticFiles
+        Animation *animation = new Animation(this, filePath, ++nextAnimationId);
+        animations.insert(filePath, animation);
+        animation->start(frameSize);
+        if (paused) {
+            animation->setPaused(true);
+        }
+    }
+}
+
+void AnimatedPreviews::setPaused(bool paused)
+{
+    if (this->paused == paused) {
+        return;
+    }
+    this->paused = paused;
+    for (Animation *animation : std::as_const(animations)) {
+        animation->setPaused(paused);
+    }
+}
+
+void AnimatedPreviews::clear()
+{
+    qDeleteAll(animations);
+    animations.clear();
+    staticFiles.clear();
+}
+
+void AnimatedPreviews::invalidate(const QStringList& filePaths)
+{
+    for (const QString& filePath : filePaths) {
+        staticFiles.remove(filePath);
+        if (Animation *animation = animations.take(filePath)) {
+            delete animation;
+            emit frameChanged(filePath);
+        }
+    }
+}
+
+QPixmap AnimatedPreviews::currentFrame(const QString& filePath) const
+{
+    Animation *animation = animations.value(filePath);
+    return animation ? animation->currentFrame() : QPixmap();
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QPixmap>
+#include <QSet>
+#include <QSize>
+#include <QStringList>
+#include <functional>
+
+class QThread;
+
+// Анимированные превью GIF/WebP в виде миниатюр. Анимируются только
+// элементы, на которые смотрит пользователь (под курсором и выделенные),
+// не больше заданного числа одновременно. Кадры декодируются по одному
+// в отдельном потоке сразу в размер миниатюры и хранятся в небольшом
+// кольцевом буфере: если весь цикл анимации в нем поместился, дальше он
+// проигрывается из буфера без повторного декодирования.
+class AnimatedPreviews : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AnimatedPreviews(QObject *parent = nullptr);
+    ~AnimatedPreviews();
+
+    // Форматы, которые Qt умеет анимировать (APNG обработчик PNG не поддерживает)
+    static bool isAnimatedSuffix(const QString& suffix);
+
+    // Файлы в порядке приоритета; анимируются первые maxActive из них
+    void setTargets(const QStringList& filePaths, const QSize& frameSize);
+    void setPaused(bool paused);
+    void clear();
+    // Файлы изменились на диске: забыть результат проверки и перезапустить анимации
+    void invalidate(const QStringList& filePaths);
+
+    int maxActive() const { return maxActiveCount; }
+
+    // Текущий кадр (в физических пикселях) или пустой QPixmap
+    QPixmap currentFrame(const QString& filePath) const;
+
+signals:
+    void frameChanged(const QString& filePath);
+
+private:
+    class Animation;
+
+    // Доставка результата из потока анимаций в поток интерфейса
+    void post(const QString& filePath, quint64 id, std::function<void(Animation*)> handler);
+    // Файл оказался неанимированным
+    void discard(const QString& filePath);
+
+    QThread *decodeThread;
+    quint64 nextAnimationId = 0;
+    QHash<QString, Animation*> animations;
+    QSet<QString> staticFiles; // Проверены и оказались неанимированными
+    QSize currentFrameSize;
+    bool paused = false;
+    int maxActiveCount;
+
+    const int DEFAULT_MAX_ACTIVE = 3;
+};
@@ -0,0 +1,342 @@
+#include "audiocoverart.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QtEndian>
+#include <QDebug>
+
+namespace {
+    // Ограничения на объем читаемых тегов и картинки
+    const qint64 MAX_TAG_BYTES = 16LL * 1024 * 1024;
+    const qint64 MAX_PICTURE_BYTES = 16LL * 1024 * 1024;
+    const int MAX_FLAC_BLOCKS = 128;
+    const int MAX_MP4_ATOMS = 4096;
+
+    // Тип картинки "передняя обложка" в ID3v2 и FLAC
+    const int FRONT_COVER = 3;
+
+    quint32 syncSafe(const uchar* data)
+    {
+        return (quint32(data[0] & 0x7F) << 21) | (quint32(data[1] & 0x7F) << 14) |
+               (quint32(data[2] & 0x7F) << 7) | quint32(data[3] & 0x7F);
+    }
+
+    // Снятие unsynchronisation: после 0xFF вставлялся лишний 0x00
+    QByteArray removeUnsync(const QByteArray& data)
+    {
+        QByteArray result;
+        result.reserve(data.size());
+        for (int i = 0; i < data.size(); ++i) {
+            result.append(data[i]);
+            if (uchar(data[i]) == 0xFF && i + 1 < data.size() && data[i + 1] == 0) {
+                ++i;
+            }
+        }
+        return result;
+    }
+
+    // Пропуск строки описания с учетом кодировки ID3 (0/3 - 1 байт на символ, 1/2 - UTF-16)
+    int skipEncodedString(const QByteArray& data, int pos, int encoding)
+    {
+        if (encoding == 1 || encoding == 2) {
+            while (pos + 1 < data.size() && (data[pos] != 0 || data[pos + 1] != 0)) {
+                pos += 2;
+            }
+            return pos + 2;
+        }
+        while (pos < data.size() && data[pos] != 0) {
+            ++pos;
+        }
+        return pos + 1;
+    }
+}
+
+const QStringList& AudioCoverArt::supportedSuffixes()
+{
+    static const QStringList suffixes = { "mp3", "flac", "m4a", "m4b" };
+    return suffixes;
+}
+
+bool AudioCoverArt::isAudioFile(const QString& filePath)
+{
+    return supportedSuffixes().contains(QFileInfo(filePath).suffix().toLower());
+}
+
+QByteArray AudioCoverArt::extract(const QString& filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+
+    // Формат определяем по заголовку, а не по расширению
+    QByteArray header = file.peek(12);
+    QByteArray picture;
+    if (header.startsWith("ID3")) {
+        picture = extractId3(file);
+        // FLAC иногда начинается с ID3-тега
+        if (picture.isEmpty() && QFileInfo(filePath).suffix().toLower() == "flac") {
+            picture = extractFlac(file);
+        }
+    } else if (header.startsWith("fLaC")) {
+        picture = extractFlac(file);
+    } else if (header.mid(4, 4) == "ftyp") {
+        picture = extractMp4(file);
+    }
+
+    if (picture.isEmpty()) {
+        qDebug() << "No embedded cover art in:" << filePath;
+    }
+    return picture;
+}
+
+QByteArray AudioCoverArt::extractId3(QFile& file)
+{
+    if (!file.seek(0)) {
+        return QByteArray();
+    }
+
+    QByteArray header = file.read(10);
+    if (header.size() < 10 || !header.startsWith("ID3")) {
+        return QByteArray();
+    }
+
+    const uchar* headerData = reinterpret_cast<const uchar*>(header.constData());
+    int version = headerData[3];
+    int flags = headerData[5];
+    qint64 tagSize = syncSafe(headerData + 6);
+    if (version < 2 || version > 4 || tagSize <= 0 || tagSize > MAX_TAG_BYTES) {
+        return QByteArray();
+    }
+
+    // Читаем только сам тег
+    QByteArray tag = file.read(tagSize);
+    if (version < 4 && (flags & 0x80)) {
+        tag = removeUnsync(tag);
+    }
+
+    int pos = 0;
+    // Расширенный заголовок
+    if (version >= 3 && (flags & 0x40) && tag.size() >= 4) {
+        const uchar* ext = reinterpret_cast<const uchar*>(tag.constData());
+        // Длину сравниваем без знака до сложения: иначе большое значение переполнит int
+        quint32 extSize = version == 4 ? syncSafe(ext) : qFromBigEndian<quint32>(ext);
+        if (version == 3 && extSize > quint32(tag.size() - 4)) {
+            return QByteArray();
+        }
+        if (version == 4 && extSize > quint32(tag.size())) {
+            return QByteArray();
+        }
+        pos = version == 4 ? int(extSize) : int(extSize) + 4;
+    }
+
+    const int idLength = version == 2 ? 3 : 4;
+    const int frameHeaderSize = version == 2 ? 6 : 10;
+    QByteArray firstPicture;
+
+    while (pos + frameHeaderSize <= tag.size()) {
+        const uchar* frame = reinterpret_cast<const uchar*>(tag.constData()) + pos;
+        if (frame[0] == 0) {
+            break; // Начались байты выравнивания
+        }
+
+        QByteArray id(reinterpret_cast<const char*>(frame), idLength);
+        qint64 frameSize;
+        int frameFlags = 0;
+        if (version == 2) {
+            frameSize = (qint64(frame[3]) << 16) | (qint64(frame[4]) << 8) | frame[5];
+        } else if (version == 3) {
+            frameSize = qFromBigEndian<quint32>(frame + 4);
+            frameFlags = (frame[8] << 8) | frame[9];
+        } else {
+            frameSize = syncSafe(frame + 4);
+            frameFlags = (frame[8] << 8) | frame[9];
+        }
+
+        int dataStart = pos + frameHeaderSize;
+        if (frameSize <= 0 || dataStart + frameSize > tag.size()) {
+            break;
+        }
+
+        if (id == "APIC" || id == "PIC") {
+            QByteArray body = tag.mid(dataStart, int(frameSize));
+
+            // ID3v2.4: флаги кадра - unsynchronisation и индикатор длины данных
+            if (version == 4) {
+                if (frameFlags & 0x0001) {
+                    body = body.mid(4);
+                }
+                if (frameFlags & 0x0002) {
+                    body = removeUnsync(body);
+                }
+            }
+
+            if (body.size() > 4) {
+                int encoding = uchar(body[0]);
+                int p = 1;
+                if (version == 2) {
+                    p += 3; // Формат изображения: три символа ("JPG", "PNG")
+                } else {
+                    while (p < body.size() && body[p] != 0) {
+                        ++p; // MIME-тип
+                    }
+                    ++p;
+                }
+
+                int pictureType = p < body.size() ? uchar(body[p]) : 0;
+                p = skipEncodedString(body, p + 1, encoding);
+
+                if (p < body.size() && body.size() - p <= MAX_PICTURE_BYTES) {
+                    QByteArray picture = body.mid(p);
+                    if (pictureType == FRONT_COVER) {
+                        return picture;
+                    }
+                    if (firstPicture.isEmpty()) {
+                        firstPicture = picture;
+                    }
+                }
+            }
+        }
+
+        pos = dataStart + int(frameSize);
+    }
+
+    return firstPicture;
+}
+
+QByteArray AudioCoverArt::extractFlac(QFile& file)
+{
+    // Пропускаем возможный ID3-тег перед потоком FLAC
+    qint64 position = 0;
+    if (!file.seek(0)) {
+        return QByteArray();
+    }
+    QByteArray id3Header = file.peek(10);
+    if (id3Header.size() == 10 && id3Header.startsWith("ID3")) {
+        position = 10 + syncSafe(reinterpret_cast<const uchar*>(id3Header.constData()) + 6);
+    }
+
+    if (!file.seek(position) || file.read(4) != "fLaC") {
+        return QByteArray();
+    }
+
+    QByteArray firstPicture;
+    for (int block = 0; block < MAX_FLAC_BLOCKS; ++block) {
+        QByteArray blockHeader = file.read(4);
+        if (blockHeader.size() < 4) {
+            break;
+        }
+
+        const uchar* headerData = reinterpret_cast<const uchar*>(blockHeader.constData());
+        bool last = headerData[0] & 0x80;
+        int type = headerData[0] & 0x7F;
+        qint64 length = (qint64(headerData[1]) << 16) | (qint64(headerData[2]) << 8) | headerData[3];
+
+        // 6 - METADATA_BLOCK_PICTURE; остальные блоки пропускаем без чтения
+        if (type == 6 && length <= MAX_PICTURE_BYTES + 1024) {
+            QByteArray body = file.read(length);
+            const uchar* data = reinterpret_cast<const uchar*>(body.constData());
+            int p = 0;
+            auto readUInt = [&](quint32& value) {
+                if (p + 4 > body.size()) {
+                    return false;
+                }
+                value = qFromBigEndian<quint32>(data + p);
+                p += 4;
+                return true;
+            };
+            // Длина поля сравнивается с остатком блока без знака, до сдвига позиции
+            auto skipBytes = [&](quint32 count) {
+                if (count > quint32(body.size() - p)) {
+                    return false;
+                }
+                p += int(count);
+                return true;
+            };
+
+            quint32 pictureType = 0, mimeLength = 0, descriptionLength = 0, skip = 0, dataLength = 0;
+            if (readUInt(pictureType) && readUInt(mimeLength) && skipBytes(mimeLength) &&
+                readUInt(descriptionLength) && skipBytes(descriptionLength) &&
+                readUInt(skip) && readUInt(skip) && readUInt(skip) && readUInt(skip) &&
+                readUInt(dataLength) && dataLength <= quint32(body.size() - p)) {
+                QByteArray picture = body.mid(p, int(dataLength));
+                if (int(pictureType) == FRONT_COVER) {
+                    return picture;
+                }
+                if (firstPicture.isEmpty()) {
+                    firstPicture = picture;
+                }
+            }
+        } else if (!file.seek(file.pos() + length)) {
+            break;
+        }
+
+        if (last) {
+            break;
+        }
+    }
+
+    return firstPicture;
+}
+
+bool AudioCoverArt::findMp4Atom(QFile& file, qint64 start, qint64 end, const QByteArray& type,
+                                qint64& payloadStart, qint64& payloadEnd)
+{
+    qint64 position = start;
+    for (int i = 0; i < MAX_MP4_ATOMS && position + 8 <= end; ++i) {
+        if (!file.seek(position)) {
+            return false;
+        }
+
+        // Читаем только заголовок атома; содержимое (в т.ч. mdat) пропускаем
+        QByteArray header = file.read(16);
+        if (header.size() < 8) {
+            return false;
+        }
+
+        const uchar* data = reinterpret_cast<const uchar*>(header.constData());
+        qint64 size = qFromBigEndian<quint32>(data);
+        qint64 headerSize = 8;
+        if (size == 1 && header.size() >= 16) {
+            size = qint64(qFromBigEndian<quint64>(data + 8));
+            headerSize = 16;
+        } else if (size == 0) {
+            size = end - position;
+        }
+
+        if (size < headerSize || position + size > end) {
+            return false;
+        }
+
+        if (header.mid(4, 4) == type) {
+            payloadStart = position + headerSize;
+            payloadEnd = position + size;
+            return true;
+        }
+        position += size;
+    }
+    return false;
+}
+
+QByteArray AudioCoverArt::extractMp4(QFile& file)
+{
+    qint64 start = 0, end = file.size();
+
+    // moov/udta/meta/ilst/covr/data
+    static const QList<QByteArray> path = { "moov", "udta", "meta", "ilst", "covr", "data" };
+    for (const QByteArray& type : path) {
+        if (!findMp4Atom(file, start, end, type, start, end)) {
+            return QByteArray();
+        }
+        // meta - "полный" атом: после заголовка 4 байта версии и флагов
+        if (type == "meta") {
+            start += 4;
+        }
+    }
+
+    // Атом data: 4 байта типа данных и 4 байта локали, затем само изображение
+    qint64 pictureSize = end - start - 8;
+    if (pictureSize <= 0 || pictureSize > MAX_PICTURE_BYTES || !file.seek(start + 8)) {
+        return QByteArray();
+    }
+    return file.read(pictureSize);
+}
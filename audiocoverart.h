@@ -0,0 +1,27 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+class QFile;
+
+// Чтение встроенной обложки из тегов аудиофайлов без разбора самого звука:
+// ID3v2 APIC/PIC (mp3), METADATA_BLOCK_PICTURE (flac), атом covr (m4a).
+// Читаются только области тегов, с ограничением объема.
+class AudioCoverArt
+{
+public:
+    static const QStringList& supportedSuffixes();
+    static bool isAudioFile(const QString& filePath);
+
+    // Данные изображения (JPEG/PNG) или пустой массив
+    static QByteArray extract(const QString& filePath);
+
+private:
+    static QByteArray extractId3(QFile& file);
+    static QByteArray extractFlac(QFile& file);
+    static QByteArray extractMp4(QFile& file);
+    static bool findMp4Atom(QFile& file, qint64 start, qint64 end, const QByteArray& type,
+                            qint64& payloadStart, qint64& payloadEnd);
+};
@@ -0,0 +1,155 @@
+#include "conflictdialog.h"
+#include "colors.h"
+#include "disksizeutils.h"
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QDebug>
+
+namespace {
+    const QString PATTERN_HINT = "{name} - имя без расширения, {n} - номер, {ext} - расширение с точкой";
+}
+
+ConflictDialog::ConflictDialog(const QList<PasteWorker::Conflict> &conflicts, QWidget *parent)
+    : QDialog(parent)
+{
+    setWindowTitle("Конфликты имен");
+    setModal(true);
+    setMinimumWidth(MIN_WIDTH);
+
+    int newer = 0;
+    int identical = 0;
+    for (const PasteWorker::Conflict &conflict : conflicts) {
+        if (conflict.identical()) {
+            identical++;
+        } else if (!conflict.isDir && conflict.sourceModified > conflict.destinationModified) {
+            newer++;
+        }
+    }
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+    mainLayout->setContentsMargins(PADDING * 2, PADDING * 2, PADDING * 2, PADDING * 2);
+    mainLayout->setSpacing(PADDING);
+
+    QLabel *messageLabel = new QLabel(
+        QString("В папке назначения уже есть <b>%1</b> из вставляемых элементов.<br>"
+                "Новее у источника: %2, одинаковых: %3")
+            .arg(conflicts.size()).arg(newer).arg(identical), this);
+    messageLabel->setWordWrap(true);
+    mainLayout->addWidget(messageLabel);
+
+    // Список - для ориентира, решение принимается правилами ниже
+    QListWidget *conflictList = new QListWidget(this);
+    conflictList->setFixedHeight(LIST_HEIGHT);
+    conflictList->setStyleSheet(
+        "QListWidget {"
+        "    background: " + Colors::DarkSecondary + ";"
+        "    color: " + Colors::TextLight + ";"
+        "    border: 1px solid " + Colors::DarkTertiary + ";"
+        "    border-radius: " + Colors::RadiusSmall + ";"
+        "}"
+    );
+    for (int i = 0; i < conflicts.size() && i < MAX_LISTED; ++i) {
+        const PasteWorker::Conflict &conflict = conflicts[i];
+        QString name = QFileInfo(conflict.destinationPath).fileName();
+        if (conflict.isDir) {
+            conflictList->addItem(name + "/  (папки будут объединены)");
+            continue;
+        }
+        QString state = conflict.identical() ? "одинаковые"
+                      : conflict.sourceModified > conflict.destinationModified ? "новее" : "старее";
+        conflictList->addItem(QString("%1  (%2 → %3, %4)")
+                                  .arg(name, DiskSizeUtils::formatSize(conflict.sourceSize),
+                                       DiskSizeUtils::formatSize(conflict.destinationSize), state));
+    }
+    if (conflicts.size() > MAX_LISTED) {
+        conflictList->addItem(QString("... и еще %1").arg(conflicts.size() - MAX_LISTED));
+    }
+    mainLayout->addWidget(conflictList);
+
+    QHBoxLayout *actionLayout = new QHBoxLayout();
+    actionLayout->addWidget(new QLabel("Действие:", this));
+    actionCombo = new QComboBox(this);
+    actionCombo->setStyleSheet(
+        "QComboBox, QComboBox QAbstractItemView {"
+        "    background: " + Colors::DarkTertiary + ";"
+        "    color: " + Colors::TextLight + ";"
+        "    border-radius: " + Colors::RadiusSmall + ";"
+        "    padding: 4px 8px;"
+        "}"
+    );
+    actionCombo->addItem("Заменить", PasteWorker::ReplaceExisting);
+    actionCombo->addItem("Пропустить", PasteWorker::SkipExisting);
+    actionCombo->addItem("Сохранить оба", PasteWorker::KeepBoth);
+    actionCombo->addItem("Заменить, если источник новее", PasteWorker::ReplaceIfNewer);
+    actionCombo->addItem("Заменить, если источник больше", PasteWorker::ReplaceIfLarger);
+    actionLayout->addWidget(actionCombo, 1);
+    mainLayout->addLayout(actionLayout);
+
+    QHBoxLayout *patternLayout = new QHBoxLayout();
+    patternLayout->addWidget(new QLabel("Новое имя:", this));
+    patternEdit = new QLineEdit(PasteWorker::ConflictRules().renamePattern, this);
+    patternEdit->setToolTip(PATTERN_HINT);
+    patternLayout->addWidget(patternEdit, 1);
+    mainLayout->addLayout(patternLayout);
+
+    skipIdenticalCheck = new QCheckBox("Пропускать одинаковые (совпадают размер и время изменения)", this);
+    skipIdenticalCheck->setChecked(true);
+    skipIdenticalCheck->setStyleSheet("QCheckBox { color: " + Colors::TextLight + "; background: transparent; }");
+    mainLayout->addWidget(skipIdenticalCheck);
+
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    continueButton = new QPushButton("Продолжить", this);
+    cancelButton = new QPushButton("Отмена", this);
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(continueButton);
+    buttonLayout->addWidget(cancelButton);
+    mainLayout->addLayout(buttonLayout);
+
+    connect(actionCombo, &QComboBox::currentIndexChanged, this, &ConflictDialog::onActionChanged);
+    connect(patternEdit, &QLineEdit::textChanged, this, &ConflictDialog::validatePattern);
+    connect(continueButton, &QPushButton::clicked, this, &QDialog::accept);
+    connect(cancelButton, &QPushButton::clicked, this, &QDialog::reject);
+
+    onActionChanged(actionCombo->currentIndex());
+    continueButton->setDefault(true);
+
+    qDebug() << "ConflictDialog created for" << conflicts.size() << "conflicts";
+}
+
+void ConflictDialog::onActionChanged(int index)
+{
+    Q_UNUSED(index)
+    patternEdit->setEnabled(actionCombo->currentData().toInt() == PasteWorker::KeepBoth);
+    validatePattern();
+}
+
+void ConflictDialog::validatePattern()
+{
+    // Пустой шаблон - значит шаблон по умолчанию; путь вместо имени не принимаем
+    QString pattern = patternEdit->text().trimmed();
+    bool valid = pattern.isEmpty() || PasteWorker::isValidRenamePattern(pattern);
+    bool used = actionCombo->currentData().toInt() == PasteWorker::KeepBoth;
+
+    patternEdit->setStyleSheet(valid ? QString() : "QLineEdit { border: 1px solid " + Colors::BorderRed + "; }");
+    patternEdit->setToolTip(valid ? PATTERN_HINT
+                                  : PATTERN_HINT + "\nИмя не может содержать / \\ : * ? \" < > | и \"..\"");
+    continueButton->setEnabled(valid || !used);
+}
+
+PasteWorker::ConflictRules ConflictDialog::rules() const
+{
+    PasteWorker::ConflictRules rules;
+    rules.action = static_cast<PasteWorker::ConflictAction>(actionCombo->currentData().toInt());
+    rules.skipIdentical = skipIdenticalCheck->isChecked();
+
+    // Без номера имена не будут уникальными - дописываем его
+    QString pattern = patternEdit->text().trimmed();
+    if (!pattern.isEmpty() && PasteWorker::isValidRenamePattern(pattern)) {
+        if (!pattern.contains("{n}")) {
+            pattern += " ({n})";
+        }
+        rules.renamePattern = pattern;
+    }
+    return rules;
+}
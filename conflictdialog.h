@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QDialog>
+#include <QCheckBox>
+#include <QComboBox>
+#include <QLabel>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QPushButton>
+#include "pasteworker.h"
+
+// Один диалог на все конфликты вставки: сводка по ним и правила, которые
+// воркер применяет к каждому конфликту сам (вместо окна на каждый файл)
+class ConflictDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    static constexpr int MIN_WIDTH = 460;
+    static constexpr int LIST_HEIGHT = 180;
+    static constexpr int MAX_LISTED = 200;
+    static constexpr int PADDING = 10;
+
+    explicit ConflictDialog(const QList<PasteWorker::Conflict> &conflicts, QWidget *parent = nullptr);
+
+    PasteWorker::ConflictRules rules() const;
+
+private slots:
+    void onActionChanged(int index);
+    void validatePattern();
+
+private:
+    QComboBox *actionCombo;
+    QCheckBox *skipIdenticalCheck;
+    QLineEdit *patternEdit;
+    QPushButton *continueButton;
+    QPushButton *cancelButton;
+};
@@ -0,0 +1,144 @@
+#include "contenthash.h"
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+    constexpr quint64 PRIME1 = 11400714785074694791ULL;
+    constexpr quint64 PRIME2 = 14029467366897019727ULL;
+    constexpr quint64 PRIME3 = 1609587929392839161ULL;
+    constexpr quint64 PRIME4 = 9650029242287828579ULL;
+    constexpr quint64 PRIME5 = 2870177450012600261ULL;
+
+    inline quint64 rotateLeft(quint64 value, int bits)
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    inline quint64 read64(const unsigned char* data)
+    {
+        return qFromLittleEndian<quint64>(data);
+    }
+
+    inline quint32 read32(const unsigned char* data)
+    {
+        return qFromLittleEndian<quint32>(data);
+    }
+
+    inline quint64 round(quint64 accumulator, quint64 input)
+    {
+        accumulator += input * PRIME2;
+        accumulator = rotateLeft(accumulator, 31);
+        return accumulator * PRIME1;
+    }
+
+    inline quint64 mergeRound(quint64 accumulator, quint64 value)
+    {
+        accumulator ^= round(0, value);
+        return accumulator * PRIME1 + PRIME4;
+    }
+}
+
+ContentHash::ContentHash(quint64 seedValue)
+    : seed(seedValue)
+{
+    reset();
+}
+
+void ContentHash::reset()
+{
+    accumulators[0] = seed + PRIME1 + PRIME2;
+    accumulators[1] = seed + PRIME2;
+    accumulators[2] = seed;
+    accumulators[3] = seed - PRIME1;
+    totalLength = 0;
+    buffered = 0;
+}
+
+void ContentHash::update(const char* data, qint64 size)
+{
+    const unsigned char* input = reinterpret_cast<const unsigned char*>(data);
+    const unsigned char* end = input + size;
+    totalLength += quint64(size);
+
+    // Хвост прошлого вызова дополняем до полной полосы в 32 байта
+    if (buffered > 0) {
+        int take = int(qMin<qint64>(32 - buffered, size));
+        std::memcpy(buffer + buffered, input, size_t(take));
+        buffered += take;
+        input += take;
+        if (buffered < 32) {
+            return;
+        }
+        for (int lane = 0; lane < 4; ++lane) {
+            accumulators[lane] = round(accumulators[lane], read64(buffer + lane * 8));
+        }
+        buffered = 0;
+    }
+
+    // Основной цикл: четыре независимых аккумулятора, процессор считает их параллельно
+    quint64 v1 = accumulators[0];
+    quint64 v2 = accumulators[1];
+    quint64 v3 = accumulators[2];
+    quint64 v4 = accumulators[3];
+    while (end - input >= 32) {
+        v1 = round(v1, read64(input));
+        v2 = round(v2, read64(input + 8));
+        v3 = round(v3, read64(input + 16));
+        v4 = round(v4, read64(input + 24));
+        input += 32;
+    }
+    accumulators[0] = v1;
+    accumulators[1] = v2;
+    accumulators[2] = v3;
+    accumulators[3] = v4;
+
+    if (input < end) {
+        buffered = int(end - input);
+        std::memcpy(buffer, input, size_t(buffered));
+    }
+}
+
+quint64 ContentHash::digest() const
+{
+    quint64 hash;
+    if (totalLength >= 32) {
+        hash = rotateLeft(accumulators[0], 1) + rotateLeft(accumulators[1], 7) +
+               rotateLeft(accumulators[2], 12) + rotateLeft(accumulators[3], 18);
+        for (quint64 accumulator : accumulators) {
+            hash = mergeRound(hash, accumulator);
+        }
+    } else {
+        hash = seed + PRIME5;
+    }
+    hash += totalLength;
+
+    const unsigned char* input = buffer;
+    const unsigned char* end = buffer + buffered;
+    while (end - input >= 8) {
+        hash ^= round(0, read64(input));
+        hash = rotateLeft(hash, 27) * PRIME1 + PRIME4;
+        input += 8;
+    }
+    if (end - input >= 4) {
+        hash ^= quint64(read32(input)) * PRIME1;
+        hash = rotateLeft(hash, 23) * PRIME2 + PRIME3;
+        input += 4;
+    }
+    while (input < end) {
+        hash ^= (*input) * PRIME5;
+        hash = rotateLeft(hash, 11) * PRIME1;
+        ++input;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+QString ContentHash::toHex(quint64 value)
+{
+    return QString("%1").arg(value, 16, 16, QChar('0'));
+}
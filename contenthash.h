@@ -0,0 +1,26 @@
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+
+// Потоковая контрольная сумма XXH64 для проверки копий. Не криптографическая:
+// защищает от порчи данных при записи и передаче, а не от подмены. Скалярная
+// реализация обрабатывает несколько ГБ/с на ядро - быстрее любого диска.
+class ContentHash
+{
+public:
+    explicit ContentHash(quint64 seed = 0);
+
+    void reset();
+    void update(const char* data, qint64 size);
+    quint64 digest() const;
+
+    static QString toHex(quint64 value);
+
+private:
+    quint64 seed;
+    quint64 accumulators[4];
+    quint64 totalLength = 0;
+    unsigned char buffer[32];
+    int buffered = 0;
+};
@@ -187,6 +187,8 @@ void ContextMenu::setupActions()
     cutAction = addAction(Strings::Cut);
     copyAction = addAction(Strings::Copy);
     pasteAction = addAction(Strings::Paste);
+    pasteVerifiedAction = addAction(Strings::PasteVerified);
+    pasteSyncAction = addAction(Strings::PasteSync);
     addSeparator();
     renameAction = addAction(Strings::Rename);
 
@@ -266,6 +268,8 @@ void ContextMenu::setupActions()
     connect(cutAction, &QAction::triggered, this, &ContextMenu::cut);
     connect(copyAction, &QAction::triggered, this, &ContextMenu::copy);
     connect(pasteAction, &QAction::triggered, this, &ContextMenu::paste);
+    connect(pasteVerifiedAction, &QAction::triggered, this, &ContextMenu::pasteVerified);
+    connect(pasteSyncAction, &QAction::triggered, this, &ContextMenu::pasteSync);
     connect(renameAction, &QAction::triggered, this, &ContextMenu::rename);
     connect(deleteAction, &QAction::triggered, this, &ContextMenu::deleteFile);
     connect(newFolderAction, &QAction::triggered, this, &ContextMenu::newFolder);
@@ -574,6 +578,8 @@ void ContextMenu::setSelection(const QModelIndexList &indexes, const QString &cu
     } else {
         pasteAction->setEnabled(false);
     }
+    pasteVerifiedAction->setEnabled(pasteAction->isEnabled());
+    pasteSyncAction->setEnabled(pasteAction->isEnabled());
 
     // Для "Open" меняем текст в зависимости от типа
     if (singleSelection) {
@@ -1484,6 +1490,26 @@ void ContextMenu::paste()
     fileOperations->pasteFiles(currentDirectory);
 }
 
+void ContextMenu::pasteVerified()
+{
+    if (!fileOperations) {
+        qDebug() << "Paste: fileOperations not set";
+        return;
+    }
+    // Каждый файл после копирования перечитывается с диска и сверяется с источником
+    fileOperations->pasteFiles(currentDirectory, true);
+}
+
+void ContextMenu::pasteSync()
+{
+    if (!fileOperations) {
+        qDebug() << "Paste: fileOperations not set";
+        return;
+    }
+    // Копируются только новые и измененные файлы, совпадающие пропускаются
+    fileOperations->pasteFiles(currentDirectory, false, true);
+}
+
 void ContextMenu::rename()
 {
     if (selectedIndexes.size() != 1) {
@@ -41,6 +41,8 @@ private slots:
     void cut();
     void copy();
     void paste();
+    void pasteVerified();
+    void pasteSync();
     void rename();
     void deleteFile();
     void newFolder();
@@ -92,6 +94,8 @@ private:
     QAction *cutAction;
     QAction *copyAction;
     QAction *pasteAction;
+    QAction *pasteVerifiedAction;
+    QAction *pasteSyncAction;
     QAction *renameAction;
     QAction *deleteAction;
     QAction *newFolderAction;
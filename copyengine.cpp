@@ -0,0 +1,1085 @@
+#include "copyengine.h"
+#include "contenthash.h"
+#include <QFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QSet>
+#include <QDebug>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <winioctl.h>
+#include <io.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#endif
+
+#ifdef Q_OS_LINUX
+#include <linux/falloc.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#endif
+
+namespace {
+    // Буфер для докопирования и для проверки копии. Кратен размеру сектора:
+    // чтение без кэша на Windows принимает только такие
+    constexpr int STREAM_BUFFER_SIZE = 1024 * 1024;
+
+    // Копирование через QFile с хэшированием прочитанного; false - ошибка или отмена
+    bool copyStream(QFile& source, QFile& destination, qint64& copied, const CopyEngine::ProgressCallback& progress,
+                    ContentHash* hash, QString& error)
+    {
+        QByteArray buffer(STREAM_BUFFER_SIZE, Qt::Uninitialized);
+        for (;;) {
+            qint64 n = source.read(buffer.data(), buffer.size());
+            if (n < 0) {
+                error = source.errorString();
+                return false;
+            }
+            if (n == 0) {
+                return true;
+            }
+            if (hash) {
+                hash->update(buffer.constData(), n);
+            }
+            if (destination.write(buffer.constData(), n) != n) {
+                error = destination.errorString();
+                return false;
+            }
+            copied += n;
+            if (progress && !progress(n)) {
+                error = "Cancelled";
+                return false;
+            }
+        }
+    }
+
+    // Данные файла - на диск, иначе перечитывание покажет содержимое кэша
+    void flushToDisk(QFile& file)
+    {
+        file.flush();
+#ifdef Q_OS_WIN
+        FlushFileBuffers(reinterpret_cast<HANDLE>(_get_osfhandle(file.handle())));
+#elif defined(Q_OS_LINUX)
+        ::fdatasync(file.handle());
+#else
+        ::fsync(file.handle());
+#endif
+    }
+
+    // Перечитывание файла с диска в обход кэша страниц
+    bool readBackUncached(const QString& path, ContentHash& hash, const CopyEngine::ProgressCallback& progress,
+                          QString& error)
+    {
+#ifdef Q_OS_WIN
+        std::wstring nativePath = QDir::toNativeSeparators(path).toStdWString();
+        HANDLE file = CreateFileW(nativePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_FLAG_NO_BUFFERING | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            error = qt_error_string(int(GetLastError()));
+            return false;
+        }
+
+        // Без буферизации адрес буфера должен быть выровнен по сектору - берем страницы
+        char* buffer = static_cast<char*>(VirtualAlloc(nullptr, STREAM_BUFFER_SIZE, MEM_COMMIT | MEM_RESERVE,
+                                                       PAGE_READWRITE));
+        bool ok = buffer != nullptr;
+        while (ok) {
+            DWORD n = 0;
+            if (!ReadFile(file, buffer, STREAM_BUFFER_SIZE, &n, nullptr)) {
+                error = qt_error_string(int(GetLastError()));
+                ok = false;
+                break;
+            }
+            if (n == 0) {
+                break;
+            }
+            hash.update(buffer, n);
+            if (progress && !progress(0)) {
+                error = "Cancelled";
+                ok = false;
+            }
+        }
+
+        if (buffer) {
+            VirtualFree(buffer, 0, MEM_RELEASE);
+        }
+        CloseHandle(file);
+        return ok;
+#else
+        int file = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+        if (file < 0) {
+            error = qt_error_string(errno);
+            return false;
+        }
+
+#ifdef Q_OS_LINUX
+        // Грязные страницы сбрасываются на диск, чистые выбрасываются из кэша -
+        // чтение ниже пойдет с устройства
+        ::fdatasync(file);
+        ::posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED);
+#elif defined(Q_OS_MACOS)
+        ::fsync(file);
+        ::fcntl(file, F_NOCACHE, 1);
+#endif
+
+        std::vector<char> buffer(STREAM_BUFFER_SIZE);
+        bool ok = true;
+        for (;;) {
+            ssize_t n = ::read(file, buffer.data(), buffer.size());
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                error = qt_error_string(errno);
+                ok = false;
+                break;
+            }
+            if (n == 0) {
+                break;
+            }
+            hash.update(buffer.data(), n);
+            // Объем уже учтен при копировании - только пауза и отмена
+            if (progress && !progress(0)) {
+                error = "Cancelled";
+                ok = false;
+                break;
+            }
+        }
+        ::close(file);
+        return ok;
+#endif
+    }
+
+    // Обычное чтение через кэш: без сброса на диск и с разделяемым доступом,
+    // файл может быть открыт другой программой
+    bool readCached(const QString& path, ContentHash& hash, const CopyEngine::ProgressCallback& progress,
+                    QString& error)
+    {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+            error = file.errorString();
+            return false;
+        }
+
+        QByteArray buffer(STREAM_BUFFER_SIZE, Qt::Uninitialized);
+        for (;;) {
+            qint64 n = file.read(buffer.data(), buffer.size());
+            if (n < 0) {
+                error = file.errorString();
+                return false;
+            }
+            if (n == 0) {
+                return true;
+            }
+            hash.update(buffer.constData(), n);
+            if (progress && !progress(0)) {
+                error = "Cancelled";
+                return false;
+            }
+        }
+    }
+
+    // Сравнение перечитанной копии с хэшем источника; при несовпадении копия удаляется
+    bool verifyCopy(const QString& destinationPath, const ContentHash& sourceHash,
+                    const CopyEngine::ProgressCallback& progress, CopyEngine::Result& result)
+    {
+        result.checksum = sourceHash.digest();
+
+        ContentHash destinationHash;
+        if (!readBackUncached(destinationPath, destinationHash, progress, result.error)) {
+            QFile::remove(destinationPath);
+            return false;
+        }
+
+        if (destinationHash.digest() != result.checksum) {
+            qDebug() << "Checksum mismatch:" << destinationPath << ContentHash::toHex(result.checksum)
+                     << "!=" << ContentHash::toHex(destinationHash.digest());
+            result.mismatch = true;
+            result.error = "Checksum mismatch";
+            QFile::remove(destinationPath);
+            return false;
+        }
+
+        result.verified = true;
+        return true;
+    }
+
+#ifndef Q_OS_WIN
+    // Буфер для копирования через процесс
+    constexpr size_t READ_WRITE_BUFFER = 1024 * 1024;
+#endif
+
+    // Меньшие файлы не проверяем на дыры и не размещаем заранее: выигрыша нет
+    constexpr qint64 SPARSE_MIN_SIZE = 1024 * 1024;
+    constexpr qint64 PREALLOCATE_MIN_SIZE = 1024 * 1024;
+
+#ifdef Q_OS_LINUX
+    // Порция для copy_file_range/sendfile: ядро копирует ее за один вызов,
+    // между порциями - отчет о прогрессе
+    constexpr size_t KERNEL_COPY_CHUNK = 16 * 1024 * 1024;
+
+    // Эти ошибки в самом начале означают "способ не поддерживается для этой
+    // пары файлов" - пробуем следующий
+    bool isUnsupported(int error)
+    {
+        return error == EXDEV || error == ENOSYS || error == EOPNOTSUPP ||
+               error == EINVAL || error == EBADF || error == EPERM;
+    }
+
+    // 1 - скопировано, 0 - способ не подошел (ничего не записано), -1 - ошибка или отмена.
+    // expectedSize - размер источника по fstat
+    int copyWithKernel(int source, int destination, bool useSendFile, qint64 expectedSize, qint64 &copied,
+                       const CopyEngine::ProgressCallback& progress)
+    {
+        for (;;) {
+            ssize_t n = useSendFile
+                ? ::sendfile(destination, source, nullptr, KERNEL_COPY_CHUNK)
+                : ::copy_file_range(source, nullptr, destination, nullptr, KERNEL_COPY_CHUNK, 0);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return (copied == 0 && isUnsupported(errno)) ? 0 : -1;
+            }
+            if (n == 0) {
+                // Файлы procfs/sysfs/FUSE сообщают размер, но ядру отдают пустоту -
+                // их читаем через буфер. Источник, укоротившийся на ходу, - ошибка,
+                // а не молча обрезанная копия
+                if (copied == 0) {
+                    return 0;
+                }
+                if (copied < expectedSize) {
+                    errno = EIO;
+                    return -1;
+                }
+                return 1;
+            }
+            copied += n;
+            if (progress && !progress(n)) {
+                errno = ECANCELED;
+                return -1;
+            }
+        }
+    }
+#endif
+
+#ifndef Q_OS_WIN
+    bool writeAll(int fd, const char *data, size_t size)
+    {
+        while (size > 0) {
+            ssize_t n = ::write(fd, data, size);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            data += n;
+            size -= size_t(n);
+        }
+        return true;
+    }
+
+    bool copyWithBuffer(int source, int destination, qint64 &copied, const CopyEngine::ProgressCallback& progress,
+                        ContentHash* hash)
+    {
+        std::vector<char> buffer(READ_WRITE_BUFFER);
+        for (;;) {
+            ssize_t n = ::read(source, buffer.data(), buffer.size());
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            if (n == 0) {
+                return true;
+            }
+            if (hash) {
+                hash->update(buffer.data(), n);
+            }
+            if (!writeAll(destination, buffer.data(), size_t(n))) {
+                return false;
+            }
+            copied += n;
+            if (progress && !progress(n)) {
+                errno = ECANCELED;
+                return false;
+            }
+        }
+    }
+
+#ifdef SEEK_HOLE
+    bool writeAllAt(int fd, const char *data, size_t size, off_t offset)
+    {
+        while (size > 0) {
+            ssize_t n = ::pwrite(fd, data, size, offset);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            data += n;
+            size -= size_t(n);
+            offset += n;
+        }
+        return true;
+    }
+
+    // Блоков выделено заметно меньше размера - в файле есть дыры
+    bool isSparse(const struct stat &info)
+    {
+        return info.st_size >= SPARSE_MIN_SIZE && qint64(info.st_blocks) * 512 < info.st_size;
+    }
+
+    // Дыры в хэш входят как нули: сумма считается по содержимому, а не по размещению
+    void hashZeros(ContentHash &hash, qint64 size)
+    {
+        static const std::vector<char> zeros(READ_WRITE_BUFFER, 0);
+        while (size > 0) {
+            qint64 n = qMin<qint64>(size, qint64(zeros.size()));
+            hash.update(zeros.data(), n);
+            size -= n;
+        }
+    }
+
+    // Копирование только участков с данными (SEEK_DATA/SEEK_HOLE); дыры
+    // остаются дырами, размер задает ftruncate. Дыры засчитываются в прогресс,
+    // но не в copied. 1 - скопировано, 0 - ФС не умеет искать дыры, -1 - ошибка
+    int copySparse(int source, int destination, off_t size, qint64 &copied,
+                   const CopyEngine::ProgressCallback& progress, ContentHash* hash)
+    {
+        std::vector<char> buffer(READ_WRITE_BUFFER);
+        off_t position = 0;
+        while (position < size) {
+            off_t dataStart = ::lseek(source, position, SEEK_DATA);
+            if (dataStart < 0) {
+                if (errno != ENXIO) {
+                    return (position == 0 && (errno == EINVAL || errno == EOPNOTSUPP)) ? 0 : -1;
+                }
+                // Дальше данных нет - до конца файла дыра
+                dataStart = size;
+            }
+            dataStart = qMin(dataStart, size);
+
+            off_t dataEnd = size;
+            if (dataStart < size) {
+                dataEnd = ::lseek(source, dataStart, SEEK_HOLE);
+                if (dataEnd < 0) {
+                    return -1;
+                }
+                dataEnd = qMin(dataEnd, size);
+            }
+
+            if (dataStart > position) {
+                qint64 hole = dataStart - position;
+                if (hash) {
+                    hashZeros(*hash, hole);
+                }
+                if (progress && !progress(hole)) {
+                    errno = ECANCELED;
+                    return -1;
+                }
+            }
+
+            for (off_t offset = dataStart; offset < dataEnd;) {
+                size_t chunk = size_t(qMin<off_t>(off_t(buffer.size()), dataEnd - offset));
+                ssize_t n = ::pread(source, buffer.data(), chunk, offset);
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return -1;
+                }
+                if (n == 0) {
+                    // Файл укоротили во время копирования
+                    dataEnd = offset;
+                    size = offset;
+                    break;
+                }
+                if (hash) {
+                    hash->update(buffer.data(), n);
+                }
+                if (!writeAllAt(destination, buffer.data(), size_t(n), offset)) {
+                    return -1;
+                }
+                offset += n;
+                copied += n;
+                if (progress && !progress(n)) {
+                    errno = ECANCELED;
+                    return -1;
+                }
+            }
+            position = dataEnd;
+        }
+
+        // Хвостовая дыра - только размер, без записи данных
+        return ::ftruncate(destination, size) == 0 ? 1 : -1;
+    }
+#endif
+#endif
+
+#ifdef Q_OS_WIN
+    // Разреженный файл NTFS/ReFS: назначение помечается разреженным, получает
+    // полный размер (целиком дыра), и поверх пишутся только выделенные участки
+    // источника. false - ошибка или отмена (текст в result.error); unsupported -
+    // том назначения (FAT32, exFAT) разреженных файлов не знает, ничего не скопировано
+    bool copySparseFile(const std::wstring &sourcePath, const std::wstring &destinationPath, DWORD attributes,
+                        const CopyEngine::ProgressCallback& progress, CopyEngine::Result &result,
+                        bool &unsupported)
+    {
+        unsupported = false;
+        HANDLE source = CreateFileW(sourcePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                    FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (source == INVALID_HANDLE_VALUE) {
+            result.error = qt_error_string(int(GetLastError()));
+            return false;
+        }
+        HANDLE destination = CreateFileW(destinationPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                                         FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (destination == INVALID_HANDLE_VALUE) {
+            result.error = qt_error_string(int(GetLastError()));
+            CloseHandle(source);
+            return false;
+        }
+
+        LARGE_INTEGER size = {};
+        DWORD returned = 0;
+        FILE_END_OF_FILE_INFO endOfFile = {};
+        bool ok = GetFileSizeEx(source, &size);
+        if (ok && !DeviceIoControl(destination, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &returned, nullptr)) {
+            DWORD lastError = GetLastError();
+            if (lastError == ERROR_INVALID_FUNCTION || lastError == ERROR_NOT_SUPPORTED) {
+                CloseHandle(destination);
+                CloseHandle(source);
+                DeleteFileW(destinationPath.c_str());
+                unsupported = true;
+                return false;
+            }
+            SetLastError(lastError);
+            ok = false;
+        }
+        if (ok) {
+            endOfFile.EndOfFile = size;
+            ok = SetFileInformationByHandle(destination, FileEndOfFileInfo, &endOfFile, sizeof(endOfFile));
+        }
+        if (!ok) {
+            result.error = qt_error_string(int(GetLastError()));
+        }
+
+        std::vector<char> buffer(STREAM_BUFFER_SIZE);
+        FILE_ALLOCATED_RANGE_BUFFER query = {};
+        query.Length = size;
+        FILE_ALLOCATED_RANGE_BUFFER ranges[64];
+        qint64 position = 0;
+
+        while (ok && position < size.QuadPart) {
+            BOOL complete = DeviceIoControl(source, FSCTL_QUERY_ALLOCATED_RANGES, &query, sizeof(query),
+                                            ranges, sizeof(ranges), &returned, nullptr);
+            if (!complete && GetLastError() != ERROR_MORE_DATA) {
+                result.error = qt_error_string(int(GetLastError()));
+                ok = false;
+                break;
+            }
+
+            int count = int(returned / sizeof(FILE_ALLOCATED_RANGE_BUFFER));
+            for (int i = 0; ok && i < count; ++i) {
+                qint64 start = ranges[i].FileOffset.QuadPart;
+                qint64 end = start + ranges[i].Length.QuadPart;
+                if (start > position && progress && !progress(start - position)) {
+                    result.error = "Cancelled";
+                    ok = false;
+                    break;
+                }
+
+                LARGE_INTEGER offset;
+                offset.QuadPart = start;
+                ok = SetFilePointerEx(source, offset, nullptr, FILE_BEGIN) &&
+                     SetFilePointerEx(destination, offset, nullptr, FILE_BEGIN);
+                for (qint64 done = start; ok && done < end;) {
+                    DWORD chunk = DWORD(qMin<qint64>(qint64(buffer.size()), end - done));
+                    DWORD read = 0;
+                    DWORD written = 0;
+                    ok = ReadFile(source, buffer.data(), chunk, &read, nullptr) && read > 0 &&
+                         WriteFile(destination, buffer.data(), read, &written, nullptr) && written == read;
+                    if (!ok) {
+                        result.error = qt_error_string(int(GetLastError()));
+                        break;
+                    }
+                    done += read;
+                    result.bytesCopied += read;
+                    if (progress && !progress(read)) {
+                        result.error = "Cancelled";
+                        ok = false;
+                    }
+                }
+                position = end;
+            }
+
+            if (complete || count == 0) {
+                break;
+            }
+            // Участки не поместились в ответ - запрашиваем остаток
+            query.FileOffset.QuadPart = position;
+            query.Length.QuadPart = size.QuadPart - position;
+        }
+
+        if (ok && size.QuadPart > position && progress && !progress(size.QuadPart - position)) {
+            result.error = "Cancelled";
+            ok = false;
+        }
+
+        // Время и атрибуты - как у источника, как делает CopyFileExW
+        FILETIME created, accessed, modified;
+        if (ok && GetFileTime(source, &created, &accessed, &modified)) {
+            SetFileTime(destination, &created, &accessed, &modified);
+        }
+        CloseHandle(destination);
+        CloseHandle(source);
+
+        if (!ok) {
+            DeleteFileW(destinationPath.c_str());
+            return false;
+        }
+        SetFileAttributesW(destinationPath.c_str(), attributes & ~FILE_ATTRIBUTE_SPARSE_FILE);
+        return true;
+    }
+#endif
+
+#ifdef Q_OS_WIN
+    struct CopyProgressContext {
+        const CopyEngine::ProgressCallback *progress;
+        qint64 reported = 0;
+    };
+
+    DWORD CALLBACK copyProgressRoutine(LARGE_INTEGER, LARGE_INTEGER transferred, LARGE_INTEGER, LARGE_INTEGER,
+                                       DWORD, DWORD, HANDLE, HANDLE, LPVOID data)
+    {
+        // Система сообщает накопленный объем - передаем приращение
+        CopyProgressContext *context = static_cast<CopyProgressContext*>(data);
+        qint64 delta = transferred.QuadPart - context->reported;
+        context->reported = transferred.QuadPart;
+        if (delta > 0 && !(*context->progress)(delta)) {
+            return PROGRESS_CANCEL;
+        }
+        return PROGRESS_CONTINUE;
+    }
+#endif
+}
+
+CopyEngine::Result CopyEngine::copyFile(const QString& sourcePath, const QString& destinationPath,
+                                        const ProgressCallback& progress, bool verify)
+{
+    Result result;
+    ContentHash sourceHash;
+
+#ifdef Q_OS_WIN
+    // CopyFileExW данные процессу не показывает - для проверки копируем сами
+    if (verify) {
+        QFile source(sourcePath);
+        QFile destination(destinationPath);
+        if (!source.open(QIODevice::ReadOnly)) {
+            result.error = source.errorString();
+            return result;
+        }
+        if (!destination.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            result.error = destination.errorString();
+            return result;
+        }
+
+        if (!copyStream(source, destination, result.bytesCopied, progress, &sourceHash, result.error)) {
+            destination.close();
+            QFile::remove(destinationPath);
+            return result;
+        }
+        destination.setFileTime(QFileInfo(source).lastModified(), QFileDevice::FileModificationTime);
+        flushToDisk(destination);
+        destination.close();
+        destination.setPermissions(source.permissions());
+
+        if (!verifyCopy(destinationPath, sourceHash, progress, result)) {
+            return result;
+        }
+        result.success = true;
+        result.method = ReadWrite;
+        return result;
+    }
+
+    std::wstring source = QDir::toNativeSeparators(sourcePath).toStdWString();
+    std::wstring destination = QDir::toNativeSeparators(destinationPath).toStdWString();
+
+    // CopyFileExW разворачивает дыры в нули - разреженные файлы копируем по участкам.
+    // Если том назначения их не поддерживает, копия будет обычной, с нулями
+    DWORD attributes = GetFileAttributesW(source.c_str());
+    if (attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_SPARSE_FILE)) {
+        bool unsupported = false;
+        if (copySparseFile(source, destination, attributes, progress, result, unsupported)) {
+            result.success = true;
+            result.method = Sparse;
+            return result;
+        }
+        if (!unsupported) {
+            return result;
+        }
+        qDebug() << "Destination does not support sparse files, copying densely:" << destinationPath;
+    }
+
+    // Большие файлы - без системного кэша, чтобы не вытеснять из него все остальное
+    DWORD flags = 0;
+    if (QFileInfo(sourcePath).size() > 256LL * 1024 * 1024) {
+        flags |= COPY_FILE_NO_BUFFERING;
+    }
+
+    CopyProgressContext context{&progress};
+    if (!CopyFileExW(source.c_str(), destination.c_str(), progress ? copyProgressRoutine : nullptr,
+                     &context, nullptr, flags)) {
+        result.error = qt_error_string(int(GetLastError()));
+        DeleteFileW(destination.c_str());
+        return result;
+    }
+
+    result.success = true;
+    result.method = SystemCopy;
+    result.bytesCopied = QFileInfo(destinationPath).size();
+    return result;
+#else
+    // Открытие FIFO на чтение ждет писателя бесконечно, открытие устройства
+    // может иметь побочные эффекты - отсеиваем их до open. O_NONBLOCK - на
+    // случай, если файл подменили между stat и open
+    const QByteArray sourceName = QFile::encodeName(sourcePath);
+    struct stat sourceStat;
+    if (::stat(sourceName.constData(), &sourceStat) != 0) {
+        result.error = qt_error_string(errno);
+        return result;
+    }
+    if (!S_ISREG(sourceStat.st_mode)) {
+        result.error = "Not a regular file";
+        return result;
+    }
+
+    int source = ::open(sourceName.constData(), O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+    if (source < 0) {
+        result.error = qt_error_string(errno);
+        return result;
+    }
+    if (::fstat(source, &sourceStat) != 0) {
+        result.error = qt_error_string(errno);
+        ::close(source);
+        return result;
+    }
+    if (!S_ISREG(sourceStat.st_mode)) {
+        result.error = "Not a regular file";
+        ::close(source);
+        return result;
+    }
+    ::fcntl(source, F_SETFL, ::fcntl(source, F_GETFL) & ~O_NONBLOCK);
+
+    const QByteArray destinationName = QFile::encodeName(destinationPath);
+    int destination = ::open(destinationName.constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                             sourceStat.st_mode & 0777);
+    if (destination < 0) {
+        result.error = qt_error_string(errno);
+        ::close(source);
+        return result;
+    }
+
+    bool ok = false;
+
+#ifdef Q_OS_LINUX
+    // Reflink: на btrfs/XFS/bcachefs файл любого размера "копируется" мгновенно
+    if (::ioctl(destination, FICLONE, source) == 0) {
+        ok = true;
+        result.method = Clone;
+        result.bytesCopied = sourceStat.st_size;
+        // Блоки общие с источником - сравнивать нечего, копия совпадает по построению
+        result.verified = verify;
+        if (progress && !progress(sourceStat.st_size)) {
+            ok = false;
+            result.error = qt_error_string(ECANCELED);
+        }
+    }
+#endif
+
+#ifdef SEEK_HOLE
+    // Разреженный файл: переносим только данные, дыры воспроизводим
+    if (!ok && result.error.isEmpty() && isSparse(sourceStat)) {
+        int status = copySparse(source, destination, sourceStat.st_size, result.bytesCopied, progress,
+                                verify ? &sourceHash : nullptr);
+        if (status == 1) {
+            ok = true;
+            result.method = Sparse;
+        } else if (status < 0) {
+            result.error = qt_error_string(errno);
+        }
+    }
+#endif
+
+#ifdef Q_OS_LINUX
+    // Место под обычный большой файл выделяем сразу одним куском. KEEP_SIZE:
+    // размер растет по мере записи; ФС без поддержки просто возвращают ошибку
+    if (!ok && result.error.isEmpty() && sourceStat.st_size >= PREALLOCATE_MIN_SIZE) {
+        ::fallocate(destination, FALLOC_FL_KEEP_SIZE, 0, sourceStat.st_size);
+    }
+
+    // Псевдофайлы с нулевым размером ядро копировать не умеет - сразу через буфер.
+    // Для проверки данные должны пройти через процесс - тоже через буфер
+    if (!ok && result.error.isEmpty() && sourceStat.st_size > 0 && !verify) {
+        int status = copyWithKernel(source, destination, false, sourceStat.st_size, result.bytesCopied, progress);
+        if (status == 0) {
+            status = copyWithKernel(source, destination, true, sourceStat.st_size, result.bytesCopied, progress);
+            if (status == 1) {
+                result.method = SendFile;
+            }
+        } else if (status == 1) {
+            result.method = CopyFileRange;
+        }
+
+        if (status == 1) {
+            ok = true;
+        } else if (status < 0) {
+            result.error = qt_error_string(errno);
+        }
+    }
+#endif
+
+    if (!ok && result.error.isEmpty()) {
+#ifdef Q_OS_LINUX
+        ::posix_fadvise(source, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        ok = copyWithBuffer(source, destination, result.bytesCopied, progress, verify ? &sourceHash : nullptr);
+        if (ok) {
+            result.method = ReadWrite;
+        } else {
+            result.error = qt_error_string(errno);
+        }
+    }
+
+    if (ok) {
+        // Права и время изменения - как у источника
+        ::fchmod(destination, sourceStat.st_mode & 07777);
+#if defined(Q_OS_MACOS)
+        struct timespec times[2] = {sourceStat.st_atimespec, sourceStat.st_mtimespec};
+#else
+        struct timespec times[2] = {sourceStat.st_atim, sourceStat.st_mtim};
+#endif
+        ::futimens(destination, times);
+    }
+
+    if (::close(destination) != 0 && ok) {
+        ok = false;
+        result.error = qt_error_string(errno);
+    }
+    ::close(source);
+
+    if (!ok) {
+        ::unlink(destinationName.constData());
+        return result;
+    }
+
+    if (verify && !result.verified && !verifyCopy(destinationPath, sourceHash, progress, result)) {
+        return result;
+    }
+
+    result.success = true;
+    return result;
+#endif
+}
+
+CopyEngine::Result CopyEngine::resumeFile(const QString& sourcePath, const QString& destinationPath, qint64 offset,
+                                          const ProgressCallback& progress, bool verify)
+{
+    Result result;
+
+    QFile source(sourcePath);
+    QFile destination(destinationPath);
+    if (!source.open(QIODevice::ReadOnly)) {
+        result.error = source.errorString();
+        return result;
+    }
+    // Недописанного хвоста нет или файл изменился - копируем заново
+    if (offset <= 0 || offset > source.size() || QFileInfo(destinationPath).size() < offset) {
+        source.close();
+        return copyFile(sourcePath, destinationPath, progress, verify);
+    }
+
+    // Контрольная сумма считается по всему источнику, включая уже скопированную часть
+    ContentHash sourceHash;
+    if (verify) {
+        QByteArray buffer(STREAM_BUFFER_SIZE, Qt::Uninitialized);
+        for (qint64 hashed = 0; hashed < offset;) {
+            qint64 n = source.read(buffer.data(), qMin<qint64>(buffer.size(), offset - hashed));
+            if (n <= 0) {
+                result.error = source.errorString();
+                return result;
+            }
+            sourceHash.update(buffer.constData(), n);
+            hashed += n;
+        }
+    }
+
+    if (!destination.open(QIODevice::ReadWrite) || !destination.resize(offset) ||
+        !source.seek(offset) || !destination.seek(offset)) {
+        result.error = destination.errorString();
+        return result;
+    }
+
+    // При ошибке или отмене недописанный файл оставляем - его можно будет продолжить еще раз
+    if (!copyStream(source, destination, result.bytesCopied, progress, verify ? &sourceHash : nullptr,
+                    result.error)) {
+        return result;
+    }
+
+    // Права и время изменения - как у источника, как и при обычном копировании
+    destination.setFileTime(QFileInfo(source).lastModified(), QFileDevice::FileModificationTime);
+    destination.setPermissions(source.permissions());
+    if (verify) {
+        flushToDisk(destination);
+    }
+    destination.close();
+
+    if (verify && !verifyCopy(destinationPath, sourceHash, progress, result)) {
+        return result;
+    }
+
+    result.success = true;
+    result.method = ReadWrite;
+    return result;
+}
+
+CopyEngine::RenameStatus CopyEngine::rename(const QString& sourcePath, const QString& destinationPath,
+                                            QString *error)
+{
+#ifdef Q_OS_WIN
+    std::wstring source = QDir::toNativeSeparators(sourcePath).toStdWString();
+    std::wstring destination = QDir::toNativeSeparators(destinationPath).toStdWString();
+
+    // Без MOVEFILE_COPY_ALLOWED система не копирует между томами сама
+    if (MoveFileExW(source.c_str(), destination.c_str(), 0)) {
+        return Renamed;
+    }
+    DWORD lastError = GetLastError();
+    if (error) {
+        *error = qt_error_string(int(lastError));
+    }
+    return lastError == ERROR_NOT_SAME_DEVICE ? CrossDevice : RenameFailed;
+#else
+    const QByteArray sourceName = QFile::encodeName(sourcePath);
+    const QByteArray destinationName = QFile::encodeName(destinationPath);
+
+#if defined(Q_OS_LINUX) && defined(SYS_renameat2)
+    // Ядро само отказывает, если назначение есть: между проверкой и rename
+    // его никто не успеет создать. Через syscall - старые glibc обертки не имеют
+    if (::syscall(SYS_renameat2, AT_FDCWD, sourceName.constData(), AT_FDCWD, destinationName.constData(),
+                  RENAME_NOREPLACE) == 0) {
+        return Renamed;
+    }
+    if (errno != EINVAL && errno != ENOSYS) {
+        int lastError = errno;
+        if (error) {
+            *error = qt_error_string(lastError);
+        }
+        return lastError == EXDEV ? CrossDevice : RenameFailed;
+    }
+    // Ядро до 3.15 или ФС без RENAME_NOREPLACE - проверяем сами
+#endif
+
+    // POSIX rename молча заменяет существующий файл - проверяем заранее
+    struct stat destinationStat;
+    if (::lstat(destinationName.constData(), &destinationStat) == 0) {
+        if (error) {
+            *error = qt_error_string(EEXIST);
+        }
+        return RenameFailed;
+    }
+
+    if (::rename(sourceName.constData(), destinationName.constData()) == 0) {
+        return Renamed;
+    }
+    int lastError = errno;
+    if (error) {
+        *error = qt_error_string(lastError);
+    }
+    return lastError == EXDEV ? CrossDevice : RenameFailed;
+#endif
+}
+
+bool CopyEngine::flushFile(const QString& path, QString *error)
+{
+#ifdef Q_OS_WIN
+    // FlushFileBuffers сбрасывает кэш файла целиком, через любой дескриптор
+    // с правом записи данных; файл в это время может быть открыт копированием
+    std::wstring nativePath = QDir::toNativeSeparators(path).toStdWString();
+
+    // CopyFileExW переносит атрибут "только чтение", а с ним файл на запись
+    // не открыть - снимаем атрибут на время сброса
+    DWORD attributes = GetFileAttributesW(nativePath.c_str());
+    const bool readOnly = attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_READONLY);
+    if (readOnly) {
+        SetFileAttributesW(nativePath.c_str(), attributes & ~FILE_ATTRIBUTE_READONLY);
+    }
+
+    HANDLE file = CreateFileW(nativePath.c_str(), FILE_WRITE_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    bool ok = file != INVALID_HANDLE_VALUE;
+    DWORD lastError = ok ? ERROR_SUCCESS : GetLastError();
+    if (ok) {
+        ok = FlushFileBuffers(file);
+        if (!ok) {
+            lastError = GetLastError();
+        }
+        CloseHandle(file);
+    }
+
+    if (readOnly) {
+        SetFileAttributesW(nativePath.c_str(), attributes);
+    }
+    if (!ok && error) {
+        *error = qt_error_string(int(lastError));
+    }
+    return ok;
+#else
+    // fsync действует на файл, а не на дескриптор: хватает открытия на чтение
+    // (права назначения уже могли стать только для чтения)
+    int file = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+    if (file < 0) {
+        if (error) {
+            *error = qt_error_string(errno);
+        }
+        return false;
+    }
+#ifdef Q_OS_LINUX
+    bool ok = ::fdatasync(file) == 0;
+#else
+    bool ok = ::fsync(file) == 0;
+#endif
+    if (!ok && error) {
+        *error = qt_error_string(errno);
+    }
+    ::close(file);
+    return ok;
+#endif
+}
+
+QStringList CopyEngine::flushFiles(const QStringList& paths)
+{
+    QStringList failed;
+#ifdef Q_OS_LINUX
+    // syncfs сбрасывает все записанное на файловую систему к моменту вызова,
+    // поэтому для остальных файлов пачки на том же устройстве она уже сделана
+    QSet<quint64> syncedDevices;
+    for (const QString& path : paths) {
+        int file = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+        struct stat fileStat;
+        bool ok = file >= 0 && ::fstat(file, &fileStat) == 0;
+        if (ok && !syncedDevices.contains(quint64(fileStat.st_dev))) {
+            ok = ::syncfs(file) == 0;
+            if (ok) {
+                syncedDevices.insert(quint64(fileStat.st_dev));
+            }
+        }
+        if (file >= 0) {
+            ::close(file);
+        }
+        if (!ok) {
+            qDebug() << "Cannot flush file:" << path << qt_error_string(errno);
+            failed.append(path);
+        }
+    }
+#else
+    for (const QString& path : paths) {
+        QString error;
+        if (!flushFile(path, &error)) {
+            qDebug() << "Cannot flush file:" << path << error;
+            failed.append(path);
+        }
+    }
+#endif
+    return failed;
+}
+
+bool CopyEngine::copySymLink(const QString& sourcePath, const QString& destinationPath, QString *error)
+{
+#ifdef Q_OS_WIN
+    QFileInfo sourceInfo(sourcePath);
+    std::wstring target = QDir::toNativeSeparators(sourceInfo.readSymLink()).toStdWString();
+    std::wstring destination = QDir::toNativeSeparators(destinationPath).toStdWString();
+
+    // Без режима разработчика ссылку можно создать только с правами администратора
+    DWORD flags = SYMBOLIC_LINK_FLAG_ALLOW_UNPRIVILEGED_CREATE;
+    if (sourceInfo.isDir()) {
+        flags |= SYMBOLIC_LINK_FLAG_DIRECTORY;
+    }
+    if (CreateSymbolicLinkW(destination.c_str(), target.c_str(), flags)) {
+        return true;
+    }
+    if (error) {
+        *error = qt_error_string(int(GetLastError()));
+    }
+    return false;
+#else
+    // Цель читаем как есть: symLinkTarget вернул бы абсолютный путь
+    std::vector<char> target(4096);
+    for (;;) {
+        ssize_t length = ::readlink(QFile::encodeName(sourcePath).constData(), target.data(), target.size());
+        if (length < 0) {
+            if (error) {
+                *error = qt_error_string(errno);
+            }
+            return false;
+        }
+        if (size_t(length) < target.size()) {
+            target[size_t(length)] = '\0';
+            break;
+        }
+        target.resize(target.size() * 2);
+    }
+
+    if (::symlink(target.data(), QFile::encodeName(destinationPath).constData()) == 0) {
+        return true;
+    }
+    if (error) {
+        *error = qt_error_string(errno);
+    }
+    return false;
+#endif
+}
+
+bool CopyEngine::checksum(const QString& path, quint64& checksum, ChecksumRead read,
+                          const ProgressCallback& progress, QString *error)
+{
+    ContentHash hash;
+    QString readError;
+    bool ok = read == FromDisk ? readBackUncached(path, hash, progress, readError)
+                               : readCached(path, hash, progress, readError);
+    if (!ok) {
+        qDebug() << "Checksum failed:" << path << readError;
+        if (error) {
+            *error = readError;
+        }
+        return false;
+    }
+    checksum = hash.digest();
+    return true;
+}
+
+const char* CopyEngine::methodName(Method method)
+{
+    switch (method) {
+    case Clone:         return "reflink";
+    case CopyFileRange: return "copy_file_range";
+    case SendFile:      return "sendfile";
+    case ReadWrite:     return "read/write";
+    case SystemCopy:    return "CopyFileEx";
+    case Sparse:        return "sparse";
+    case None:          break;
+    }
+    return "none";
+}
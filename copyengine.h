@@ -0,0 +1,91 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+// Копирование одного файла самым дешевым способом, доступным для конкретной
+// пары источник/назначение. Способ выбирается для каждого файла заново:
+//   Linux:   reflink (FICLONE) -> copy_file_range -> sendfile -> чтение/запись
+//   Windows: CopyFileExW (на ReFS и Dev Drive система сама клонирует блоки)
+//   прочие:  чтение/запись большими блоками
+// Разреженные файлы (образы ВМ, базы данных) копируются по участкам с
+// данными, дыры воспроизводятся, а не заполняются нулями. Под обычные
+// большие файлы место на Linux выделяется заранее (fallocate), чтобы
+// назначение не дробилось на фрагменты.
+// Время изменения и права доступа переносятся с источника, как у CopyFile.
+//
+// Режим проверки: данные идут через буфер процесса, источник хэшируется
+// (XXH64) прямо при копировании и читается один раз, затем назначение
+// сбрасывается на диск и перечитывается в обход кэша страниц.
+class CopyEngine
+{
+public:
+    enum Method {
+        None,
+        Clone,          // Блоки общие с источником, данные не копируются
+        CopyFileRange,  // Копирование внутри ядра
+        SendFile,       // Копирование внутри ядра (старые ядра, разные ФС)
+        ReadWrite,      // Через буфер процесса
+        SystemCopy,     // CopyFileExW
+        Sparse          // Только участки с данными, дыры воспроизведены
+    };
+
+    enum RenameStatus {
+        Renamed,
+        CrossDevice,    // Источник и назначение на разных томах - нужно копирование
+        RenameFailed
+    };
+
+    // Вызывается по мере копирования с числом новых скопированных байт;
+    // false - прервать копирование
+    using ProgressCallback = std::function<bool(qint64 bytes)>;
+
+    struct Result {
+        bool success = false;
+        Method method = None;
+        qint64 bytesCopied = 0;
+        QString error;
+        bool verified = false;  // Копия проверена по контрольной сумме
+        bool mismatch = false;  // Перечитанная копия не совпала с источником
+        quint64 checksum = 0;   // XXH64 источника (только в режиме проверки)
+    };
+
+    // Существующий файл назначения перезаписывается; при ошибке, отмене или
+    // несовпадении контрольной суммы недописанный файл удаляется
+    static Result copyFile(const QString& sourcePath, const QString& destinationPath,
+                           const ProgressCallback& progress = ProgressCallback(), bool verify = false);
+
+    // Докопирование файла, прерванного на offset байт: назначение обрезается
+    // до offset, и копирование продолжается с этого места
+    static Result resumeFile(const QString& sourcePath, const QString& destinationPath, qint64 offset,
+                             const ProgressCallback& progress = ProgressCallback(), bool verify = false);
+
+    // Атомарное переименование файла или папки без копирования данных.
+    // Существующее назначение не заменяется
+    static RenameStatus rename(const QString& sourcePath, const QString& destinationPath,
+                               QString *error = nullptr);
+
+    // Сброс данных уже записанного файла на диск (fdatasync/FlushFileBuffers) -
+    // перед тем как отметить в журнале, что файл скопирован
+    static bool flushFile(const QString& path, QString *error = nullptr);
+    // То же для пачки файлов; на Linux - одна syncfs на файловую систему
+    // вместо fdatasync на каждый файл. Возвращает файлы, которые сбросить не удалось
+    static QStringList flushFiles(const QStringList& paths);
+
+    // Создает в назначении такую же символическую ссылку (цель не копируется,
+    // относительная цель остается относительной)
+    static bool copySymLink(const QString& sourcePath, const QString& destinationPath,
+                            QString *error = nullptr);
+
+    enum ChecksumRead {
+        FromDisk,   // В обход кэша страниц: проверяется то, что реально лежит на диске
+        Cached      // Обычное чтение: источник, который копирование не трогало
+    };
+
+    // XXH64 файла - сверка уже лежащей копии с источником без повторного копирования
+    static bool checksum(const QString& path, quint64& checksum, ChecksumRead read = FromDisk,
+                         const ProgressCallback& progress = ProgressCallback(), QString *error = nullptr);
+
+    static const char* methodName(Method method);
+};
@@ -0,0 +1,201 @@
+#include "decodebufferpool.h"
+#include "thumbnailmemorycache.h"
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QSettings>
+#include <cstdlib>
+#include <limits>
+
+namespace {
+    // Маленькие буферы malloc отдает быстро - их не держим
+    constexpr qint64 MIN_POOLED_BYTES = 256 * 1024;
+    // Сколько свободной памяти может лежать в арене одного потока; сверх того
+    // все свободные буферы вместе учитываются в бюджете ThumbnailMemoryCache
+    constexpr qint64 MAX_IDLE_BYTES_PER_ARENA = 48LL * 1024 * 1024;
+}
+
+std::atomic<int> DecodeBufferPool::enabledState{-1};
+std::atomic<quint64> DecodeBufferPool::hitCount{0};
+std::atomic<quint64> DecodeBufferPool::missCount{0};
+std::atomic<qint64> DecodeBufferPool::idleBytes{0};
+std::atomic<qint64> DecodeBufferPool::peakIdleBytes{0};
+
+struct DecodeBufferPool::Buffer
+{
+    uchar *data = nullptr;
+    int sizeClass = 0;
+    // Пока буфер занят, он держит свою арену: поток может завершиться раньше,
+    // чем последний QImage на этой памяти
+    std::shared_ptr<Arena> arena;
+};
+
+class DecodeBufferPool::Arena
+{
+public:
+    ~Arena()
+    {
+        for (const QList<Buffer*>& buffers : std::as_const(freeLists)) {
+            for (Buffer *buffer : buffers) {
+                DecodeBufferPool::idleBytes -= classBytes(buffer->sizeClass);
+                ThumbnailMemoryCache::instance().releasePooled(classBytes(buffer->sizeClass));
+                std::free(buffer->data);
+                delete buffer;
+            }
+        }
+    }
+
+    Buffer* take(int sizeClass)
+    {
+        Buffer *buffer = nullptr;
+        {
+            QMutexLocker locker(&mutex);
+            auto it = freeLists.find(sizeClass);
+            if (it == freeLists.end() || it->isEmpty()) {
+                return nullptr;
+            }
+            buffer = it->takeLast();
+            arenaIdleBytes -= classBytes(sizeClass);
+            DecodeBufferPool::idleBytes -= classBytes(sizeClass);
+        }
+        // Занятый буфер учитывается резервированием декодирования
+        ThumbnailMemoryCache::instance().releasePooled(classBytes(sizeClass));
+        return buffer;
+    }
+
+    // false - арена заполнена или в бюджете памяти нет места, буфер нужно освободить
+    bool give(Buffer *buffer)
+    {
+        const qint64 bytes = classBytes(buffer->sizeClass);
+
+        // Бюджет спрашиваем без мьютекса арены: кэш миниатюр берет свой
+        ThumbnailMemoryCache &memoryCache = ThumbnailMemoryCache::instance();
+        if (!memoryCache.reservePooled(bytes)) {
+            return false;
+        }
+
+        QMutexLocker locker(&mutex);
+        if (arenaIdleBytes + bytes > MAX_IDLE_BYTES_PER_ARENA) {
+            locker.unlock();
+            memoryCache.releasePooled(bytes);
+            return false;
+        }
+        freeLists[buffer->sizeClass].append(buffer);
+        arenaIdleBytes += bytes;
+
+        qint64 total = DecodeBufferPool::idleBytes += bytes;
+        qint64 peak = DecodeBufferPool::peakIdleBytes.load();
+        while (total > peak && !DecodeBufferPool::peakIdleBytes.compare_exchange_weak(peak, total)) {
+        }
+        return true;
+    }
+
+private:
+    // Буферы возвращаются из того потока, где уничтожен QImage, поэтому
+    // нужен мьютекс; обычно он не занят - берет и отдает один и тот же поток
+    QMutex mutex;
+    QHash<int, QList<Buffer*>> freeLists; // класс размера -> свободные буферы
+    qint64 arenaIdleBytes = 0;
+};
+
+int DecodeBufferPool::sizeClass(qint64 bytes)
+{
+    // Четыре класса на каждую степень двойки: потери не больше 25%
+    int power = 0;
+    while ((qint64(1) << (power + 1)) <= bytes) {
+        power++;
+    }
+    const qint64 base = qint64(1) << power;
+    const qint64 step = base / 4;
+    int quarter = int((bytes - base + step - 1) / step);
+    if (quarter == 4) {
+        power++;
+        quarter = 0;
+    }
+    return power * 4 + quarter;
+}
+
+qint64 DecodeBufferPool::classBytes(int sizeClass)
+{
+    const qint64 base = qint64(1) << (sizeClass / 4);
+    return base + (sizeClass % 4) * (base / 4);
+}
+
+std::shared_ptr<DecodeBufferPool::Arena> DecodeBufferPool::currentArena()
+{
+    thread_local std::shared_ptr<Arena> arena = std::make_shared<Arena>();
+    return arena;
+}
+
+bool DecodeBufferPool::isEnabled()
+{
+    int state = enabledState.load(std::memory_order_relaxed);
+    if (state < 0) {
+        QSettings settings;
+        state = settings.value("thumbnailCache/pooledDecodeBuffers", true).toBool() ? 1 : 0;
+        enabledState.store(state, std::memory_order_relaxed);
+    }
+    return state == 1;
+}
+
+void DecodeBufferPool::setEnabled(bool enabled)
+{
+    enabledState.store(enabled ? 1 : 0);
+}
+
+QImage DecodeBufferPool::acquire(const QSize& size, QImage::Format format)
+{
+    if (size.isEmpty() || format == QImage::Format_Invalid) {
+        return QImage();
+    }
+
+    const qint64 bytesPerLine = ((qint64(size.width()) * QImage::toPixelFormat(format).bitsPerPixel() + 31) / 32) * 4;
+    const qint64 bytes = bytesPerLine * size.height();
+    if (!isEnabled() || bytes < MIN_POOLED_BYTES || bytesPerLine > std::numeric_limits<int>::max()) {
+        return QImage(size, format);
+    }
+
+    std::shared_ptr<Arena> arena = currentArena();
+    const int cls = sizeClass(bytes);
+
+    Buffer *buffer = arena->take(cls);
+    if (buffer) {
+        hitCount++;
+    } else {
+        uchar *data = static_cast<uchar*>(std::malloc(size_t(classBytes(cls))));
+        if (!data) {
+            return QImage();
+        }
+        buffer = new Buffer;
+        buffer->data = data;
+        buffer->sizeClass = cls;
+        missCount++;
+    }
+    buffer->arena = std::move(arena);
+
+    return QImage(buffer->data, size.width(), size.height(), int(bytesPerLine), format,
+                  &DecodeBufferPool::releaseBuffer, buffer);
+}
+
+void DecodeBufferPool::releaseBuffer(void *info)
+{
+    Buffer *buffer = static_cast<Buffer*>(info);
+
+    // Забираем ссылку на арену до возврата буфера: если поток уже завершился,
+    // арена будет уничтожена здесь вместе со всеми своими буферами
+    std::shared_ptr<Arena> arena = std::move(buffer->arena);
+    if (!arena->give(buffer)) {
+        std::free(buffer->data);
+        delete buffer;
+    }
+}
+
+DecodeBufferPool::Stats DecodeBufferPool::stats()
+{
+    Stats result;
+    result.hits = hitCount.load();
+    result.misses = missCount.load();
+    result.idleBytes = idleBytes.load();
+    result.peakIdleBytes = peakIdleBytes.load();
+    return result;
+}
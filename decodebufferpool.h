@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QImage>
+#include <QSize>
+#include <atomic>
+#include <memory>
+
+// Пул временных буферов декодирования. У каждого рабочего потока своя арена:
+// освобожденные буферы не возвращаются в malloc, а лежат в списках по классам
+// размера и отдаются следующему декодированию. QImage оборачивает память
+// из арены и при уничтожении возвращает ее обратно.
+//
+// Только для промежуточных изображений (полный кадр перед уменьшением,
+// полосы): результат, уходящий в кэш или в GUI, выделяется обычным образом.
+class DecodeBufferPool
+{
+public:
+    struct Stats {
+        quint64 hits = 0;        // Буфер взят из арены
+        quint64 misses = 0;      // Пришлось выделить новый
+        qint64 idleBytes = 0;    // Сейчас свободно во всех аренах
+        qint64 peakIdleBytes = 0;
+    };
+
+    // QImage на памяти из арены текущего потока; при выключенном пуле или
+    // маленьком размере - обычный QImage
+    static QImage acquire(const QSize& size, QImage::Format format);
+
+    // Переключатель для сравнения (настройка thumbnailCache/pooledDecodeBuffers)
+    static bool isEnabled();
+    static void setEnabled(bool enabled);
+
+    static Stats stats();
+
+private:
+    class Arena;
+    struct Buffer;
+
+    static std::shared_ptr<Arena> currentArena();
+    static void releaseBuffer(void *info);
+    static int sizeClass(qint64 bytes);
+    static qint64 classBytes(int sizeClass);
+
+    static std::atomic<int> enabledState; // -1 - еще не прочитан из настроек
+    static std::atomic<quint64> hitCount;
+    static std::atomic<quint64> missCount;
+    static std::atomic<qint64> idleBytes;
+    static std::atomic<qint64> peakIdleBytes;
+};
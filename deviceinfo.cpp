@@ -0,0 +1,259 @@
+#include "deviceinfo.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <QDebug>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <winioctl.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#ifdef Q_OS_LINUX
+#include <sys/statfs.h>
+#include <sys/sysmacros.h>
+#endif
+
+QMutex DeviceInfo::cacheMutex;
+QHash<QString, DeviceInfo::Kind> DeviceInfo::kindCache;
+
+namespace {
+    // Одновременных копий по типу устройства. HDD - строго по одному файлу:
+    // параллельные потоки только заставляют головку прыгать
+    constexpr int HDD_CONCURRENCY = 1;
+    constexpr int REMOVABLE_CONCURRENCY = 2;
+    constexpr int NETWORK_CONCURRENCY = 4;
+    constexpr int UNKNOWN_CONCURRENCY = 2;
+    constexpr int MAX_SSD_CONCURRENCY = 16;
+
+#ifdef Q_OS_LINUX
+    QByteArray readSysFile(const QString& path)
+    {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return QByteArray();
+        }
+        return file.readAll().trimmed();
+    }
+#endif
+}
+
+QString DeviceInfo::existingAncestor(const QString& path)
+{
+    QString current = QDir::cleanPath(QFileInfo(path).absoluteFilePath());
+    while (!QFileInfo::exists(current)) {
+        QString parent = QFileInfo(current).path();
+        if (parent == current) {
+            return QString();
+        }
+        current = parent;
+    }
+    return current;
+}
+
+QString DeviceInfo::deviceId(const QString& path)
+{
+    QString existing = existingAncestor(path);
+    if (existing.isEmpty()) {
+        return QString();
+    }
+
+#ifdef Q_OS_WIN
+    std::wstring nativePath = QDir::toNativeSeparators(existing).toStdWString();
+    wchar_t volumePath[MAX_PATH];
+    if (!GetVolumePathNameW(nativePath.c_str(), volumePath, MAX_PATH)) {
+        return QString();
+    }
+
+    // Имя тома (\\?\Volume{GUID}\) одно для всех точек монтирования этого тома
+    wchar_t volumeName[MAX_PATH];
+    if (GetVolumeNameForVolumeMountPointW(volumePath, volumeName, MAX_PATH)) {
+        return QString::fromWCharArray(volumeName);
+    }
+    // Сетевые пути имени тома не имеют - сравниваем по корню
+    return QString::fromWCharArray(volumePath).toLower();
+#else
+    struct stat info;
+    if (::stat(QFile::encodeName(existing).constData(), &info) != 0) {
+        return QString();
+    }
+    return QString::number(quint64(info.st_dev));
+#endif
+}
+
+bool DeviceInfo::sameDevice(const QString& firstPath, const QString& secondPath)
+{
+    QString first = deviceId(firstPath);
+    return !first.isEmpty() && first == deviceId(secondPath);
+}
+
+DeviceInfo::Kind DeviceInfo::kind(const QString& path)
+{
+    QString id = deviceId(path);
+    if (id.isEmpty()) {
+        return Unknown;
+    }
+
+    {
+        QMutexLocker locker(&cacheMutex);
+        auto it = kindCache.constFind(id);
+        if (it != kindCache.constEnd()) {
+            return it.value();
+        }
+    }
+
+    Kind detected = detectKind(path);
+    qDebug() << "Device kind for" << path << ":" << kindName(detected);
+
+    QMutexLocker locker(&cacheMutex);
+    kindCache.insert(id, detected);
+    return detected;
+}
+
+DeviceInfo::Kind DeviceInfo::detectKind(const QString& path)
+{
+    QString existing = existingAncestor(path);
+    if (existing.isEmpty()) {
+        return Unknown;
+    }
+
+#ifdef Q_OS_WIN
+    std::wstring nativePath = QDir::toNativeSeparators(existing).toStdWString();
+    wchar_t volumePath[MAX_PATH];
+    if (!GetVolumePathNameW(nativePath.c_str(), volumePath, MAX_PATH)) {
+        return Unknown;
+    }
+
+    switch (GetDriveTypeW(volumePath)) {
+    case DRIVE_REMOTE:
+        return Network;
+    case DRIVE_REMOVABLE:
+        return Removable;
+    case DRIVE_FIXED:
+        break;
+    default:
+        return Unknown;
+    }
+
+    // Открываем том без прав доступа - для запросов свойств этого достаточно
+    QString volume = QString::fromWCharArray(volumePath);
+    if (volume.length() < 2 || volume[1] != ':') {
+        return Unknown;
+    }
+    std::wstring devicePath = QString("\\\\.\\%1:").arg(volume[0]).toStdWString();
+    HANDLE device = CreateFileW(devicePath.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                                OPEN_EXISTING, 0, nullptr);
+    if (device == INVALID_HANDLE_VALUE) {
+        return Unknown;
+    }
+
+    Kind result = Unknown;
+    DWORD returned = 0;
+
+    // Внешние USB-диски система считает фиксированными
+    STORAGE_PROPERTY_QUERY query = {};
+    query.PropertyId = StorageDeviceProperty;
+    query.QueryType = PropertyStandardQuery;
+    STORAGE_DEVICE_DESCRIPTOR descriptor = {};
+    if (DeviceIoControl(device, IOCTL_STORAGE_QUERY_PROPERTY, &query, sizeof(query),
+                        &descriptor, sizeof(descriptor), &returned, nullptr) &&
+        descriptor.BusType == BusTypeUsb) {
+        result = Removable;
+    }
+
+    if (result == Unknown) {
+        query.PropertyId = StorageDeviceSeekPenaltyProperty;
+        DEVICE_SEEK_PENALTY_DESCRIPTOR seekPenalty = {};
+        if (DeviceIoControl(device, IOCTL_STORAGE_QUERY_PROPERTY, &query, sizeof(query),
+                            &seekPenalty, sizeof(seekPenalty), &returned, nullptr)) {
+            result = seekPenalty.IncursSeekPenalty ? Hdd : Ssd;
+        }
+    }
+
+    CloseHandle(device);
+    return result;
+#elif defined(Q_OS_LINUX)
+    const QByteArray nativePath = QFile::encodeName(existing);
+
+    struct statfs fsInfo;
+    if (::statfs(nativePath.constData(), &fsInfo) == 0) {
+        switch (quint32(fsInfo.f_type)) {
+        case 0x6969:      // NFS
+        case 0xFF534D42:  // CIFS
+        case 0xFE534D42:  // SMB2
+        case 0x517B:      // SMB
+        case 0x65735546:  // FUSE (sshfs и т.п.)
+            return Network;
+        }
+    }
+
+    struct stat info;
+    if (::stat(nativePath.constData(), &info) != 0 || major(info.st_dev) == 0) {
+        // Виртуальные устройства (btrfs, overlay) - тип не определить
+        return Unknown;
+    }
+
+    // /sys/dev/block/M:m указывает на раздел или диск; очередь есть только у диска
+    QString blockPath = QFileInfo(QString("/sys/dev/block/%1:%2").arg(major(info.st_dev)).arg(minor(info.st_dev)))
+                            .canonicalFilePath();
+    if (blockPath.isEmpty()) {
+        return Unknown;
+    }
+    if (QFile::exists(blockPath + "/partition")) {
+        blockPath = QFileInfo(blockPath).path();
+    }
+
+    if (readSysFile(blockPath + "/removable") == "1" || blockPath.contains("/usb")) {
+        return Removable;
+    }
+
+    QByteArray rotational = readSysFile(blockPath + "/queue/rotational");
+    if (rotational == "1") {
+        return Hdd;
+    }
+    if (rotational == "0") {
+        return Ssd;
+    }
+    return Unknown;
+#else
+    return Unknown;
+#endif
+}
+
+const char* DeviceInfo::kindName(Kind kind)
+{
+    switch (kind) {
+    case Ssd:       return "SSD";
+    case Hdd:       return "HDD";
+    case Removable: return "removable";
+    case Network:   return "network";
+    case Unknown:   break;
+    }
+    return "unknown";
+}
+
+int DeviceInfo::concurrencyFor(Kind kind)
+{
+    switch (kind) {
+    case Ssd:
+        // Очередь NVMe выдерживает много запросов - масштабируемся по ядрам
+        return qBound(2, QThread::idealThreadCount() * 2, MAX_SSD_CONCURRENCY);
+    case Hdd:
+        return HDD_CONCURRENCY;
+    case Removable:
+        return REMOVABLE_CONCURRENCY;
+    case Network:
+        return NETWORK_CONCURRENCY;
+    case Unknown:
+        break;
+    }
+    return UNKNOWN_CONCURRENCY;
+}
+
+int DeviceInfo::copyConcurrency(const QString& sourcePath, const QString& destinationPath)
+{
+    return qMin(concurrencyFor(kind(sourcePath)), concurrencyFor(kind(destinationPath)));
+}
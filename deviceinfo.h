@@ -0,0 +1,39 @@
+#pragma once
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+// Сведения о томе, на котором лежит путь
+class DeviceInfo
+{
+public:
+    enum Kind {
+        Unknown,
+        Ssd,        // Без штрафа за позиционирование (SATA SSD, NVMe)
+        Hdd,
+        Removable,  // USB-накопители и карты памяти
+        Network
+    };
+
+    // Идентификатор тома; для несуществующего пути - по ближайшей существующей
+    // родительской папке. Пустая строка, если том определить не удалось
+    static QString deviceId(const QString& path);
+    static bool sameDevice(const QString& firstPath, const QString& secondPath);
+
+    // Тип накопителя; результат запоминается для каждого тома
+    static Kind kind(const QString& path);
+    static const char* kindName(Kind kind);
+
+    // Сколько файлов одновременно копировать с source на destination:
+    // ограничивает более медленное из двух устройств
+    static int copyConcurrency(const QString& sourcePath, const QString& destinationPath);
+
+private:
+    static QString existingAncestor(const QString& path);
+    static Kind detectKind(const QString& path);
+    static int concurrencyFor(Kind kind);
+
+    static QMutex cacheMutex;
+    static QHash<QString, Kind> kindCache; // идентификатор тома -> тип
+};
@@ -0,0 +1,139 @@
+#include "filesignature.h"
+#include "rawpreview.h"
+#include <QFile>
+#include <QFileInfo>
+
+FileSignature::Kind FileSignature::detect(const QByteArray& header, const QString& suffix)
+{
+    const QString lowerSuffix = suffix.toLower();
+
+    if (header.startsWith("\xFF\xD8\xFF")) {
+        return Jpeg;
+    }
+    if (header.startsWith("\x89PNG\r\n\x1A\n")) {
+        return Png;
+    }
+    if (header.startsWith("GIF87a") || header.startsWith("GIF89a")) {
+        return Gif;
+    }
+    if (header.startsWith("BM") && header.size() >= 14) {
+        return Bmp;
+    }
+    if (header.startsWith("RIFF") && header.mid(8, 4) == "WEBP") {
+        return Webp;
+    }
+
+    // TIFF и RAW на его основе различаем по расширению; ORF и RW2 - свои сигнатуры
+    if (header.startsWith(QByteArray("II*\0", 4)) || header.startsWith(QByteArray("MM\0*", 4))) {
+        return RawPreview::supportedSuffixes().contains(lowerSuffix) ? Raw : Tiff;
+    }
+    if (header.startsWith("IIRO") || header.startsWith("IIRS") || header.startsWith(QByteArray("IIU\0", 4))) {
+        return Raw;
+    }
+
+    // ICO и CUR
+    if (header.startsWith(QByteArray("\0\0\1\0", 4)) || header.startsWith(QByteArray("\0\0\2\0", 4))) {
+        return Ico;
+    }
+
+    if (header.startsWith("ID3")) {
+        return AudioId3;
+    }
+    if (header.startsWith("fLaC")) {
+        return AudioFlac;
+    }
+    // Контейнер ISO BMFF: бренды у m4a бывают разные (M4A, mp42, isom), поэтому
+    // аудио определяем по расширению; остальное (HEIF, видео) не поддерживаем
+    if (header.mid(4, 4) == "ftyp" && (lowerSuffix == "m4a" || lowerSuffix == "m4b")) {
+        return AudioMp4;
+    }
+
+    // SVG - текст: допускаем BOM, пробелы и сжатый SVG (svgz)
+    if (lowerSuffix == "svg") {
+        if (header.startsWith("\x1F\x8B")) {
+            return Svg;
+        }
+        QByteArray text = header.startsWith("\xEF\xBB\xBF") ? header.mid(3) : header;
+        if (text.trimmed().startsWith('<')) {
+            return Svg;
+        }
+    }
+
+    return Unknown;
+}
+
+QHash<QString, FileSignature::Kind> FileSignature::sniffBatch(const QStringList& filePaths)
+{
+    QHash<QString, Kind> kinds;
+    kinds.reserve(filePaths.size());
+
+    for (const QString& filePath : filePaths) {
+        QFile file(filePath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            kinds.insert(filePath, Unreadable);
+            continue;
+        }
+        QByteArray header = file.read(HeaderSize);
+        kinds.insert(filePath, detect(header, QFileInfo(filePath).suffix()));
+    }
+
+    return kinds;
+}
+
+QByteArray FileSignature::readerFormat(Kind kind)
+{
+    switch (kind) {
+    case Jpeg:
+        return "jpeg";
+    case Png:
+        return "png";
+    case Gif:
+        return "gif";
+    case Bmp:
+        return "bmp";
+    case Webp:
+        return "webp";
+    case Tiff:
+        return "tiff";
+    case Ico:
+        return "ico";
+    case Svg:
+        return "svg";
+    default:
+        return QByteArray();
+    }
+}
+
+QString FileSignature::name(Kind kind)
+{
+    switch (kind) {
+    case Jpeg:
+        return "JPEG";
+    case Png:
+        return "PNG";
+    case Gif:
+        return "GIF";
+    case Bmp:
+        return "BMP";
+    case Webp:
+        return "WebP";
+    case Tiff:
+        return "TIFF";
+    case Ico:
+        return "ICO";
+    case Svg:
+        return "SVG";
+    case Raw:
+        return "RAW";
+    case AudioId3:
+        return "ID3";
+    case AudioFlac:
+        return "FLAC";
+    case AudioMp4:
+        return "MP4";
+    case Unreadable:
+        return "Unreadable";
+    default:
+        return "Unknown";
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+// Определение типа файла по сигнатуре (первые байты), а не по расширению:
+// по ней выбирается декодер миниатюры, а файлы с чужим содержимым
+// отсекаются без попытки декодирования.
+class FileSignature
+{
+public:
+    enum Kind {
+        Unknown,    // Сигнатура не распознана - файл не декодируем
+        Unreadable, // Файл не открылся (занят, нет прав, сеть) - ошибка временная
+        Jpeg,
+        Png,
+        Gif,
+        Bmp,
+        Webp,
+        Tiff,
+        Ico,
+        Svg,
+        Raw,        // RAW камеры на базе TIFF/IFD
+        AudioId3,   // mp3 (и flac) с тегом ID3v2
+        AudioFlac,
+        AudioMp4
+    };
+
+    static constexpr int HeaderSize = 32;
+
+    static Kind detect(const QByteArray& header, const QString& suffix);
+    // Один последовательный проход по пачке файлов: по HeaderSize байт с каждого
+    static QHash<QString, Kind> sniffBatch(const QStringList& filePaths);
+
+    // Формат для QImageReader ("jpeg", "png"...) или пустая строка
+    static QByteArray readerFormat(Kind kind);
+    static QString name(Kind kind);
+};
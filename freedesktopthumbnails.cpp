@@ -0,0 +1,172 @@
+#include "freedesktopthumbnails.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QImageWriter>
+#include <QSaveFile>
+#include <QUrl>
+#include <QDebug>
+
+namespace {
+    struct SizeDir {
+        const char* name;
+        int edge;
+    };
+
+    // Каталоги размеров по возрастанию
+    const SizeDir SIZE_DIRS[] = {
+        { "normal", 128 },
+        { "large", 256 },
+        { "x-large", 512 },
+        { "xx-large", 1024 }
+    };
+}
+
+bool FreedesktopThumbnails::isSupported()
+{
+#ifdef Q_OS_LINUX
+    return true;
+#else
+    return false;
+#endif
+}
+
+QString FreedesktopThumbnails::cacheRoot()
+{
+    // $XDG_CACHE_HOME/thumbnails, по умолчанию ~/.cache/thumbnails
+    QString cacheHome = qEnvironmentVariable("XDG_CACHE_HOME");
+    if (cacheHome.isEmpty() || QDir::isRelativePath(cacheHome)) {
+        cacheHome = QDir::homePath() + "/.cache";
+    }
+    return cacheHome + "/thumbnails";
+}
+
+QString FreedesktopThumbnails::fileUri(const QString& filePath)
+{
+    return QString::fromLatin1(QUrl::fromLocalFile(QFileInfo(filePath).absoluteFilePath()).toEncoded());
+}
+
+QString FreedesktopThumbnails::thumbnailName(const QString& uri)
+{
+    return QCryptographicHash::hash(uri.toUtf8(), QCryptographicHash::Md5).toHex() + ".png";
+}
+
+QImage FreedesktopThumbnails::load(const QString& filePath, int minEdge)
+{
+    if (!isSupported()) {
+        return QImage();
+    }
+
+    QFileInfo fileInfo(filePath);
+    if (!fileInfo.isFile()) {
+        return QImage();
+    }
+
+    const QString uri = fileUri(filePath);
+    const QString name = thumbnailName(uri);
+    const QString root = cacheRoot();
+    const qint64 mtime = fileInfo.lastModified().toSecsSinceEpoch();
+
+    for (const SizeDir& sizeDir : SIZE_DIRS) {
+        // Меньшие размеры дали бы размытую миниатюру - такие не берем
+        if (sizeDir.edge < minEdge) {
+            continue;
+        }
+
+        QString thumbnailPath = root + "/" + sizeDir.name + "/" + name;
+        if (!QFileInfo::exists(thumbnailPath)) {
+            continue;
+        }
+
+        QImageReader reader(thumbnailPath, "png");
+
+        // Теги читаются из заголовка PNG до декодирования пикселей
+        QString thumbUri = reader.text("Thumb::URI");
+        QString thumbMTime = reader.text("Thumb::MTime");
+        if (thumbMTime.isEmpty() || qint64(thumbMTime.toDouble()) != mtime) {
+            continue; // Оригинал изменился после создания миниатюры
+        }
+        // Экранирование URI у разных программ отличается - сравниваем как URL
+        if (!thumbUri.isEmpty() && QUrl(thumbUri) != QUrl(uri)) {
+            continue;
+        }
+        QString thumbSize = reader.text("Thumb::Size");
+        if (!thumbSize.isEmpty() && thumbSize.toLongLong() != fileInfo.size()) {
+            continue;
+        }
+
+        QImage image = reader.read();
+        if (!image.isNull()) {
+            return image;
+        }
+    }
+
+    return QImage();
+}
+
+bool FreedesktopThumbnails::save(const QString& filePath, const QImage& image)
+{
+    if (!isSupported() || image.isNull()) {
+        return false;
+    }
+
+    QFileInfo fileInfo(filePath);
+    if (!fileInfo.isFile()) {
+        return false;
+    }
+
+    const QString root = cacheRoot();
+
+    // Спецификация запрещает создавать миниатюры для самих миниатюр
+    if (fileInfo.absoluteFilePath().startsWith(root + "/")) {
+        return false;
+    }
+
+    // Наибольший каталог, который миниатюра заполняет без увеличения
+    const int imageEdge = qMax(image.width(), image.height());
+    const SizeDir* target = &SIZE_DIRS[0];
+    for (const SizeDir& sizeDir : SIZE_DIRS) {
+        if (sizeDir.edge <= imageEdge) {
+            target = &sizeDir;
+        }
+    }
+
+    QDir dir(root + "/" + target->name);
+    if (!dir.exists()) {
+        if (!dir.mkpath(".")) {
+            return false;
+        }
+        QFile::setPermissions(dir.path(), QFileDevice::ReadOwner | QFileDevice::WriteOwner | QFileDevice::ExeOwner);
+    }
+
+    QImage thumbnail = imageEdge > target->edge
+        ? image.scaled(target->edge, target->edge, Qt::KeepAspectRatio, Qt::SmoothTransformation)
+        : image;
+
+    const QString uri = fileUri(filePath);
+    thumbnail.setText("Thumb::URI", uri);
+    thumbnail.setText("Thumb::MTime", QString::number(fileInfo.lastModified().toSecsSinceEpoch()));
+    thumbnail.setText("Thumb::Size", QString::number(fileInfo.size()));
+    thumbnail.setText("Software", "QFiles");
+
+    // Запись во временный файл и переименование - другие программы не увидят половину PNG
+    QSaveFile file(dir.filePath(thumbnailName(uri)));
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QImageWriter writer(&file, "png");
+    if (!writer.write(thumbnail)) {
+        file.cancelWriting();
+        return false;
+    }
+    file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+
+    if (!file.commit()) {
+        qDebug() << "Failed to save shared thumbnail for:" << filePath;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <QImage>
+#include <QString>
+
+// Общий кэш миниатюр по спецификации freedesktop.org (~/.cache/thumbnails),
+// который заполняют другие файловые менеджеры и просмотрщики в Linux.
+// Имя файла - MD5 от URI оригинала, актуальность проверяется по PNG-тегам
+// Thumb::URI и Thumb::MTime. На других системах методы ничего не делают.
+class FreedesktopThumbnails
+{
+public:
+    static bool isSupported();
+
+    // Наименьшая подходящая миниатюра (normal 128, large 256, x-large 512,
+    // xx-large 1024) со стороной не меньше minEdge, либо пустой QImage
+    static QImage load(const QString& filePath, int minEdge);
+
+    // Запись миниатюры в общий кэш (атомарно, права 0600)
+    static bool save(const QString& filePath, const QImage& image);
+
+private:
+    static QString cacheRoot();
+    static QString fileUri(const QString& filePath);
+    static QString thumbnailName(const QString& uri);
+};
@@ -0,0 +1,421 @@
+#include "imagedecoder.h"
+#include "thumbnailmemorycache.h"
+#include "decodebufferpool.h"
+#include <QFile>
+#include <QPainter>
+#include <QtEndian>
+#include <QDebug>
+
+namespace {
+    thread_local bool outOfBudget = false;
+    thread_local bool tooLarge = false;
+
+    // Сколько изображений файла просматривать в поисках уменьшенной копии
+    constexpr int MAX_EMBEDDED_IMAGES = 16;
+
+    // Резервирует память под буфер декодирования в общем бюджете миниатюр
+    class DecodeReservation
+    {
+    public:
+        explicit DecodeReservation(qint64 bytes)
+            : reservedBytes(bytes)
+            , reserved(ThumbnailMemoryCache::instance().reserveDecode(bytes))
+        {
+            if (!reserved) {
+                outOfBudget = true;
+            }
+        }
+
+        ~DecodeReservation()
+        {
+            if (reserved) {
+                ThumbnailMemoryCache::instance().releaseDecode(reservedBytes);
+            }
+        }
+
+        bool isValid() const { return reserved; }
+
+    private:
+        qint64 reservedBytes;
+        bool reserved;
+    };
+
+    int allocationLimitMb()
+    {
+        return int(ImageDecoder::MaxDecodeBytes / (1024 * 1024));
+    }
+}
+
+ScanlineDownsampler::ScanlineDownsampler(const QSize& sourceSize, const QSize& targetSize, bool bottomUp)
+    : source(sourceSize)
+    , output(targetSize, QImage::Format_RGB888)
+    , accumulator(targetSize.width() * 3, 0)
+    , columnMap(sourceSize.width())
+    , columnCount(targetSize.width(), 0)
+    , flipped(bottomUp)
+{
+    for (int x = 0; x < source.width(); ++x) {
+        int outX = int(qint64(x) * output.width() / source.width());
+        columnMap[x] = outX;
+        columnCount[outX]++;
+    }
+}
+
+void ScanlineDownsampler::addRow(const uchar* rgb)
+{
+    if (sourceRow >= source.height()) {
+        return;
+    }
+
+    // Строка попадает в следующую выходную строку - сбрасываем накопленное
+    int targetRow = int(qint64(sourceRow) * output.height() / source.height());
+    if (targetRow != outputRow && rowsInAccumulator > 0) {
+        flushRow();
+        outputRow = targetRow;
+    }
+
+    quint32* acc = accumulator.data();
+    for (int x = 0; x < source.width(); ++x) {
+        quint32* pixel = acc + columnMap[x] * 3;
+        pixel[0] += rgb[x * 3];
+        pixel[1] += rgb[x * 3 + 1];
+        pixel[2] += rgb[x * 3 + 2];
+    }
+
+    rowsInAccumulator++;
+    sourceRow++;
+}
+
+QImage ScanlineDownsampler::finish()
+{
+    if (rowsInAccumulator > 0) {
+        flushRow();
+    }
+    return output;
+}
+
+void ScanlineDownsampler::flushRow()
+{
+    int y = flipped ? output.height() - 1 - outputRow : outputRow;
+    uchar* line = output.scanLine(y);
+
+    for (int x = 0; x < output.width(); ++x) {
+        quint32 samples = quint32(qMax(1, columnCount[x])) * rowsInAccumulator;
+        line[x * 3] = uchar(accumulator[x * 3] / samples);
+        line[x * 3 + 1] = uchar(accumulator[x * 3 + 1] / samples);
+        line[x * 3 + 2] = uchar(accumulator[x * 3 + 2] / samples);
+    }
+
+    accumulator.fill(0);
+    rowsInAccumulator = 0;
+}
+
+bool ImageDecoder::lastDecodeOutOfBudget()
+{
+    return outOfBudget;
+}
+
+bool ImageDecoder::lastDecodeTooLarge()
+{
+    return tooLarge;
+}
+
+QSize ImageDecoder::fitSize(const QSize& sourceSize, const QSize& targetSize)
+{
+    if (sourceSize.width() <= targetSize.width() && sourceSize.height() <= targetSize.height()) {
+        return sourceSize;
+    }
+
+    QSize fit = sourceSize.scaled(targetSize, Qt::KeepAspectRatio);
+    return fit.expandedTo(QSize(1, 1));
+}
+
+QImage ImageDecoder::decodeBounded(const QString& filePath, const QSize& targetSize, const QByteArray& format)
+{
+    outOfBudget = false;
+    tooLarge = false;
+    QImageReader reader(filePath, format);
+    if (!reader.canRead()) {
+        return QImage();
+    }
+    return decodeWithReader(reader, targetSize, filePath);
+}
+
+QImage ImageDecoder::decodeBounded(QIODevice* device, const QSize& targetSize)
+{
+    outOfBudget = false;
+    tooLarge = false;
+    QImageReader reader(device);
+    if (!reader.canRead()) {
+        return QImage();
+    }
+    return decodeWithReader(reader, targetSize, QString());
+}
+
+QImage ImageDecoder::decodeWithReader(QImageReader& reader, const QSize& targetSize, const QString& filePath)
+{
+    // Жесткий предел на любое выделение памяти внутри обработчика формата
+    reader.setAllocationLimit(allocationLimitMb());
+
+    QSize sourceSize = reader.size();
+    if (!sourceSize.isValid()) {
+        // Размер заранее неизвестен - полагаемся на лимит выделения
+        QImage image = reader.read();
+        if (image.isNull()) {
+            return image;
+        }
+        return image.scaled(fitSize(image.size(), targetSize), Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+
+    QSize fit = fitSize(sourceSize, targetSize);
+    qint64 fullBytes = qint64(sourceSize.width()) * sourceSize.height() * 4;
+
+    // Масштабированное чтение: JPEG уменьшает на этапе DCT, PNG - построчно
+    if (fit != sourceSize && reader.supportsOption(QImageIOHandler::ScaledSize)) {
+        DecodeReservation reservation(qint64(fit.width()) * fit.height() * 4);
+        if (!reservation.isValid()) {
+            return QImage();
+        }
+        reader.setScaledSize(fit);
+        return reader.read();
+    }
+
+    // Полный кадр влезает в лимит - обычное чтение
+    if (fullBytes <= MaxDecodeBytes) {
+        DecodeReservation reservation(fullBytes);
+        if (!reservation.isValid()) {
+            return QImage();
+        }
+        if (fit == sourceSize) {
+            return reader.read();
+        }
+
+        // Полный кадр нужен только до уменьшения - читаем его в буфер из пула
+        QImage image = DecodeBufferPool::acquire(sourceSize, reader.imageFormat());
+        if (!reader.read(&image)) {
+            return QImage();
+        }
+        return image.scaled(fit, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+
+    if (filePath.isEmpty()) {
+        qDebug() << "Embedded image too large for bounded decode:" << sourceSize;
+        tooLarge = true;
+        return QImage();
+    }
+
+    // Формат умеет читать область - читаем полосами
+    if (reader.supportsOption(QImageIOHandler::ClipRect)) {
+        return decodeInBands(filePath, reader.format(), sourceSize, fit);
+    }
+
+    // Несжатый BMP - потоковое уменьшение по строкам
+    if (reader.format() == "bmp") {
+        QImage image = decodeBmpStreaming(filePath, targetSize);
+        if (!image.isNull()) {
+            return image;
+        }
+    }
+
+    // Уменьшенная копия внутри файла (страницы TIFF, размеры ICO)
+    QImage preview = decodeEmbeddedPreview(reader, fit);
+    if (!preview.isNull()) {
+        return preview;
+    }
+
+    return decodeFullInBudget(reader, sourceSize, fit, filePath);
+}
+
+QImage ImageDecoder::decodeEmbeddedPreview(QImageReader& reader, const QSize& fitSize)
+{
+    const int count = reader.imageCount();
+    if (count < 2) {
+        return QImage();
+    }
+
+    // Наименьшая копия, покрывающая fitSize; если таких нет - наибольшая из влезающих в лимит
+    int best = -1;
+    QSize bestSize;
+    bool bestCovers = false;
+    for (int i = 1; i < count && i < MAX_EMBEDDED_IMAGES; ++i) {
+        if (!reader.jumpToImage(i)) {
+            break;
+        }
+        QSize size = reader.size();
+        if (!size.isValid() || qint64(size.width()) * size.height() * 4 > MaxDecodeBytes) {
+            continue;
+        }
+        bool covers = size.width() >= fitSize.width() || size.height() >= fitSize.height();
+        qint64 area = qint64(size.width()) * size.height();
+        qint64 bestArea = qint64(bestSize.width()) * bestSize.height();
+        if (best < 0 || (covers && (!bestCovers || area < bestArea)) || (!covers && !bestCovers && area > bestArea)) {
+            best = i;
+            bestSize = size;
+            bestCovers = covers;
+        }
+    }
+
+    if (best < 0 || !reader.jumpToImage(best)) {
+        reader.jumpToImage(0);
+        return QImage();
+    }
+
+    DecodeReservation reservation(qint64(bestSize.width()) * bestSize.height() * 4);
+    if (!reservation.isValid()) {
+        return QImage();
+    }
+    QImage image = reader.read();
+    if (image.isNull()) {
+        return image;
+    }
+    qDebug() << "Using embedded image" << best << image.size() << "for thumbnail";
+    return image.scaled(ImageDecoder::fitSize(image.size(), fitSize), Qt::KeepAspectRatio, Qt::SmoothTransformation);
+}
+
+QImage ImageDecoder::decodeFullInBudget(QImageReader& reader, const QSize& sourceSize, const QSize& fitSize,
+                                        const QString& filePath)
+{
+    // Ни уменьшенного, ни частичного чтения формат не умеет - полный кадр,
+    // но в пределах общего бюджета миниатюр, а не лимита одного декодирования
+    const qint64 fullBytes = qint64(sourceSize.width()) * sourceSize.height() * 4;
+    if (fullBytes > ThumbnailMemoryCache::instance().budget() / 2) {
+        qDebug() << "Image too large for the thumbnail memory budget:" << filePath << sourceSize;
+        tooLarge = true;
+        return QImage();
+    }
+
+    // Бюджет сейчас занят - ошибка временная, outOfBudget выставит резервирование
+    DecodeReservation reservation(fullBytes);
+    if (!reservation.isValid()) {
+        return QImage();
+    }
+
+    QImageReader fullReader(filePath, reader.format());
+    fullReader.setAllocationLimit(int(fullBytes / (1024 * 1024)) + 1);
+    QImage image = fullReader.read();
+    if (image.isNull()) {
+        qDebug() << "Full decode failed:" << filePath << fullReader.errorString();
+        return image;
+    }
+    return image.scaled(fitSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+}
+
+QImage ImageDecoder::decodeInBands(const QString& filePath, const QByteArray& format, const QSize& sourceSize,
+                                   const QSize& fitSize)
+{
+    // Полоса занимает не больше половины лимита
+    qint64 rowBytes = qint64(sourceSize.width()) * 4;
+    int bandHeight = int(qMin<qint64>(sourceSize.height(), (MaxDecodeBytes / 2) / rowBytes));
+    if (bandHeight < 1) {
+        qDebug() << "Image row too wide for bounded decode:" << filePath << sourceSize;
+        return QImage();
+    }
+
+    DecodeReservation reservation(rowBytes * bandHeight + qint64(fitSize.width()) * fitSize.height() * 4);
+    if (!reservation.isValid()) {
+        return QImage();
+    }
+
+    QImage output(fitSize, QImage::Format_ARGB32_Premultiplied);
+    output.fill(Qt::transparent);
+
+    QPainter painter(&output);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
+
+    // Полосы одного размера - обработчик пишет в один и тот же буфер из пула
+    QImage band;
+
+    const qreal scaleY = qreal(fitSize.height()) / sourceSize.height();
+    for (int y = 0; y < sourceSize.height(); y += bandHeight) {
+        QRect clip(0, y, sourceSize.width(), qMin(bandHeight, sourceSize.height() - y));
+
+        // Каждый проход - новый reader: обработчики читают только один раз
+        QImageReader bandReader(filePath, format);
+        bandReader.setAllocationLimit(allocationLimitMb());
+        bandReader.setClipRect(clip);
+        if (band.size() != clip.size() || band.format() != bandReader.imageFormat()) {
+            band = DecodeBufferPool::acquire(clip.size(), bandReader.imageFormat());
+        }
+        if (!bandReader.read(&band)) {
+            qDebug() << "Band decode failed:" << filePath << clip << bandReader.errorString();
+            return QImage();
+        }
+
+        painter.drawImage(QRectF(0, y * scaleY, fitSize.width(), clip.height() * scaleY), band);
+    }
+
+    painter.end();
+    return output;
+}
+
+QImage ImageDecoder::decodeBmpStreaming(const QString& filePath, const QSize& targetSize)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QImage();
+    }
+
+    // BITMAPFILEHEADER (14 байт) + BITMAPINFOHEADER (40 байт)
+    QByteArray header = file.read(54);
+    if (header.size() < 54 || !header.startsWith("BM")) {
+        return QImage();
+    }
+
+    const uchar* data = reinterpret_cast<const uchar*>(header.constData());
+    quint32 pixelOffset = qFromLittleEndian<quint32>(data + 10);
+    quint32 infoSize = qFromLittleEndian<quint32>(data + 14);
+    qint32 width = qFromLittleEndian<qint32>(data + 18);
+    qint32 height = qFromLittleEndian<qint32>(data + 22);
+    quint16 bitCount = qFromLittleEndian<quint16>(data + 28);
+    quint32 compression = qFromLittleEndian<quint32>(data + 30);
+
+    // Поддерживаем только несжатые 24/32-битные BMP (BI_RGB, BI_BITFIELDS со стандартными масками)
+    bool uncompressed = compression == 0 || (compression == 3 && bitCount == 32);
+    if (infoSize < 40 || width <= 0 || height == 0 || !uncompressed || (bitCount != 24 && bitCount != 32)) {
+        qDebug() << "Unsupported BMP for streaming decode:" << filePath << bitCount << compression;
+        return QImage();
+    }
+
+    bool bottomUp = height > 0;
+    QSize sourceSize(width, qAbs(height));
+    QSize fit = fitSize(sourceSize, targetSize);
+
+    const int bytesPerPixel = bitCount / 8;
+    const qsizetype stride = ((qsizetype(width) * bitCount + 31) / 32) * 4;
+    const qsizetype rgbBytes = qsizetype(width) * 3;
+
+    // Строка шире лимита (ширина до 2^31) - буферы строки не выделяем
+    if (stride + rgbBytes + qsizetype(width) * sizeof(int) > MaxDecodeBytes / 2) {
+        qDebug() << "BMP row too wide for streaming decode:" << filePath << width;
+        return QImage();
+    }
+
+    DecodeReservation reservation(stride + rgbBytes + qint64(width) * sizeof(int) +
+                                  qint64(fit.width()) * fit.height() * 7);
+    if (!reservation.isValid() || !file.seek(pixelOffset)) {
+        return QImage();
+    }
+
+    ScanlineDownsampler downsampler(sourceSize, fit, bottomUp);
+    QByteArray row(stride, Qt::Uninitialized);
+    QByteArray rgb(rgbBytes, Qt::Uninitialized);
+
+    for (int y = 0; y < sourceSize.height(); ++y) {
+        if (file.read(row.data(), stride) != stride) {
+            qDebug() << "Truncated BMP:" << filePath;
+            return QImage();
+        }
+
+        // BGR(A) -> RGB
+        const uchar* src = reinterpret_cast<const uchar*>(row.constData());
+        uchar* dst = reinterpret_cast<uchar*>(rgb.data());
+        for (int x = 0; x < width; ++x) {
+            dst[x * 3] = src[x * bytesPerPixel + 2];
+            dst[x * 3 + 1] = src[x * bytesPerPixel + 1];
+            dst[x * 3 + 2] = src[x * bytesPerPixel];
+        }
+        downsampler.addRow(dst);
+    }
+
+    return downsampler.finish();
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <QImage>
+#include <QImageReader>
+#include <QSize>
+#include <QString>
+#include <QVector>
+
+class QIODevice;
+
+// Построчный уменьшатель: принимает строки исходного изображения по одной
+// и усредняет их в выходное изображение (box-фильтр). Память - одна строка
+// аккумулятора, независимо от размера исходника.
+class ScanlineDownsampler
+{
+public:
+    // bottomUp - строки подаются снизу вверх (как хранит BMP)
+    ScanlineDownsampler(const QSize& sourceSize, const QSize& targetSize, bool bottomUp = false);
+
+    // Строка в формате RGB888 (sourceSize.width() * 3 байт)
+    void addRow(const uchar* rgb);
+    QImage finish();
+
+private:
+    void flushRow();
+
+    QSize source;
+    QImage output;
+    QVector<quint32> accumulator; // Суммы R,G,B для текущей выходной строки
+    QVector<int> columnMap;       // Исходный столбец -> выходной столбец
+    QVector<int> columnCount;     // Сколько исходных столбцов в выходном
+    bool flipped;
+    int sourceRow = 0;
+    int outputRow = 0;
+    int rowsInAccumulator = 0;
+};
+
+class ImageDecoder
+{
+public:
+    // Предел памяти на одно декодирование
+    static constexpr qint64 MaxDecodeBytes = 96LL * 1024 * 1024;
+
+    // Декодирует изображение не больше targetSize, не выходя за MaxDecodeBytes:
+    // масштабированное чтение (JPEG, PNG, SVG), чтение полосами по ClipRect,
+    // потоковое уменьшение для BMP, уменьшенная копия внутри файла (страницы TIFF).
+    // Остальное - полным кадром, если он влезает в общий бюджет миниатюр
+    // format - формат для QImageReader, если он известен по сигнатуре (иначе по расширению и содержимому)
+    static QImage decodeBounded(const QString& filePath, const QSize& targetSize,
+                                const QByteArray& format = QByteArray());
+    static QImage decodeBounded(QIODevice* device, const QSize& targetSize);
+
+    // Последний вызов decodeBounded в этом потоке не получил память под буфер:
+    // ошибка временная, сам файл при этом может быть исправным
+    static bool lastDecodeOutOfBudget();
+    // Полный кадр больше всего бюджета миниатюр: при текущих настройках
+    // файл не декодировать, но и битым он не является
+    static bool lastDecodeTooLarge();
+
+private:
+    static QImage decodeWithReader(QImageReader& reader, const QSize& targetSize,
+                                   const QString& filePath);
+    static QImage decodeInBands(const QString& filePath, const QByteArray& format, const QSize& sourceSize,
+                                const QSize& fitSize);
+    static QImage decodeBmpStreaming(const QString& filePath, const QSize& targetSize);
+    static QImage decodeEmbeddedPreview(QImageReader& reader, const QSize& fitSize);
+    static QImage decodeFullInBudget(QImageReader& reader, const QSize& sourceSize, const QSize& fitSize,
+                                     const QString& filePath);
+    static QSize fitSize(const QSize& sourceSize, const QSize& targetSize);
+};
@@ -11,6 +11,8 @@
 #include <QLocalServer>
 #include <QLocalSocket>
 #include "mainwindow.h"
+#include "thumbnailwarmer.h"
+#include <QGuiApplication>
 
 #ifdef Q_OS_WIN
 #include <windows.h>
@@ -209,6 +211,22 @@ int main(int argc, char *argv[])
         return performBatchAdminOperation(args) ? 0 : 1;
     }
 
+    // Прогрев кэша миниатюр без окон. Запускается до SingleApplication, чтобы не
+    // передавать аргументы уже открытому экземпляру и не занимать его место
+    if (args.contains("--warm-thumbnails")) {
+#ifdef Q_OS_LINUX
+        // Без дисплея (сервер, задание по расписанию) - платформа без экрана
+        if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM") && qEnvironmentVariableIsEmpty("DISPLAY") &&
+            qEnvironmentVariableIsEmpty("WAYLAND_DISPLAY")) {
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+        }
+#endif
+        QGuiApplication warmApp(argc, argv);
+        // То же имя, что у GUI: общий каталог кэша и настройки
+        warmApp.setApplicationName("QFiles");
+        return ThumbnailWarmer::run(args);
+    }
+
     // Обработка ссылки QFile: (исправленная версия для путей с пробелами)
     QString linkPath;
     int qfileStartIndex = -1;
@@ -371,6 +371,14 @@ bool MainWindow::eventFilter(QObject *watched, QEvent *event)
 void MainWindow::setupNotificationManager()
 {
     m_notificationManager = new NotificationManager(this);
+
+    // Пауза и отмена заданий вставки из уведомления
+    connect(m_notificationManager, &NotificationManager::pauseRequested,
+            fileOperations, &FileOperations::togglePauseJob);
+    connect(m_notificationManager, &NotificationManager::cancelRequested,
+            fileOperations, &FileOperations::cancelJob);
+    connect(m_notificationManager, &NotificationManager::prioritizeRequested,
+            fileOperations, &FileOperations::prioritizeJob);
 }
 
 void MainWindow::setupConnections()
@@ -428,6 +436,27 @@ connect(fileOperations, &FileOperations::finishProgressNotification,
             }
         });
 
+    connect(fileOperations, &FileOperations::jobStarted,
+        this, [this](const QString &operationId) {
+            if (m_notificationManager) {
+                m_notificationManager->enableProgressControls(operationId);
+            }
+        });
+
+    connect(fileOperations, &FileOperations::jobPausedChanged,
+        this, [this](const QString &operationId, bool paused) {
+            if (m_notificationManager) {
+                m_notificationManager->setProgressPaused(operationId, paused);
+            }
+        });
+
+    connect(fileOperations, &FileOperations::jobQueuedChanged,
+        this, [this](const QString &operationId, bool queued) {
+            if (m_notificationManager) {
+                m_notificationManager->setProgressQueued(operationId, queued);
+            }
+        });
+
 // Подключаем сигналы архиватора через новую систему
 connect(m_archiver, &Archiver::progressChanged,
         this, [this](const QString &fileName, int percent) {
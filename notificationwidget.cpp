@@ -5,6 +5,8 @@
 NotificationWidget::NotificationWidget(QWidget *parent)
     : QWidget(parent)
     , m_type(Info)
+    , m_paused(false)
+    , m_queued(false)
     , m_autoClose(false)
     , m_timeoutMs(0)
     , m_opacity(1.0f)
@@ -74,9 +76,34 @@ void NotificationWidget::setupUI()
     );
     connect(m_closeButton, &QPushButton::clicked, this, &NotificationWidget::onCloseClicked);
 
+    // Пауза и отмена - в том же стиле, скрыты до setControlsVisible
+    m_pauseButton = new QPushButton("⏸", this);
+    m_pauseButton->setFixedSize(20, 20);
+    m_pauseButton->setStyleSheet(m_closeButton->styleSheet());
+    m_pauseButton->setToolTip("Приостановить");
+    m_pauseButton->setVisible(false);
+    connect(m_pauseButton, &QPushButton::clicked, this, &NotificationWidget::pauseRequested);
+
+    m_prioritizeButton = new QPushButton("⤒", this);
+    m_prioritizeButton->setFixedSize(20, 20);
+    m_prioritizeButton->setStyleSheet(m_closeButton->styleSheet());
+    m_prioritizeButton->setToolTip("В начало очереди");
+    m_prioritizeButton->setVisible(false);
+    connect(m_prioritizeButton, &QPushButton::clicked, this, &NotificationWidget::prioritizeRequested);
+
+    m_cancelButton = new QPushButton("■", this);
+    m_cancelButton->setFixedSize(20, 20);
+    m_cancelButton->setStyleSheet(m_closeButton->styleSheet());
+    m_cancelButton->setToolTip("Отменить");
+    m_cancelButton->setVisible(false);
+    connect(m_cancelButton, &QPushButton::clicked, this, &NotificationWidget::cancelRequested);
+
     headerLayout->addWidget(m_iconLabel);
     headerLayout->addWidget(m_titleLabel);
     headerLayout->addStretch();
+    headerLayout->addWidget(m_prioritizeButton);
+    headerLayout->addWidget(m_pauseButton);
+    headerLayout->addWidget(m_cancelButton);
     headerLayout->addWidget(m_closeButton);
 
     // Сообщение
@@ -153,6 +180,33 @@ void NotificationWidget::setMessage(const QString &message)
 void NotificationWidget::setType(Type type)
 {
     m_type = type;
+    // Завершенной операцией управлять уже нельзя
+    if (m_type != Progress) {
+        setControlsVisible(false);
+    }
+    updateStyle();
+}
+
+void NotificationWidget::setControlsVisible(bool visible)
+{
+    m_pauseButton->setVisible(visible && !m_queued);
+    m_prioritizeButton->setVisible(visible && m_queued);
+    m_cancelButton->setVisible(visible);
+}
+
+void NotificationWidget::setQueued(bool queued)
+{
+    m_queued = queued;
+    if (!m_cancelButton->isHidden()) {
+        setControlsVisible(true);
+    }
+}
+
+void NotificationWidget::setPaused(bool paused)
+{
+    m_paused = paused;
+    m_pauseButton->setText(paused ? "▶" : "⏸");
+    m_pauseButton->setToolTip(paused ? "Продолжить" : "Приостановить");
     updateStyle();
 }
 
@@ -291,7 +345,7 @@ QString NotificationWidget::getIconForType() const
     case Success: return "✓";
     case Error: return "✗";
     case Warning: return "⚠";
-    case Progress: return "⟳";
+    case Progress: return m_paused ? "⏸" : "⟳";
     case Info: return "ℹ";
     default: return "";
     }
@@ -33,6 +33,11 @@ public:
     void setType(Type type);
     void setProgress(int percent); // Только для Progress типа
     void setAutoClose(bool autoClose, int timeoutMs = 5000);
+    // Кнопки паузы и отмены для операций, которые их поддерживают
+    void setControlsVisible(bool visible);
+    void setPaused(bool paused);
+    // Операция ждет в очереди: вместо паузы - кнопка "в начало очереди"
+    void setQueued(bool queued);
     void setPosition(const QPoint &position);
 
     float opacity() const { return m_opacity; }
@@ -43,6 +48,9 @@ public:
     signals:
         void closed();
     void closeRequested();
+    void pauseRequested();
+    void cancelRequested();
+    void prioritizeRequested();
 
 protected:
     void paintEvent(QPaintEvent *event) override;
@@ -62,10 +70,15 @@ private:
     QLabel *m_titleLabel;
     QLabel *m_messageLabel;
     QPushButton *m_closeButton;
+    QPushButton *m_pauseButton;
+    QPushButton *m_prioritizeButton;
+    QPushButton *m_cancelButton;
     QWidget *m_progressWidget;
     QProgressBar *m_progressBar;
 
     Type m_type;
+    bool m_paused;
+    bool m_queued;
     bool m_autoClose;
     int m_timeoutMs;
     QTimer *m_autoCloseTimer;
@@ -1,6 +1,12 @@
 #include "pasteworker.h"
+#include "thumbnailcache.h"
+#include "copyengine.h"
+#include "deviceinfo.h"
 #include <QMessageBox>
 #include <QApplication>
+#include <QDirIterator>
+#include <QJsonObject>
+#include <QtConcurrent>
 
 #ifdef Q_OS_WIN
 #include <windows.h>
@@ -11,11 +17,336 @@
 #include <aclapi.h>
 #endif
 
+namespace {
+    // Имена в папке сравниваем так же, как их сравнивает файловая система
+    QString nameKey(const QString &name)
+    {
+#if defined(Q_OS_WIN) || defined(Q_OS_MACOS)
+        return name.toLower();
+#else
+        return name;
+#endif
+    }
+}
+
 PasteWorker::PasteWorker(QObject *parent)
     : QObject(parent)
 {
 }
 
+QJsonArray PasteWorker::operationsToJson(const QList<PasteOperation> &operations)
+{
+    QJsonArray array;
+    for (const PasteOperation &op : operations) {
+        QJsonObject object;
+        object.insert("source", op.sourcePath);
+        object.insert("destination", op.destinationPath);
+        object.insert("type", op.type == Copy ? "copy" : "move");
+        object.insert("skip", op.skip);
+        object.insert("replace", op.replace);
+        object.insert("rename", op.rename);
+        object.insert("verify", op.verify);
+        object.insert("sync", op.sync);
+        object.insert("syncDeleteExtra", op.syncDeleteExtra);
+        object.insert("syncCompareContent", op.syncCompareContent);
+        array.append(object);
+    }
+    return array;
+}
+
+QList<PasteWorker::PasteOperation> PasteWorker::operationsFromJson(const QJsonArray &array)
+{
+    QList<PasteOperation> operations;
+    for (const QJsonValue &value : array) {
+        QJsonObject object = value.toObject();
+        PasteOperation op;
+        op.sourcePath = object.value("source").toString();
+        op.destinationPath = object.value("destination").toString();
+        op.type = object.value("type").toString() == "move" ? Move : Copy;
+        op.skip = object.value("skip").toBool();
+        op.replace = object.value("replace").toBool();
+        op.rename = object.value("rename").toBool();
+        op.verify = object.value("verify").toBool();
+        op.sync = object.value("sync").toBool();
+        op.syncDeleteExtra = object.value("syncDeleteExtra").toBool();
+        op.syncCompareContent = object.value("syncCompareContent").toBool();
+        operations.append(op);
+    }
+    return operations;
+}
+
+bool PasteWorker::isValidRenamePattern(const QString &pattern)
+{
+    // Разделители и ".." увели бы копию в другую папку, ':' на NTFS
+    // создал бы альтернативный поток вместо файла
+    static const QString FORBIDDEN = "/\\:*?\"<>|";
+    if (pattern.trimmed().isEmpty() || pattern.contains("..")) {
+        return false;
+    }
+    for (QChar c : pattern) {
+        if (FORBIDDEN.contains(c) || c.unicode() < 0x20) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QJsonObject PasteWorker::rulesToJson(const ConflictRules &rules)
+{
+    QJsonObject object;
+    object.insert("action", int(rules.action));
+    object.insert("skipIdentical", rules.skipIdentical);
+    object.insert("renamePattern", rules.renamePattern);
+    return object;
+}
+
+PasteWorker::ConflictRules PasteWorker::rulesFromJson(const QJsonObject &object)
+{
+    ConflictRules rules;
+    int action = object.value("action").toInt(ReplaceExisting);
+    if (action >= ReplaceExisting && action <= ReplaceIfLarger) {
+        rules.action = static_cast<ConflictAction>(action);
+    }
+    rules.skipIdentical = object.value("skipIdentical").toBool(rules.skipIdentical);
+    rules.renamePattern = object.value("renamePattern").toString(rules.renamePattern);
+    return rules;
+}
+
+void PasteWorker::setJob(const QString &id, const QString &title)
+{
+    jobId = id;
+    jobTitle = title;
+}
+
+void PasteWorker::setResumeState(const TransferJournal::State &state)
+{
+    jobId = state.jobId;
+    jobTitle = state.title;
+    resumeState = state;
+    resuming = true;
+
+    // Конфликты решены до прерывания - те же правила действуют в сливаемых папках
+    if (state.planResolved && !state.conflictRules.isEmpty()) {
+        conflictRules = rulesFromJson(state.conflictRules);
+        conflictsResolved = true;
+    }
+}
+
+void PasteWorker::pause()
+{
+    if (!paused.exchange(true)) {
+        qDebug() << "Paste job paused:" << jobId;
+        emit pausedChanged(true);
+    }
+}
+
+void PasteWorker::resume()
+{
+    QMutexLocker locker(&pauseMutex);
+    if (paused.exchange(false)) {
+        qDebug() << "Paste job resumed:" << jobId;
+        pauseCondition.wakeAll();
+        emit pausedChanged(false);
+    }
+}
+
+void PasteWorker::cancel()
+{
+    QMutexLocker locker(&pauseMutex);
+    cancelled = true;
+    pauseCondition.wakeAll();
+}
+
+void PasteWorker::resolveConflicts(const ConflictRules &rules)
+{
+    QMutexLocker locker(&pauseMutex);
+    conflictRules = rules;
+    conflictsResolved = true;
+    pauseCondition.wakeAll();
+}
+
+bool PasteWorker::checkpoint()
+{
+    if (paused && !cancelled) {
+        QMutexLocker locker(&pauseMutex);
+        while (paused && !cancelled) {
+            pauseCondition.wait(&pauseMutex);
+        }
+    }
+    return !cancelled;
+}
+
+bool PasteWorker::detectConflicts(QList<PasteOperation> &operations)
+{
+    // Каждая папка назначения читается один раз, дальше - поиск по хешу
+    // вместо обращения к диску на каждый вставляемый элемент
+    QHash<QString, QHash<QString, QFileInfo>> listings;
+    for (const PasteOperation &op : std::as_const(operations)) {
+        QString dir = QFileInfo(op.destinationPath).absolutePath();
+        if (op.skip || listings.contains(dir)) {
+            continue;
+        }
+        QHash<QString, QFileInfo> entries;
+        const QFileInfoList infos = QDir(dir).entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot |
+                                                            QDir::Hidden | QDir::System);
+        for (const QFileInfo &info : infos) {
+            entries.insert(nameKey(info.fileName()), info);
+        }
+        listings.insert(dir, entries);
+    }
+
+    QList<Conflict> conflicts;
+    QList<int> conflictIndexes;
+    for (int i = 0; i < operations.size(); ++i) {
+        const PasteOperation &op = operations[i];
+        // Синхронизация сама решает, что делать с существующими файлами
+        if (op.skip || op.sync) {
+            continue;
+        }
+        QFileInfo destPathInfo(op.destinationPath);
+        const QHash<QString, QFileInfo> &entries = listings[destPathInfo.absolutePath()];
+        auto existing = entries.constFind(nameKey(destPathInfo.fileName()));
+        if (existing == entries.constEnd()) {
+            continue;
+        }
+
+        QFileInfo srcInfo(op.sourcePath);
+        Conflict conflict;
+        conflict.sourcePath = op.sourcePath;
+        conflict.destinationPath = op.destinationPath;
+        conflict.isDir = srcInfo.isDir() && existing->isDir();
+        conflict.sourceSize = srcInfo.size();
+        conflict.destinationSize = existing->size();
+        conflict.sourceModified = srcInfo.lastModified();
+        conflict.destinationModified = existing->lastModified();
+        conflicts.append(conflict);
+        conflictIndexes.append(i);
+    }
+
+    if (conflicts.isEmpty()) {
+        return true;
+    }
+
+    qDebug() << "Paste conflicts found:" << conflicts.size() << "of" << operations.size();
+    {
+        QMutexLocker locker(&pauseMutex);
+        conflictsResolved = false;
+    }
+    emit conflictsFound(conflicts);
+    {
+        QMutexLocker locker(&pauseMutex);
+        while (!conflictsResolved && !cancelled) {
+            pauseCondition.wait(&pauseMutex);
+        }
+    }
+    if (cancelled) {
+        return false;
+    }
+
+    // Занятые имена: содержимое папок плюс то, что создаст само задание
+    QHash<QString, QSet<QString>> taken;
+    for (auto it = listings.constBegin(); it != listings.constEnd(); ++it) {
+        QSet<QString> &names = taken[it.key()];
+        for (auto entry = it.value().constBegin(); entry != it.value().constEnd(); ++entry) {
+            names.insert(entry.key());
+        }
+    }
+    for (const PasteOperation &op : std::as_const(operations)) {
+        if (!op.skip) {
+            QFileInfo info(op.destinationPath);
+            taken[info.absolutePath()].insert(nameKey(info.fileName()));
+        }
+    }
+    QHash<QString, int> nextIndex;
+
+    int skipped = 0;
+    int renamed = 0;
+    for (int k = 0; k < conflicts.size(); ++k) {
+        PasteOperation &op = operations[conflictIndexes[k]];
+        const Conflict &conflict = conflicts[k];
+        QFileInfo srcInfo(op.sourcePath);
+        QFileInfo destInfo(op.destinationPath);
+
+        ConflictAction action = conflictRules.action;
+        if (srcInfo.canonicalFilePath() == destInfo.canonicalFilePath()) {
+            // Вставка в ту же папку: копия получает новое имя, перемещать некуда
+            action = op.type == Copy ? KeepBoth : SkipExisting;
+        } else if (srcInfo.isDir() != destInfo.isDir()) {
+            // Папку файлом (и наоборот) не заменяем - только рядом или никак
+            action = action == SkipExisting ? SkipExisting : KeepBoth;
+        } else if (conflictRules.skipIdentical && conflict.identical()) {
+            action = SkipExisting;
+        } else if (conflict.isDir) {
+            // Папки сливаются, а правила проверяются уже для файлов внутри
+            action = action == ReplaceIfNewer || action == ReplaceIfLarger ? ReplaceExisting : action;
+        } else if (action == ReplaceIfNewer) {
+            action = conflict.sourceModified > conflict.destinationModified ? ReplaceExisting : SkipExisting;
+        } else if (action == ReplaceIfLarger) {
+            action = conflict.sourceSize > conflict.destinationSize ? ReplaceExisting : SkipExisting;
+        }
+
+        switch (action) {
+        case SkipExisting:
+            op.skip = true;
+            skipped++;
+            break;
+        case KeepBoth:
+            op.rename = true;
+            op.destinationPath = generateUniqueName(destInfo.absolutePath(), destInfo.fileName(),
+                                                    conflictRules.renamePattern,
+                                                    taken[destInfo.absolutePath()], nextIndex);
+            renamed++;
+            break;
+        default:
+            op.replace = true;
+            break;
+        }
+    }
+
+    qDebug() << "Conflicts resolved: skipped" << skipped << "renamed" << renamed
+             << "replaced" << conflicts.size() - skipped - renamed;
+    return true;
+}
+
+bool PasteWorker::keepsExisting(const QString &src, const QString &dest)
+{
+    if (!conflictsResolved) {
+        return false;
+    }
+
+    QFileInfo srcInfo(src);
+    QFileInfo destInfo(dest);
+    if (conflictRules.skipIdentical && srcInfo.size() == destInfo.size() &&
+        srcInfo.lastModified() == destInfo.lastModified()) {
+        return true;
+    }
+    switch (conflictRules.action) {
+    case ReplaceIfNewer:
+        return srcInfo.lastModified() <= destInfo.lastModified();
+    case ReplaceIfLarger:
+        return srcInfo.size() <= destInfo.size();
+    default:
+        return false;
+    }
+}
+
+bool PasteWorker::alreadyCopied(const QString &src, const QString &dest)
+{
+    if (!resuming) {
+        return false;
+    }
+    if (resumeState.finishedFiles.contains(src)) {
+        return true;
+    }
+
+    // Запись в журнале могла не успеть дойти до диска, но копия с тем же
+    // размером и временем изменения - законченная: время ставится последним
+    QFileInfo srcInfo(src);
+    QFileInfo destInfo(dest);
+    return destInfo.isFile() && destInfo.size() == srcInfo.size() &&
+           destInfo.lastModified() == srcInfo.lastModified();
+}
+
 void PasteWorker::startOperations(const QList<PasteOperation> &operations)
 {
     if (operations.isEmpty()) {
@@ -30,17 +361,71 @@ void PasteWorker::startOperations(const QList<PasteOperation> &operations)
     QList<PasteOperation> operationsToRetry;
     QStringList failedFiles;
 
+    // Журнал создан при постановке задания в очередь
+    if (!jobId.isEmpty()) {
+        journal.reopen(jobId);
+    }
+
+    // Выполненные до прерывания операции повторно не трогаем
+    QList<PasteOperation> pending = operations;
+    if (resuming) {
+        for (int index : std::as_const(resumeState.finishedOperations)) {
+            if (index >= 0 && index < total) {
+                pending[index].skip = true;
+            }
+        }
+    }
+
+    // Конфликты решаются до начала копирования, решенный план дописывается в журнал.
+    // Задание, прерванное еще в очереди, решает их так же, как новое
+    if (!resuming || !resumeState.planResolved) {
+        if (!detectConflicts(pending)) {
+            journal.remove();
+            emit operationCompleted(false, "Операция отменена пользователем");
+            return;
+        }
+        journal.planResolved(operationsToJson(pending),
+                             conflictsResolved ? rulesToJson(conflictRules) : QJsonObject());
+    }
+
+    verifiedFiles = 0;
+    mismatchedFiles.clear();
+    syncing = false;
+    syncCopied = 0;
+    syncUnchanged = 0;
+    syncRemoved = 0;
+
+    // Копирование начинается сразу, объем досчитывается параллельно
+    progress.reset(total);
+    scanCancelled = false;
+    QFuture<void> scan = QtConcurrent::run([this, pending]() { prescan(pending); });
+
     for (int i = 0; i < total; ++i) {
-        const PasteOperation &op = operations[i];
+        const PasteOperation &op = pending[i];
+
+        if (!checkpoint()) {
+            break;
+        }
 
         if (op.skip) {
-            emit progressChanged((i * 100) / total, QString("Пропуск: %1").arg(QFileInfo(op.sourcePath).fileName()));
+            progress.operationFinished();
+            currentAction = "Пропуск";
+            progress.setCurrentFile(op.sourcePath);
+            reportProgress(true);
             continue;
         }
 
         QString currentFile = QFileInfo(op.sourcePath).fileName();
-        emit progressChanged((i * 100) / total,
-                           QString("%1: %2").arg(op.type == Copy ? "Копирование" : "Перемещение").arg(currentFile));
+        bool sync = op.sync && op.type == Copy;
+        syncing = syncing || sync;
+        currentAction = sync ? "Синхронизация" : op.type == Copy ? "Копирование" : "Перемещение";
+        verifying = op.verify;
+        if (verifying) {
+            currentAction += " с проверкой";
+        }
+        int mismatchesBefore = mismatchCount();
+        progress.setCurrentFile(op.sourcePath);
+        reportProgress(true);
 
         bool success = false;
         QString errorReason;
@@ -48,7 +433,7 @@ void PasteWorker::startOperations(const QList<PasteOperation> &operations)
         // Выполняем операцию
         if (op.type == Copy) {
             qDebug() << "Copy operation:" << op.sourcePath << "->" << op.destinationPath;
-            success = copyRecursive(op.sourcePath, op.destinationPath);
+            success = sync ? syncTree(op) : copyRecursive(op.sourcePath, op.destinationPath);
             if (!success) {
                 errorReason = "копирование не удалось";
                 qDebug() << "Copy failed for:" << op.sourcePath << "->" << op.destinationPath;
@@ -62,14 +447,62 @@ void PasteWorker::startOperations(const QList<PasteOperation> &operations)
             }
         }
 
+        if (cancelled) {
+            break;
+        }
+
         if (success) {
             successCount++;
+            journal.operationFinished(i);
+        } else if (mismatchCount() > mismatchesBefore) {
+            // Копия испорчена при записи - права администратора тут не помогут
+            failCount++;
+            errors.append(QString("%1: контрольная сумма копии не совпала").arg(currentFile));
         } else {
             failCount++;
             errors.append(QString("%1: %2").arg(currentFile).arg(errorReason));
             operationsToRetry.append(op);
             failedFiles.append(currentFile);
         }
+        progress.operationFinished();
+    }
+
+    // Подсчет больше не нужен, если копирование закончилось раньше
+    scanCancelled = true;
+    scan.waitForFinished();
+
+    // Задание доведено до конца (или отменено) - продолжать будет нечего
+    journal.remove();
+
+    if (cancelled) {
+        emit operationCompleted(false, QString("Операция отменена, выполнено: %1").arg(successCount));
+        return;
+    }
+
+    QString syncSummary;
+    if (syncing) {
+        syncSummary = QString("скопировано новых и измененных: %1, без изменений: %2")
+                          .arg(int(syncCopied)).arg(int(syncUnchanged));
+        if (syncRemoved > 0) {
+            syncSummary += QString(", удалено лишних: %1").arg(int(syncRemoved));
+        }
+        if (verifiedFiles > 0 && failCount == 0) {
+            syncSummary += QString(", проверено файлов: %1").arg(int(verifiedFiles));
+        }
+        if (failCount > 0) {
+            errors.append("Синхронизация: " + syncSummary);
+        }
+    }
+
+    // Итоги проверки - по каждому файлу, не совпавшему с источником
+    if (verifiedFiles > 0 || mismatchCount() > 0) {
+        QMutexLocker locker(&mismatchMutex);
+        QString summary = QString("Проверено файлов: %1").arg(int(verifiedFiles));
+        if (!mismatchedFiles.isEmpty()) {
+            summary += QString(", не совпали с источником (%1): %2")
+                           .arg(mismatchedFiles.size()).arg(mismatchedFiles.join(", "));
+        }
+        errors.append(summary);
     }
 
     // Если есть неудачные операции, пытаемся выполнить их с правами администратора
@@ -96,22 +529,44 @@ void PasteWorker::startOperations(const QList<PasteOperation> &operations)
                                .arg(failCount)
                                .arg(errors.join("\n"));
         emit operationCompleted(false, errorMessage);
+    } else if (syncing) {
+        emit operationCompleted(true, QString("Синхронизация завершена: %1").arg(syncSummary));
+    } else if (verifiedFiles > 0) {
+        emit operationCompleted(true, QString("Успешно выполнено: %1 операций, проверено файлов: %2")
+                                      .arg(successCount).arg(int(verifiedFiles)));
     } else {
         emit operationCompleted(true, QString("Успешно выполнено: %1 операций").arg(successCount));
     }
 }
 
+int PasteWorker::mismatchCount()
+{
+    QMutexLocker locker(&mismatchMutex);
+    return mismatchedFiles.size();
+}
+
 bool PasteWorker::copyRecursive(const QString &src, const QString &dest)
 {
     qDebug() << "copyRecursive:" << src << "->" << dest;
 
+    // Ссылка копируется как ссылка, как и при перемещении: exists и isDir идут
+    // по ссылке, а висячая ссылка иначе обрывала бы копирование всего дерева
     QFileInfo srcInfo(src);
+    if (srcInfo.isSymbolicLink()) {
+        return copyLink(src, dest);
+    }
     if (!srcInfo.exists()) {
         qDebug() << "Source does not exist:" << src;
         return false;
     }
 
     if (srcInfo.isDir()) {
+        // Быстрые устройства - файлы копируются параллельно
+        int concurrency = DeviceInfo::copyConcurrency(src, dest);
+        if (concurrency > 1) {
+            return copyTreeParallel(src, dest, concurrency);
+        }
+
         qDebug() << "Source is directory, copying recursively";
         QDir destDir(dest);
         if (!destDir.mkpath(".")) {
@@ -120,7 +575,8 @@ bool PasteWorker::copyRecursive(const QString &src, const QString &dest)
         }
 
         QDir srcDir(src);
-        QStringList files = srcDir.entryList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot);
+        QStringList files = srcDir.entryList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot |
+                                             QDir::Hidden | QDir::System);
         qDebug() << "Directory contains" << files.size() << "items";
 
         for (const QString &file : files) {
@@ -134,19 +590,484 @@ bool PasteWorker::copyRecursive(const QString &src, const QString &dest)
         return true;
     } else {
         qDebug() << "Source is file, copying directly";
+        return copyFileWithProgress(src, dest);
+    }
+}
 
-        // Если целевой файл существует, пытаемся удалить его сначала
-        if (QFile::exists(dest)) {
-            qDebug() << "Destination file exists, attempting to remove:" << dest;
-            if (!QFile::remove(dest)) {
-                qDebug() << "Failed to remove existing destination file:" << dest;
+bool PasteWorker::copyLink(const QString &src, const QString &dest)
+{
+    QFileInfo destInfo(dest);
+    if (destInfo.exists() || destInfo.isSymbolicLink()) {
+        if (keepsExisting(src, dest)) {
+            qDebug() << "Keeping existing item by conflict rules:" << dest;
+            return true;
+        }
+        // Папку ссылкой не заменяем - ее содержимое пропало бы целиком
+        if ((destInfo.isDir() && !destInfo.isSymbolicLink()) || !QFile::remove(dest)) {
+            qDebug() << "Cannot replace existing item with symbolic link:" << dest;
+            return false;
+        }
+    }
+
+    QString error;
+    if (!CopyEngine::copySymLink(src, dest, &error)) {
+        qDebug() << "Failed to copy symbolic link:" << src << error;
+        return false;
+    }
+    // Подсчет объема видит ссылки на файлы и висячие ссылки, но не ссылки на папки
+    if (!QFileInfo(src).isDir()) {
+        progress.fileFinished();
+    }
+    reportProgress();
+    return true;
+}
+
+bool PasteWorker::copyTreeParallel(const QString &src, const QString &dest, int concurrency)
+{
+    qDebug() << "Parallel copy with" << concurrency << "workers:" << src << "->" << dest;
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(concurrency);
+
+    // Ограничиваем очередь, чтобы обход дерева из 200 тысяч файлов
+    // не набирал задачи быстрее, чем они выполняются
+    QSemaphore queueSlots(concurrency * PARALLEL_QUEUE_PER_WORKER);
+    std::atomic<bool> failed{false};
+
+    bool submitted = submitTree(src, dest, pool, queueSlots, failed);
+    pool.waitForDone();
+    return submitted && !failed;
+}
+
+bool PasteWorker::submitTree(const QString &src, const QString &dest, QThreadPool &pool,
+                             QSemaphore &queueSlots, std::atomic<bool> &failed)
+{
+    if (failed) {
+        return false;
+    }
+
+    // Папка создается до того, как в нее пойдут файлы
+    if (!QDir(dest).mkpath(".")) {
+        qDebug() << "Failed to create destination directory:" << dest;
+        return false;
+    }
+
+    const QFileInfoList entries = QDir(src).entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot |
+                                                          QDir::Hidden | QDir::System);
+    for (const QFileInfo &entry : entries) {
+        if (!checkpoint()) {
+            return false;
+        }
+        QString destPath = dest + "/" + entry.fileName();
+
+        if (entry.isSymbolicLink()) {
+            if (!copyLink(entry.filePath(), destPath)) {
+                return false;
+            }
+            continue;
+        }
+        if (entry.isDir()) {
+            if (!submitTree(entry.filePath(), destPath, pool, queueSlots, failed)) {
                 return false;
             }
+            continue;
+        }
+
+        queueSlots.acquire();
+        if (failed) {
+            queueSlots.release();
+            return false;
+        }
+
+        QString srcPath = entry.filePath();
+        pool.start([this, srcPath, destPath, &queueSlots, &failed]() {
+            if (!failed && !copyFileWithProgress(srcPath, destPath)) {
+                qDebug() << "Failed to copy:" << srcPath;
+                failed = true;
+            }
+            queueSlots.release();
+        });
+    }
+    return true;
+}
+
+bool PasteWorker::syncTree(const PasteOperation &op)
+{
+    const QString &src = op.sourcePath;
+    const QString &dest = op.destinationPath;
+    qDebug() << "syncTree:" << src << "->" << dest << "delete extra:" << op.syncDeleteExtra
+             << "compare content:" << op.syncCompareContent;
+
+    QFileInfo srcInfo(src);
+    if (!srcInfo.exists()) {
+        qDebug() << "Source does not exist:" << src;
+        return false;
+    }
+
+    // Одиночный файл сравнивается без обхода
+    if (!srcInfo.isDir()) {
+        QFileInfo destInfo(dest);
+        SyncEntry source{srcInfo.fileName(), srcInfo.size(), srcInfo.lastModified(), false};
+        SyncEntry destination{destInfo.fileName(), destInfo.size(), destInfo.lastModified(), false};
+        if (destInfo.isFile() && (op.syncCompareContent ? source.size == destination.size && sameContent(src, dest)
+                                                        : sameStamp(source, destination))) {
+            syncUnchanged++;
+            progress.addBytes(source.size);
+            progress.fileFinished();
+            reportProgress();
+            return true;
+        }
+        if (destInfo.isDir() && !(op.syncDeleteExtra && removeExtra(dest))) {
+            qDebug() << "Destination is a directory, cannot sync file:" << dest;
+            return false;
+        }
+        if (!copyFileWithProgress(src, dest)) {
+            return false;
+        }
+        syncCopied++;
+        return true;
+    }
+
+    // Оба дерева читаются одновременно: источник и копия обычно на разных дисках
+    QHash<QString, SyncEntry> sourceEntries;
+    QHash<QString, SyncEntry> destinationEntries;
+    QFuture<void> destinationScan = QtConcurrent::run([this, &dest, &destinationEntries]() {
+        scanSyncTree(dest, destinationEntries);
+    });
+    scanSyncTree(src, sourceEntries);
+    destinationScan.waitForFinished();
+    if (!checkpoint()) {
+        return false;
+    }
+    qDebug() << "Sync scan:" << sourceEntries.size() << "source entries," << destinationEntries.size()
+             << "destination entries";
+
+    bool ok = true;
+    QStringList directoriesToCreate;
+    QStringList filesToCopy;
+    QStringList filesToCompare;
+    for (auto it = sourceEntries.constBegin(); it != sourceEntries.constEnd(); ++it) {
+        const SyncEntry &entry = it.value();
+        auto existing = destinationEntries.constFind(it.key());
+
+        // Файл на месте папки (или наоборот) заменяем, только если разрешено удалять
+        if (existing != destinationEntries.constEnd() && existing->isDir != entry.isDir) {
+            if (!op.syncDeleteExtra || !removeExtra(dest + "/" + existing->relativePath)) {
+                qDebug() << "Sync type mismatch, skipped:" << entry.relativePath;
+                ok = false;
+                continue;
+            }
+            existing = destinationEntries.constEnd();
         }
 
-        bool result = QFile::copy(src, dest);
-        qDebug() << "File copy result:" << result;
-        return result;
+        if (entry.isDir) {
+            if (existing == destinationEntries.constEnd()) {
+                directoriesToCreate.append(entry.relativePath);
+            }
+        } else if (existing == destinationEntries.constEnd()) {
+            filesToCopy.append(entry.relativePath);
+        } else if (op.syncCompareContent) {
+            // Разный размер - разное содержимое, читать незачем
+            if (entry.size == existing->size) {
+                filesToCompare.append(entry.relativePath);
+            } else {
+                filesToCopy.append(entry.relativePath);
+            }
+        } else if (sameStamp(entry, *existing)) {
+            syncUnchanged++;
+            progress.addBytes(entry.size);
+            progress.fileFinished();
+        } else {
+            filesToCopy.append(entry.relativePath);
+        }
+    }
+    reportProgress();
+
+    int concurrency = qMax(1, DeviceInfo::copyConcurrency(src, dest));
+    QThreadPool pool;
+    pool.setMaxThreadCount(concurrency);
+
+    // Содержимое сверяется параллельно, как и копирование
+    if (!filesToCompare.isEmpty()) {
+        qDebug() << "Sync comparing content of" << filesToCompare.size() << "files";
+        QMutex changedMutex;
+        for (const QString &relative : std::as_const(filesToCompare)) {
+            pool.start([this, &src, &dest, relative, &changedMutex, &filesToCopy]() {
+                QString from = src + "/" + relative;
+                if (!cancelled && !sameContent(from, dest + "/" + relative)) {
+                    QMutexLocker locker(&changedMutex);
+                    filesToCopy.append(relative);
+                    return;
+                }
+                syncUnchanged++;
+                progress.addBytes(QFileInfo(from).size());
+                progress.fileFinished();
+                reportProgress();
+            });
+        }
+        pool.waitForDone();
+        if (!checkpoint()) {
+            return false;
+        }
+    }
+
+    // Папки - по порядку, родитель раньше вложенных
+    directoriesToCreate.sort();
+    for (const QString &relative : std::as_const(directoriesToCreate)) {
+        if (!QDir(dest + "/" + relative).mkpath(".")) {
+            qDebug() << "Failed to create destination directory:" << relative;
+            ok = false;
+        }
+    }
+    if (!QDir(dest).mkpath(".")) {
+        qDebug() << "Failed to create destination directory:" << dest;
+        return false;
+    }
+
+    qDebug() << "Sync copying" << filesToCopy.size() << "new and changed files";
+    std::atomic<bool> failed{false};
+    for (const QString &relative : std::as_const(filesToCopy)) {
+        if (!checkpoint()) {
+            break;
+        }
+        pool.start([this, &src, &dest, relative, &failed]() {
+            if (copyFileWithProgress(src + "/" + relative, dest + "/" + relative)) {
+                syncCopied++;
+            } else if (!cancelled) {
+                qDebug() << "Failed to sync:" << relative;
+                failed = true;
+            }
+        });
+    }
+    pool.waitForDone();
+    if (!checkpoint()) {
+        return false;
+    }
+
+    // Лишнее удаляем верхним элементом: папка целиком, без обхода ее содержимого
+    if (op.syncDeleteExtra) {
+        for (auto it = destinationEntries.constBegin(); it != destinationEntries.constEnd(); ++it) {
+            if (sourceEntries.contains(it.key())) {
+                continue;
+            }
+            int slash = it.key().lastIndexOf('/');
+            if (slash >= 0 && !sourceEntries.contains(it.key().left(slash))) {
+                continue;
+            }
+            // Уже убран вместе с папкой на месте файла источника
+            QString extra = dest + "/" + it.value().relativePath;
+            if (!QFileInfo::exists(extra)) {
+                continue;
+            }
+            if (!removeExtra(extra)) {
+                ok = false;
+            }
+        }
+    }
+
+    return ok && !failed;
+}
+
+void PasteWorker::scanSyncTree(const QString &root, QHash<QString, SyncEntry> &entries)
+{
+    const int prefixLength = root.size() + 1;
+    QDirIterator it(root, QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext() && !cancelled) {
+        it.next();
+        QFileInfo info = it.fileInfo();
+        SyncEntry entry;
+        entry.relativePath = info.filePath().mid(prefixLength);
+        entry.size = info.size();
+        entry.modified = info.lastModified();
+        entry.isDir = info.isDir();
+        entries.insert(nameKey(entry.relativePath), entry);
+    }
+}
+
+bool PasteWorker::sameStamp(const SyncEntry &source, const SyncEntry &destination) const
+{
+    return source.size == destination.size &&
+           qAbs(source.modified.msecsTo(destination.modified)) <= SYNC_TIME_TOLERANCE_MS;
+}
+
+bool PasteWorker::sameContent(const QString &src, const QString &dest)
+{
+    // Источник и копия читаются одновременно - каждый со своего диска
+    auto onProgress = [this](qint64) { return checkpoint(); };
+    quint64 destinationChecksum = 0;
+    QFuture<bool> destinationRead = QtConcurrent::run([&dest, &destinationChecksum, &onProgress]() {
+        return CopyEngine::checksum(dest, destinationChecksum, CopyEngine::FromDisk, onProgress);
+    });
+    // Источник только читается: сброс на диск и вытеснение из кэша ему не нужны,
+    // а открытый другой программой файл должен читаться
+    quint64 sourceChecksum = 0;
+    bool sourceRead = CopyEngine::checksum(src, sourceChecksum, CopyEngine::Cached, onProgress);
+    bool same = destinationRead.result() && sourceRead && sourceChecksum == destinationChecksum;
+    if (!same && sourceRead) {
+        qDebug() << "Sync content differs:" << src;
+    }
+    return same;
+}
+
+bool PasteWorker::removeExtra(const QString &path)
+{
+    // Сначала в корзину; на томах без нее (съемные диски) - удаляем
+    if (QFile::moveToTrash(path)) {
+        qDebug() << "Sync moved extra item to trash:" << path;
+        syncRemoved++;
+        return true;
+    }
+
+    bool removed = QFileInfo(path).isDir() ? QDir(path).removeRecursively() : QFile::remove(path);
+    qDebug() << "Sync removed extra item:" << path << removed;
+    if (removed) {
+        syncRemoved++;
+    }
+    return removed;
+}
+
+bool PasteWorker::copyFileWithProgress(const QString &src, const QString &dest)
+{
+    if (!checkpoint()) {
+        return false;
+    }
+    progress.setCurrentFile(src);
+
+    // Скопированное до прерывания не копируем повторно
+    if (alreadyCopied(src, dest)) {
+        qDebug() << "Already copied before interruption:" << src;
+        progress.addBytes(QFileInfo(src).size());
+        progress.fileFinished();
+        reportProgress();
+        return true;
+    }
+
+    // Докопировать можно, только если источник с тех пор не менялся;
+    // иначе недописанная копия собрана из двух разных версий файла
+    QFileInfo srcInfo(src);
+    TransferJournal::PartialFile partial;
+    partial.sourceSize = srcInfo.size();
+    partial.sourceModified = srcInfo.lastModified().toMSecsSinceEpoch();
+    qint64 offset = 0;
+    bool stalePartial = false;
+    if (resuming && resumeState.partialFiles.contains(src)) {
+        const TransferJournal::PartialFile recorded = resumeState.partialFiles.value(src);
+        if (recorded.sourceSize == partial.sourceSize && recorded.sourceModified == partial.sourceModified) {
+            offset = recorded.offset;
+        } else {
+            qDebug() << "Source changed since interruption, copying from the start:" << src;
+            stalePartial = true;
+        }
+    }
+
+    if (offset > 0) {
+        qDebug() << "Resuming" << src << "from" << offset;
+        progress.addBytes(offset);
+    } else if (QFile::exists(dest)) {
+        if (!stalePartial && keepsExisting(src, dest)) {
+            qDebug() << "Keeping existing file by conflict rules:" << dest;
+            progress.addBytes(QFileInfo(src).size());
+            progress.fileFinished();
+            reportProgress();
+            return true;
+        }
+        // Если целевой файл существует, пытаемся удалить его сначала
+        qDebug() << "Destination file exists, attempting to remove:" << dest;
+        if (!QFile::remove(dest)) {
+            qDebug() << "Failed to remove existing destination file:" << dest;
+            return false;
+        }
+    }
+
+    qint64 copied = offset;
+    qint64 recorded = offset;
+    auto onProgress = [this, &src, &dest, &copied, &recorded, &partial](qint64 bytes) {
+        progress.addBytes(bytes);
+        copied += bytes;
+        // Смещение отмечаем, только когда скопированное до него уже на диске
+        if (copied - recorded >= PARTIAL_RECORD_BYTES && journal.isOpen() && CopyEngine::flushFile(dest)) {
+            partial.offset = copied;
+            journal.filePartial(src, partial);
+            recorded = copied;
+        }
+        reportProgress();
+        return checkpoint();
+    };
+
+    CopyEngine::Result result = offset > 0 ? CopyEngine::resumeFile(src, dest, offset, onProgress, verifying)
+                                           : CopyEngine::copyFile(src, dest, onProgress, verifying);
+    if (!result.success) {
+        qDebug() << "File copy failed:" << result.error;
+        if (result.mismatch) {
+            QMutexLocker locker(&mismatchMutex);
+            mismatchedFiles.append(src);
+        }
+        return false;
+    }
+    if (result.verified) {
+        verifiedFiles++;
+    }
+
+    qDebug() << "File copied via" << CopyEngine::methodName(result.method) << result.bytesCopied << "bytes";
+    // Отметка попадает в журнал с пачкой, после сброса данных пачки на диск
+    journal.fileFinished(src, dest);
+    progress.fileFinished();
+    reportProgress();
+    return true;
+}
+
+void PasteWorker::reportProgress(bool force)
+{
+    if (progress.shouldReport(force)) {
+        emit progressChanged(progress.percent(), progress.describe(currentAction));
+    }
+}
+
+void PasteWorker::prescan(const QList<PasteOperation> &operations)
+{
+    for (const PasteOperation &op : operations) {
+        if (scanCancelled) {
+            return;
+        }
+        if (op.skip) {
+            continue;
+        }
+
+        // Перемещение в пределах тома - переименование, данные не переносятся
+        if (op.type == Move && DeviceInfo::sameDevice(op.sourcePath, QFileInfo(op.destinationPath).absolutePath())) {
+            continue;
+        }
+
+        qint64 bytes = 0;
+        int files = 0;
+        scanTree(op.sourcePath, bytes, files);
+        progress.addTotals(bytes, files);
+    }
+
+    if (!scanCancelled) {
+        progress.setTotalsKnown();
+        qDebug() << "Prescan finished";
+    }
+}
+
+void PasteWorker::scanTree(const QString &path, qint64 &bytes, int &files)
+{
+    QFileInfo info(path);
+    if (!info.isDir()) {
+        bytes += info.size();
+        files++;
+        return;
+    }
+
+    QDirIterator it(path, QDir::Files | QDir::Hidden | QDir::System, QDirIterator::Subdirectories);
+    while (it.hasNext() && !scanCancelled) {
+        it.next();
+        // Ссылка копируется сама, данные цели не переносятся
+        if (!it.fileInfo().isSymbolicLink()) {
+            bytes += it.fileInfo().size();
+        }
+        files++;
     }
 }
 
@@ -154,45 +1075,190 @@ bool PasteWorker::moveRecursive(const QString &src, const QString &dest)
 {
     qDebug() << "moveRecursive:" << src << "->" << dest;
 
-    // Сначала копируем
-    if (copyRecursive(src, dest)) {
-        qDebug() << "Copy successful, now removing source";
-
-        // Затем удаляем исходник
-        QFileInfo srcInfo(src);
-        if (srcInfo.isDir()) {
-            QDir srcDir(src);
-            bool removeResult = srcDir.removeRecursively();
-            qDebug() << "Directory remove result:" << removeResult;
-            return removeResult;
-        } else {
-            bool removeResult = QFile::remove(src);
-            qDebug() << "File remove result:" << removeResult;
-            return removeResult;
+    // Символическая ссылка перемещается сама, а не то, на что она указывает:
+    // isDir и exists идут по ссылке, поэтому проверяем ее первой
+    QFileInfo srcInfo(src);
+    const bool isLink = srcInfo.isSymbolicLink();
+    const bool isDir = srcInfo.isDir() && !isLink;
+    if (!srcInfo.exists() && !isLink) {
+        // Перемещение прервалось после удаления исходника - элемент уже на месте
+        if (resuming && QFileInfo::exists(dest)) {
+            return true;
         }
+        qDebug() << "Source does not exist:" << src;
+        return false;
     }
 
-    qDebug() << "Copy failed, move operation aborted";
-    return false;
+    // Файл скопирован до прерывания, но исходник удалить не успели
+    if (!isDir && !isLink && alreadyCopied(src, dest)) {
+        qDebug() << "Finishing interrupted move:" << src;
+        qint64 originalModified = srcInfo.lastModified().toSecsSinceEpoch();
+        qint64 originalSize = srcInfo.size();
+        if (!QFile::remove(src)) {
+            qDebug() << "Failed to remove source after copy:" << src;
+            return false;
+        }
+        ThumbnailCache::instance().moveThumbnail(src, originalModified, originalSize, dest);
+        return true;
+    }
+
+    // Папка назначения уже есть - сливаем, перемещая элементы по одному
+    QFileInfo destInfo(dest);
+    const bool destExists = destInfo.exists() || destInfo.isSymbolicLink();
+    if (isDir && destInfo.isDir() && !destInfo.isSymbolicLink()) {
+        return moveDirectoryContents(src, dest);
+    }
+
+    // Перенос на другой том прервался посреди файла - продолжаем с места остановки
+    if (!isDir && !isLink && resuming && resumeState.partialFiles.contains(src) && destExists) {
+        return moveFileAcrossDevices(src, dest);
+    }
+
+    // Файл в сливаемой папке, который правила конфликтов велят оставить:
+    // исходник тоже остается на месте, как при копировании
+    if (!isDir && destExists && keepsExisting(src, dest)) {
+        qDebug() << "Keeping existing file by conflict rules, source kept:" << dest;
+        return true;
+    }
+
+    // Заменяемый файл (или ссылку) удаляем, как при копировании
+    if (!isDir && destExists) {
+        qDebug() << "Destination file exists, attempting to remove:" << dest;
+        if (!QFile::remove(dest)) {
+            qDebug() << "Failed to remove existing destination file:" << dest;
+            return false;
+        }
+    }
+
+    // Отметка исходного файла - по ней миниатюра переедет вместе с ним
+    qint64 originalModified = srcInfo.lastModified().toSecsSinceEpoch();
+    qint64 originalSize = srcInfo.size();
+
+    // Тот же том - одно переименование, независимо от размера
+    QString error;
+    CopyEngine::RenameStatus status = CopyEngine::rename(src, dest, &error);
+    if (status == CopyEngine::Renamed) {
+        qDebug() << "Moved by rename";
+        if (!isDir && !isLink) {
+            ThumbnailCache::instance().moveThumbnail(src, originalModified, originalSize, dest);
+        }
+        return true;
+    }
+    if (status == CopyEngine::RenameFailed) {
+        qDebug() << "Rename failed:" << error;
+        return false;
+    }
+
+    // Другой том: файл за файлом, каждый исходник удаляется сразу после проверки копии
+    qDebug() << "Cross-device move, copying file by file";
+    if (isLink) {
+        QString linkError;
+        if (!CopyEngine::copySymLink(src, dest, &linkError)) {
+            qDebug() << "Failed to recreate symbolic link:" << dest << linkError;
+            return false;
+        }
+        return QFile::remove(src);
+    }
+    if (isDir) {
+        if (!QDir(dest).mkpath(".")) {
+            qDebug() << "Failed to create destination directory:" << dest;
+            return false;
+        }
+        return moveDirectoryContents(src, dest);
+    }
+    return moveFileAcrossDevices(src, dest);
+}
+
+bool PasteWorker::moveDirectoryContents(const QString &src, const QString &dest)
+{
+    // Скрытые и системные файлы тоже, иначе исходную папку не удалить
+    QDir srcDir(src);
+    const QStringList entries = srcDir.entryList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot |
+                                                 QDir::Hidden | QDir::System);
+
+    for (const QString &entry : entries) {
+        if (!checkpoint()) {
+            return false;
+        }
+        if (!moveRecursive(src + "/" + entry, dest + "/" + entry)) {
+            qDebug() << "Failed to move sub-item:" << entry;
+            return false;
+        }
+    }
+
+    // В папке остались только файлы, оставленные правилами конфликтов, -
+    // ее не удаляем, перемещение при этом успешно
+    if (!srcDir.isEmpty(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System)) {
+        qDebug() << "Source directory kept, it still holds skipped items:" << src;
+        return true;
+    }
+
+    // Все перемещено - остается пустая папка
+    bool removeResult = QDir().rmdir(src);
+    qDebug() << "Source directory remove result:" << removeResult;
+    return removeResult;
+}
+
+bool PasteWorker::moveFileAcrossDevices(const QString &src, const QString &dest)
+{
+    QFileInfo srcInfo(src);
+    qint64 originalModified = srcInfo.lastModified().toSecsSinceEpoch();
+    qint64 originalSize = srcInfo.size();
+
+    if (!copyFileWithProgress(src, dest)) {
+        return false;
+    }
+
+    // Исходник удаляем, только убедившись, что копия полная
+    QFileInfo destInfo(dest);
+    if (!destInfo.exists() || destInfo.size() != originalSize) {
+        qDebug() << "Copy verification failed:" << dest << destInfo.size() << "of" << originalSize;
+        QFile::remove(dest);
+        return false;
+    }
+
+    // Копия должна быть на диске раньше, чем исчезнет исходник
+    QString flushError;
+    if (!CopyEngine::flushFile(dest, &flushError)) {
+        qDebug() << "Cannot flush moved file, source kept:" << dest << flushError;
+        return false;
+    }
+
+    if (!QFile::remove(src)) {
+        qDebug() << "Failed to remove source after copy:" << src;
+        return false;
+    }
+
+    ThumbnailCache::instance().moveThumbnail(src, originalModified, originalSize, dest);
+    return true;
 }
 
-QString PasteWorker::generateUniqueName(const QString &dir, const QString &fileName)
+QString PasteWorker::generateUniqueName(const QString &dir, const QString &fileName, const QString &pattern,
+                                        QSet<QString> &taken, QHash<QString, int> &nextIndex)
 {
     QFileInfo fileInfo(fileName);
     QString baseName = fileInfo.completeBaseName();
-    QString extension = fileInfo.suffix();
-    QString newName = fileName;
+    QString extension = fileInfo.suffix().isEmpty() ? QString() : "." + fileInfo.suffix();
+    if (baseName.isEmpty()) {
+        // ".gitignore" - расширения нет, это все имя
+        baseName = fileName;
+        extension.clear();
+    }
+    QString effectivePattern = pattern.contains("{n}") && isValidRenamePattern(pattern)
+                                   ? pattern : ConflictRules().renamePattern;
 
-    int counter = 1;
-    while (QFile::exists(dir + "/" + newName)) {
-        if (extension.isEmpty()) {
-            newName = QString("%1 (%2)").arg(baseName).arg(counter);
-        } else {
-            newName = QString("%1 (%2).%3").arg(baseName).arg(counter).arg(extension);
-        }
+    // Тысяча копий одного имени не перебирает заново уже выданные номера
+    QString counterKey = dir + "/" + nameKey(fileName);
+    int counter = nextIndex.value(counterKey, 1);
+    QString newName;
+    do {
+        newName = effectivePattern;
+        newName.replace("{name}", baseName).replace("{ext}", extension).replace("{n}", QString::number(counter));
         counter++;
-    }
+    } while (taken.contains(nameKey(newName)));
 
+    nextIndex.insert(counterKey, counter);
+    taken.insert(nameKey(newName));
     return dir + "/" + newName;
 }
 
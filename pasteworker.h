@@ -9,6 +9,18 @@
 #include <QFile>
 #include <QTemporaryFile>
 #include <QTextStream>
+#include <QThreadPool>
+#include <QSemaphore>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QDateTime>
+#include <QHash>
+#include <QSet>
+#include <atomic>
+#include "transferprogress.h"
+#include "transferjournal.h"
 
 #ifdef Q_OS_WIN
 #include <windows.h>
@@ -34,24 +46,163 @@ public:
         bool skip = false;
         bool replace = false;
         bool rename = false;
+        bool verify = false;    // Сверять копии с источником по контрольной сумме
+        bool sync = false;      // Копировать только новые и измененные файлы
+        bool syncDeleteExtra = false;       // Удалять в назначении то, чего нет в источнике
+        bool syncCompareContent = false;    // Сравнивать содержимое, а не размер и время
+    };
+
+    // Что делать с элементом, который уже есть в папке назначения
+    enum ConflictAction {
+        ReplaceExisting,
+        SkipExisting,
+        KeepBoth,
+        ReplaceIfNewer,
+        ReplaceIfLarger
+    };
+
+    // Правила применяются ко всем конфликтам задания сразу
+    struct ConflictRules {
+        ConflictAction action = ReplaceExisting;
+        bool skipIdentical = true;
+        QString renamePattern = "{name} ({n}){ext}";
+    };
+
+    struct Conflict {
+        QString sourcePath;
+        QString destinationPath;
+        bool isDir = false;
+        qint64 sourceSize = 0;
+        qint64 destinationSize = 0;
+        QDateTime sourceModified;
+        QDateTime destinationModified;
+
+        // Совпадают размер и время изменения - копировать незачем
+        bool identical() const {
+            return !isDir && sourceSize == destinationSize && sourceModified == destinationModified;
+        }
     };
 
 #ifdef Q_OS_WIN
     static bool tryAdminOperations(const QList<PasteOperation> &operations, QStringList &errors);
 #endif
 
+    // План задания в журнале
+    static QJsonArray operationsToJson(const QList<PasteOperation> &operations);
+    static QList<PasteOperation> operationsFromJson(const QJsonArray &array);
+    // Шаблон нового имени задает только имя в той же папке
+    static bool isValidRenamePattern(const QString &pattern);
+    static QJsonObject rulesToJson(const ConflictRules &rules);
+    static ConflictRules rulesFromJson(const QJsonObject &object);
+
+    // Задание с журналом: новое (журнал с планом уже создан при постановке
+    // в очередь) или продолжение прерванного. Без вызова операции
+    // выполняются без журнала
+    void setJob(const QString &jobId, const QString &title);
+    void setResumeState(const TransferJournal::State &state);
+
+    // Вызываются из потока интерфейса, пока воркер занят startOperations
+    void pause();
+    void resume();
+    void cancel();
+    bool isPaused() const { return paused; }
+    // Ответ на conflictsFound; задание ждет его, не начиная копирование
+    void resolveConflicts(const ConflictRules &rules);
+
 public slots:
     void startOperations(const QList<PasteOperation> &operations);
 
     signals:
         void progressChanged(int value, const QString &currentFile);
+    void pausedChanged(bool paused);
     void operationCompleted(bool success, const QString &message);
     void errorOccurred(const QString &error);
     void adminRightsRequired(const QList<PasteOperation> &operations, const QStringList &errorFiles);
+    void conflictsFound(const QList<PasteWorker::Conflict> &conflicts);
 
 private:
     bool copyRecursive(const QString &src, const QString &dest);
     bool moveRecursive(const QString &src, const QString &dest);
-    QString generateUniqueName(const QString &dir, const QString &fileName);
+    bool moveDirectoryContents(const QString &src, const QString &dest);
+    bool moveFileAcrossDevices(const QString &src, const QString &dest);
+    bool copyFileWithProgress(const QString &src, const QString &dest);
+    // Символическая ссылка воссоздается в назначении, цель не копируется
+    bool copyLink(const QString &src, const QString &dest);
+
+    // Параллельное копирование дерева: папки создаются по порядку, файлы
+    // копирует пул с ограничением по устройствам
+    bool copyTreeParallel(const QString &src, const QString &dest, int concurrency);
+    bool submitTree(const QString &src, const QString &dest, QThreadPool &pool,
+                    QSemaphore &queueSlots, std::atomic<bool> &failed);
+
+    // Предварительный подсчет объема, идет параллельно с копированием
+    void prescan(const QList<PasteOperation> &operations);
+    void scanTree(const QString &path, qint64 &bytes, int &files);
+    void reportProgress(bool force = false);
+
+    // Конфликты имен по одному чтению каждой папки назначения; false - задание отменено
+    bool detectConflicts(QList<PasteOperation> &operations);
+
+    // Синхронизация: оба дерева сканируются параллельно, копируется только
+    // новое и измененное
+    struct SyncEntry {
+        QString relativePath;
+        qint64 size = 0;
+        QDateTime modified;
+        bool isDir = false;
+    };
+    bool syncTree(const PasteOperation &op);
+    void scanSyncTree(const QString &root, QHash<QString, SyncEntry> &entries);
+    bool sameStamp(const SyncEntry &source, const SyncEntry &destination) const;
+    bool sameContent(const QString &src, const QString &dest);
+    bool removeExtra(const QString &path);
+
+    // Файл в сливаемой при копировании папке, который правила велят оставить
+    bool keepsExisting(const QString &src, const QString &dest);
+
+    // Ждет, пока задание на паузе; false - задание отменено
+    bool checkpoint();
+    // При продолжении: файл уже скопирован до прерывания
+    bool alreadyCopied(const QString &src, const QString &dest);
+    int mismatchCount();
+
+    TransferProgress progress;
+    QString currentAction;
+
+    // Проверка копий текущей операции и ее итоги по всему заданию
+    bool verifying = false;
+    std::atomic<int> verifiedFiles{0};
+    QMutex mismatchMutex;
+    QStringList mismatchedFiles;
+    std::atomic<bool> scanCancelled{false};
+
+    // Итоги синхронизации по всему заданию
+    bool syncing = false;
+    std::atomic<int> syncCopied{0};
+    std::atomic<int> syncUnchanged{0};
+    std::atomic<int> syncRemoved{0};
+
+    TransferJournal journal;
+    QString jobId;
+    QString jobTitle;
+    TransferJournal::State resumeState;
+    bool resuming = false;
+
+    QMutex pauseMutex;
+    QWaitCondition pauseCondition;
+    std::atomic<bool> paused{false};
+    std::atomic<bool> cancelled{false};
+    bool conflictsResolved = false;
+    ConflictRules conflictRules;
+
+    const int PARALLEL_QUEUE_PER_WORKER = 64;
+    // FAT хранит время с точностью до 2 секунд - точнее сравнивать нельзя
+    const qint64 SYNC_TIME_TOLERANCE_MS = 2000;
+    // Как часто отмечать в журнале, докуда скопирован большой файл
+    const qint64 PARTIAL_RECORD_BYTES = 64LL * 1024 * 1024;
+    // Свободное имя по шаблону; занятые имена уже собраны в taken, а счетчик
+    // продолжается с последнего выданного номера для того же имени
+    QString generateUniqueName(const QString &dir, const QString &fileName, const QString &pattern,
+                               QSet<QString> &taken, QHash<QString, int> &nextIndex);
     bool hasWriteAccess(const QString &path);
 };
\ No newline at end of file
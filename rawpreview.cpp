@@ -0,0 +1,259 @@
+#include "rawpreview.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QTransform>
+#include <QtEndian>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+    // Ограничения, защищающие от поврежденных и зацикленных IFD
+    const int MAX_IFD_ENTRIES = 1024;
+    const int MAX_IFD_COUNT = 64;
+    const int MAX_IFD_DEPTH = 4;
+    const int MAX_SUB_IFDS = 16;
+    const qint64 MAX_PREVIEW_BYTES = 64LL * 1024 * 1024;
+
+    // Теги TIFF/EXIF
+    const quint16 TAG_NEW_SUBFILE_TYPE = 0x00FE;
+    const quint16 TAG_COMPRESSION = 0x0103;
+    const quint16 TAG_STRIP_OFFSETS = 0x0111;
+    const quint16 TAG_ORIENTATION = 0x0112;
+    const quint16 TAG_STRIP_BYTE_COUNTS = 0x0117;
+    const quint16 TAG_SUB_IFDS = 0x014A;
+    const quint16 TAG_JPEG_OFFSET = 0x0201;
+    const quint16 TAG_JPEG_LENGTH = 0x0202;
+
+    const quint16 TYPE_SHORT = 3;
+
+    quint16 read16(const uchar* data, bool bigEndian)
+    {
+        return bigEndian ? qFromBigEndian<quint16>(data) : qFromLittleEndian<quint16>(data);
+    }
+
+    quint32 read32(const uchar* data, bool bigEndian)
+    {
+        return bigEndian ? qFromBigEndian<quint32>(data) : qFromLittleEndian<quint32>(data);
+    }
+}
+
+const QStringList& RawPreview::supportedSuffixes()
+{
+    // Форматы на базе TIFF, в которых есть IFD с JPEG-превью
+    static const QStringList suffixes = {
+        "raw", "nef", "nrw", "cr2", "arw", "srf", "sr2", "dng", "pef", "orf", "rw2", "srw", "erf", "3fr"
+    };
+    return suffixes;
+}
+
+bool RawPreview::isRawFile(const QString& filePath)
+{
+    return supportedSuffixes().contains(QFileInfo(filePath).suffix().toLower());
+}
+
+void RawPreview::parseIfd(QFile& file, bool bigEndian, quint32 offset, int depth,
+                          QList<quint32>& visited, QList<Candidate>& candidates, int* orientation)
+{
+    if (depth > MAX_IFD_DEPTH) {
+        return;
+    }
+
+    while (offset != 0 && !visited.contains(offset) && visited.size() < MAX_IFD_COUNT) {
+        visited.append(offset);
+
+        if (!file.seek(offset)) {
+            return;
+        }
+
+        QByteArray countBytes = file.read(2);
+        if (countBytes.size() < 2) {
+            return;
+        }
+
+        int count = read16(reinterpret_cast<const uchar*>(countBytes.constData()), bigEndian);
+        if (count == 0 || count > MAX_IFD_ENTRIES) {
+            return;
+        }
+
+        // Все записи каталога и смещение следующего IFD - одним чтением
+        QByteArray entries = file.read(count * 12 + 4);
+        if (entries.size() < count * 12) {
+            return;
+        }
+        const uchar* data = reinterpret_cast<const uchar*>(entries.constData());
+
+        quint32 jpegOffset = 0, jpegLength = 0;
+        quint32 compression = 0, subfileType = 0;
+        quint32 stripOffset = 0, stripLength = 0, stripCount = 0;
+        QList<quint32> subIfds;
+
+        for (int i = 0; i < count; ++i) {
+            const uchar* entry = data + i * 12;
+            quint16 tag = read16(entry, bigEndian);
+            quint16 type = read16(entry + 2, bigEndian);
+            quint32 valueCount = read32(entry + 4, bigEndian);
+
+            // Первое значение хранится прямо в записи
+            quint32 value = type == TYPE_SHORT ? read16(entry + 8, bigEndian) : read32(entry + 8, bigEndian);
+
+            switch (tag) {
+            case TAG_JPEG_OFFSET:
+                jpegOffset = value;
+                break;
+            case TAG_JPEG_LENGTH:
+                jpegLength = value;
+                break;
+            case TAG_COMPRESSION:
+                compression = value;
+                break;
+            case TAG_NEW_SUBFILE_TYPE:
+                subfileType = value;
+                break;
+            case TAG_STRIP_OFFSETS:
+                stripOffset = value;
+                stripCount = valueCount;
+                break;
+            case TAG_STRIP_BYTE_COUNTS:
+                stripLength = value;
+                break;
+            case TAG_ORIENTATION:
+                if (orientation) {
+                    *orientation = int(value);
+                }
+                break;
+            case TAG_SUB_IFDS:
+                if (valueCount == 1) {
+                    subIfds.append(value);
+                } else if (valueCount > 1 && valueCount <= quint32(MAX_SUB_IFDS)) {
+                    // Несколько смещений хранятся отдельно
+                    qint64 position = file.pos();
+                    if (file.seek(value)) {
+                        QByteArray offsets = file.read(valueCount * 4);
+                        const uchar* offsetData = reinterpret_cast<const uchar*>(offsets.constData());
+                        for (int j = 0; j + 4 <= offsets.size(); j += 4) {
+                            subIfds.append(read32(offsetData + j, bigEndian));
+                        }
+                    }
+                    file.seek(position);
+                }
+                break;
+            default:
+                break;
+            }
+        }
+
+        if (jpegOffset != 0 && jpegLength != 0) {
+            candidates.append({jpegOffset, jpegLength});
+        }
+
+        // Превью, записанное одной полосой JPEG (NEF, DNG, ARW). Сжатие 7 - это
+        // lossless JPEG самих RAW-данных, его берем только для уменьшенных копий
+        bool jpegStrip = compression == 6 || (compression == 7 && subfileType == 1);
+        if (jpegStrip && stripCount == 1 && stripOffset != 0 && stripLength != 0) {
+            candidates.append({stripOffset, stripLength});
+        }
+
+        for (quint32 subIfd : subIfds) {
+            parseIfd(file, bigEndian, subIfd, depth + 1, visited, candidates, nullptr);
+        }
+
+        // Ориентация берется только из IFD0
+        orientation = nullptr;
+
+        if (entries.size() < count * 12 + 4) {
+            return;
+        }
+        offset = read32(data + count * 12, bigEndian);
+    }
+}
+
+QImage RawPreview::decodeLargestJpeg(const QString& filePath, const std::function<QImage(QByteArray&)>& decode,
+                                     int* orientation)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QImage();
+    }
+
+    QByteArray header = file.read(8);
+    if (header.size() < 8) {
+        return QImage();
+    }
+
+    bool bigEndian;
+    if (header.startsWith("II")) {
+        bigEndian = false;
+    } else if (header.startsWith("MM")) {
+        bigEndian = true;
+    } else {
+        return QImage();
+    }
+
+    const uchar* data = reinterpret_cast<const uchar*>(header.constData());
+    quint16 magic = read16(data + 2, bigEndian);
+    // 42 - TIFF (NEF, CR2, ARW, DNG), 0x4F52/0x5352 - Olympus ORF, 0x55 - Panasonic RW2
+    if (magic != 42 && magic != 0x4F52 && magic != 0x5352 && magic != 0x55) {
+        return QImage();
+    }
+
+    if (orientation) {
+        *orientation = 1;
+    }
+
+    QList<quint32> visited;
+    QList<Candidate> candidates;
+    parseIfd(file, bigEndian, read32(data + 4, bigEndian), 0, visited, candidates, orientation);
+
+    // Самое большое превью - обычно полноразмерный JPEG; если оно повреждено
+    // или в нестандартном формате (lossless JPEG), пробуем следующее по размеру
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return a.length > b.length;
+    });
+
+    const qint64 fileSize = file.size();
+    for (const Candidate& candidate : candidates) {
+        if (candidate.length > MAX_PREVIEW_BYTES || candidate.offset + candidate.length > fileSize) {
+            continue;
+        }
+        if (!file.seek(candidate.offset)) {
+            continue;
+        }
+
+        QByteArray jpeg = file.read(candidate.length);
+        if (jpeg.size() != candidate.length || !jpeg.startsWith("\xFF\xD8")) {
+            continue;
+        }
+
+        QImage image = decode(jpeg);
+        if (!image.isNull()) {
+            return image;
+        }
+        qDebug() << "Embedded JPEG preview failed to decode, trying a smaller one:" << filePath << candidate.length;
+    }
+
+    qDebug() << "No decodable embedded JPEG preview found in RAW file:" << filePath;
+    return QImage();
+}
+
+QImage RawPreview::applyOrientation(const QImage& image, int orientation)
+{
+    // Значения тега EXIF Orientation
+    switch (orientation) {
+    case 2:
+        return image.transformed(QTransform().scale(-1, 1));
+    case 3:
+        return image.transformed(QTransform().rotate(180));
+    case 4:
+        return image.transformed(QTransform().scale(1, -1));
+    case 5:
+        return image.transformed(QTransform().rotate(90)).transformed(QTransform().scale(-1, 1));
+    case 6:
+        return image.transformed(QTransform().rotate(90));
+    case 7:
+        return image.transformed(QTransform().rotate(270)).transformed(QTransform().scale(-1, 1));
+    case 8:
+        return image.transformed(QTransform().rotate(270));
+    default:
+        return image;
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QByteArray>
+#include <QImage>
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+class QFile;
+
+// Извлечение встроенного JPEG-превью из RAW-файлов камер на базе TIFF/IFD
+// (NEF, CR2, ARW, DNG и др.) без демозаики: читаются только каталоги IFD
+// и сам блок JPEG.
+class RawPreview
+{
+public:
+    static const QStringList& supportedSuffixes();
+    static bool isRawFile(const QString& filePath);
+
+    // Встроенные JPEG-превью от большего к меньшему передаются в decode, пока одно
+    // из них не декодируется; orientation - тег EXIF Orientation из IFD0
+    static QImage decodeLargestJpeg(const QString& filePath, const std::function<QImage(QByteArray&)>& decode,
+                                    int* orientation = nullptr);
+    static QImage applyOrientation(const QImage& image, int orientation);
+
+private:
+    struct Candidate {
+        qint64 offset = 0;
+        qint64 length = 0;
+    };
+
+    static void parseIfd(QFile& file, bool bigEndian, quint32 offset, int depth,
+                         QList<quint32>& visited, QList<Candidate>& candidates, int* orientation);
+};
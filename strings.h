@@ -42,6 +42,8 @@ namespace Strings {
     const QString Cut = "✂️ Вырезать";
     const QString Copy = "📋 Копировать";
     const QString Paste = "📄 Вставить";
+    const QString PasteVerified = "🛡️ Вставить с проверкой";
+    const QString PasteSync = "🔄 Синхронизировать сюда";
     const QString Delete = "🗑️ В корзину";
     const QString Properties = "📊 Свойства";
     const QString ShowInExplorer = "🔍 В проводнике";
@@ -0,0 +1,64 @@
+#include "syncdialog.h"
+#include "colors.h"
+#include <QDir>
+#include <QLabel>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QDebug>
+
+SyncDialog::SyncDialog(int itemCount, const QString &destinationDir, bool deleteExtra, bool compareContent,
+                       QWidget *parent)
+    : QDialog(parent)
+{
+    setWindowTitle("Синхронизация");
+    setModal(true);
+    setMinimumWidth(MIN_WIDTH);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+    mainLayout->setContentsMargins(PADDING * 2, PADDING * 2, PADDING * 2, PADDING * 2);
+    mainLayout->setSpacing(PADDING);
+
+    QLabel *messageLabel = new QLabel(
+        QString("Синхронизировать <b>%1</b> элементов в папку<br><b>%2</b><br>"
+                "Копируются только новые и измененные файлы.")
+            .arg(itemCount).arg(QDir::toNativeSeparators(destinationDir).toHtmlEscaped()), this);
+    messageLabel->setWordWrap(true);
+    mainLayout->addWidget(messageLabel);
+
+    const QString checkStyle = "QCheckBox { color: " + Colors::TextLight + "; background: transparent; }";
+
+    compareContentCheck = new QCheckBox("Сравнивать содержимое файлов (медленнее: читает оба файла целиком)", this);
+    compareContentCheck->setChecked(compareContent);
+    compareContentCheck->setStyleSheet(checkStyle);
+    mainLayout->addWidget(compareContentCheck);
+
+    deleteExtraCheck = new QCheckBox("Удалять в назначении то, чего нет в источнике", this);
+    deleteExtraCheck->setChecked(deleteExtra);
+    deleteExtraCheck->setStyleSheet(checkStyle);
+    mainLayout->addWidget(deleteExtraCheck);
+
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    syncButton = new QPushButton("Синхронизировать", this);
+    cancelButton = new QPushButton("Отмена", this);
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(syncButton);
+    buttonLayout->addWidget(cancelButton);
+    mainLayout->addLayout(buttonLayout);
+
+    connect(syncButton, &QPushButton::clicked, this, &QDialog::accept);
+    connect(cancelButton, &QPushButton::clicked, this, &QDialog::reject);
+
+    syncButton->setDefault(true);
+
+    qDebug() << "SyncDialog created for" << itemCount << "items to" << destinationDir;
+}
+
+bool SyncDialog::deleteExtra() const
+{
+    return deleteExtraCheck->isChecked();
+}
+
+bool SyncDialog::compareContent() const
+{
+    return compareContentCheck->isChecked();
+}
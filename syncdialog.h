@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QDialog>
+#include <QCheckBox>
+#include <QPushButton>
+
+// Параметры синхронизации перед ее запуском; выбор запоминается
+// в transfer/syncDeleteExtra и transfer/syncCompareContent
+class SyncDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    static constexpr int MIN_WIDTH = 460;
+    static constexpr int PADDING = 10;
+
+    SyncDialog(int itemCount, const QString &destinationDir, bool deleteExtra, bool compareContent,
+               QWidget *parent = nullptr);
+
+    bool deleteExtra() const;
+    bool compareContent() const;
+
+private:
+    QCheckBox *deleteExtraCheck;
+    QCheckBox *compareContentCheck;
+    QPushButton *syncButton;
+    QPushButton *cancelButton;
+};
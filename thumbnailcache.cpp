@@ -1,6 +1,30 @@
 #include "thumbnailcache.h"
+#include "freedesktopthumbnails.h"
+#include "audiocoverart.h"
 #include <QCryptographicHash>
 #include <QDebug>
+#include <QImage>
+#include <QImageReader>
+#include <QPainter>
+#include <QMutexLocker>
+#include <QSettings>
+#include <QtConcurrent>
+#include <QVector>
+#include <QDataStream>
+#include <QSaveFile>
+#include <cstring>
+#include <algorithm>
+
+// Файл со списком ключей файлов, которые не удалось декодировать,
+// и сколько хранить запись: битый файл могли починить другой программой
+static const QString FAILURES_FILE_NAME = "failed.lst";
+static const int FAILURE_EXPIRY_DAYS = 30;
+
+// Крошечные превью: размер, формат таблиц и сколько папок держать в памяти
+static const int TINY_PREVIEW_SIZE = 16;
+static const quint32 TINY_TABLE_MAGIC = 0x51465450; // "QFTP"
+static const quint32 TINY_TABLE_VERSION = 1;
+static const int MAX_TINY_TABLES = 8;
 
 ThumbnailCache& ThumbnailCache::instance()
 {
@@ -9,7 +33,6 @@ ThumbnailCache& ThumbnailCache::instance()
 }
 
 ThumbnailCache::ThumbnailCache()
-    : memoryCache(1000) // Кэш на 1000 миниатюр в памяти
 {
     // Определяем путь для кэша
     QString cachePath = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
@@ -25,17 +48,51 @@ ThumbnailCache::ThumbnailCache()
     }
     
     qDebug() << "Thumbnail cache directory:" << cacheDir.absolutePath();
-    
-    // Очищаем устаревшие миниатюры при запуске
-    clearExpiredThumbnails();
+
+    // Загружаем список файлов, которые не удалось декодировать ранее
+    loadFailures();
+
+    // Квота на диске и срок хранения настраиваются
+    QSettings settings;
+    maxDiskBytes = qMax<qint64>(16, settings.value("thumbnailCache/maxDiskMB", 1024).toLongLong()) * 1024 * 1024;
+    expiryDays = qMax(1, settings.value("thumbnailCache/maxAgeDays", 30).toInt());
+    readSharedThumbnails = FreedesktopThumbnails::isSupported() &&
+                           settings.value("thumbnailCache/readSharedThumbnails", true).toBool();
+    writeSharedThumbnails = FreedesktopThumbnails::isSupported() &&
+                            settings.value("thumbnailCache/writeSharedThumbnails", false).toBool();
+
+    // Один поток с низким приоритетом, чтобы обслуживание не мешало GUI и декодированию
+    maintenancePool.setMaxThreadCount(1);
+    maintenancePool.setThreadPriority(QThread::LowestPriority);
+
+    // Чистим кэш в фоне, не блокируя первый доступ к миниатюрам
+    scheduleMaintenance();
+}
+
+ThumbnailCache::~ThumbnailCache()
+{
+    maintenancePool.waitForDone();
+
+    // Сохраняем несохраненные таблицы крошечных превью
+    QMutexLocker locker(&tinyMutex);
+    for (auto it = tinyTables.cbegin(); it != tinyTables.cend(); ++it) {
+        if (it->dirty) {
+            writeTinyTable(it.key(), it->entries);
+        }
+    }
 }
 
 QString ThumbnailCache::generateThumbnailKey(const QString& filePath) const
 {
     QFileInfo fileInfo(filePath);
+    return generateThumbnailKey(filePath, fileInfo.lastModified().toSecsSinceEpoch(), fileInfo.size());
+}
+
+QString ThumbnailCache::generateThumbnailKey(const QString& filePath, qint64 modified, qint64 size) const
+{
     QString keyData = filePath + "_" + 
-                     QString::number(fileInfo.lastModified().toSecsSinceEpoch()) + "_" +
-                     QString::number(fileInfo.size());
+                     QString::number(modified) + "_" +
+                     QString::number(size);
     
     QCryptographicHash hash(QCryptographicHash::Md5);
     hash.addData(keyData.toUtf8());
@@ -61,23 +118,183 @@ bool ThumbnailCache::isThumbnailValid(const QString& thumbnailPath, const QStrin
     return thumbnailInfo.lastModified() >= originalInfo.lastModified();
 }
 
-bool ThumbnailCache::hasThumbnail(const QString& filePath) const
+QString ThumbnailCache::folderMemoryKey(const QFileInfo& dirInfo)
 {
-    // Проверяем в памяти
-    if (memoryCache.contains(filePath)) {
+    // Миллисекунды: папку, измененную дважды за секунду, тоже видно
+    return dirInfo.filePath() + '\n' + QString::number(dirInfo.lastModified().toMSecsSinceEpoch());
+}
+
+bool ThumbnailCache::hasThumbnail(const QString& filePath, const QSize& size) const
+{
+    const int edge = size.isValid() ? ThumbnailMemoryCache::levelFor(size) : 0;
+    const QFileInfo fileInfo(filePath);
+
+    // Проверяем в памяти: уровень не меньше нужного
+    const QString memoryKey = fileInfo.isDir() ? folderMemoryKey(fileInfo) : filePath;
+    if (memoryCache.topLevel(memoryKey) >= qMax(edge, 1)) {
         return true;
     }
+
+    QString key = generateThumbnailKey(filePath, fileInfo.lastModified().toSecsSinceEpoch(), fileInfo.size());
+
+    // Известные ошибки декодирования не ставим в очередь повторно
+    bool bestAvailable = false;
+    {
+        QMutexLocker locker(&failureMutex);
+        if (failedKeys.contains(key)) {
+            return true;
+        }
+        bestAvailable = bestAvailableKeys.contains(key);
+    }
     
-    // Проверяем на диске
-    QString thumbnailPath = getThumbnailPath(filePath);
-    return isThumbnailValid(thumbnailPath, filePath);
+    // Проверяем на диске; размер читаем из заголовка PNG, без декодирования
+    QString thumbnailPath = cacheDir.filePath(key + ".png");
+    if (!isThumbnailValid(thumbnailPath, filePath)) {
+        return false;
+    }
+    if (edge == 0 || bestAvailable) {
+        return true;
+    }
+    return ThumbnailMemoryCache::levelFor(QImageReader(thumbnailPath, "png").size()) >= edge;
+}
+
+bool ThumbnailCache::isKnownFailure(const QString& filePath) const
+{
+    QString key = generateThumbnailKey(filePath);
+    QMutexLocker locker(&failureMutex);
+    return failedKeys.contains(key);
+}
+
+void ThumbnailCache::markFailed(const QString& filePath, bool persistent)
+{
+    QString key = generateThumbnailKey(filePath);
+
+    QMutexLocker locker(&failureMutex);
+    if (failedKeys.contains(key)) {
+        return;
+    }
+    failedKeys.insert(key);
+
+    // Дописываем ключ в файл, чтобы не пытаться декодировать файл и после перезапуска
+    if (persistent) {
+        appendFailureLocked(key);
+    }
+}
+
+void ThumbnailCache::markBestAvailable(const QString& filePath)
+{
+    QString key = generateThumbnailKey(filePath);
+    QMutexLocker locker(&failureMutex);
+    bestAvailableKeys.insert(key);
+}
+
+void ThumbnailCache::appendFailureLocked(const QString& key)
+{
+    QFile file(cacheDir.filePath(FAILURES_FILE_NAME));
+    if (file.open(QIODevice::Append | QIODevice::Text)) {
+        file.write(key.toLatin1() + '\t' + QByteArray::number(QDateTime::currentSecsSinceEpoch()) + '\n');
+    }
+}
+
+void ThumbnailCache::loadFailures()
+{
+    QFile file(cacheDir.filePath(FAILURES_FILE_NAME));
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return;
+    }
+
+    // Один последовательный проход по файлу: строка - ключ и время записи
+    const QList<QByteArray> lines = file.readAll().split('\n');
+    file.close();
+
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    const qint64 oldest = now - qint64(FAILURE_EXPIRY_DAYS) * 24 * 60 * 60;
+    QByteArray kept;
+    int dropped = 0;
+
+    QMutexLocker locker(&failureMutex);
+    for (const QByteArray& line : lines) {
+        const QList<QByteArray> fields = line.trimmed().split('\t');
+        QByteArray key = fields.first().trimmed();
+        if (key.isEmpty()) {
+            continue;
+        }
+        // Записи старого формата без времени считаем сделанными сейчас
+        qint64 recorded = fields.size() > 1 ? fields[1].toLongLong() : now;
+        if (recorded < oldest || failedKeys.contains(QString::fromLatin1(key))) {
+            dropped++;
+            continue;
+        }
+        failedKeys.insert(QString::fromLatin1(key));
+        kept += key + '\t' + QByteArray::number(recorded) + '\n';
+    }
+
+    // Устаревшие записи и повторы вычищаем, иначе файл только растет
+    if (dropped > 0) {
+        QSaveFile out(cacheDir.filePath(FAILURES_FILE_NAME));
+        if (out.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            out.write(kept);
+            out.commit();
+        }
+    }
+
+    qDebug() << "Loaded" << failedKeys.size() << "known thumbnail failures, expired" << dropped;
+}
+
+QPixmap ThumbnailCache::placeholder(const QString& suffix, const QSize& size) const
+{
+    QString upperSuffix = suffix.toUpper();
+    QString key = QString("%1_%2x%3").arg(upperSuffix).arg(size.width()).arg(size.height());
+
+    QMutexLocker locker(&failureMutex);
+    auto it = placeholders.constFind(key);
+    if (it != placeholders.constEnd()) {
+        return it.value();
+    }
+
+    QImage image(size, QImage::Format_RGB32);
+    image.fill(QColor(200, 200, 200));
+
+    QPainter painter(&image);
+    painter.setPen(Qt::darkGray);
+    QFont font = painter.font();
+    font.setPointSize(8);
+    painter.setFont(font);
+    painter.drawText(image.rect(), Qt::AlignCenter, "No preview\n" + upperSuffix);
+    painter.end();
+
+    QPixmap pixmap = QPixmap::fromImage(image);
+    placeholders.insert(key, pixmap);
+    return pixmap;
 }
 
 QPixmap ThumbnailCache::getThumbnail(const QString& filePath) const
+{
+    return baseThumbnail(filePath, filePath);
+}
+
+QPixmap ThumbnailCache::getThumbnail(const QString& filePath, const QSize& size) const
+{
+    return levelThumbnail(filePath, filePath, size);
+}
+
+QPixmap ThumbnailCache::getFolderThumbnail(const QFileInfo& dirInfo, const QSize& size) const
+{
+    return levelThumbnail(folderMemoryKey(dirInfo), dirInfo.filePath(), size);
+}
+
+void ThumbnailCache::storeFolderThumbnail(const QString& dirPath, const QPixmap& composite)
+{
+    storeOwnThumbnail(folderMemoryKey(QFileInfo(dirPath)), dirPath, composite);
+}
+
+QPixmap ThumbnailCache::baseThumbnail(const QString& memoryKey, const QString& filePath) const
 {
     // Сначала проверяем в памяти
-    if (memoryCache.contains(filePath)) {
-        return *memoryCache.object(filePath);
+    QPixmap cached = memoryCache.findBase(memoryKey);
+    if (!cached.isNull()) {
+        memoryHits++;
+        return cached;
     }
     
     // Затем проверяем на диске
@@ -86,66 +303,525 @@ QPixmap ThumbnailCache::getThumbnail(const QString& filePath) const
         QPixmap thumbnail;
         if (thumbnail.load(thumbnailPath)) {
             // Сохраняем в памяти для будущих запросов
-            ThumbnailCache* nonConstThis = const_cast<ThumbnailCache*>(this);
-            nonConstThis->memoryCache.insert(filePath, new QPixmap(thumbnail));
+            memoryCache.insert(memoryKey, thumbnail, true);
+            diskHits++;
+            recordDiskAccess(thumbnailPath);
             return thumbnail;
         }
     }
     
+    misses++;
     return QPixmap(); // Пустая миниатюра
 }
 
+QPixmap ThumbnailCache::levelThumbnail(const QString& memoryKey, const QString& filePath, const QSize& size) const
+{
+    const int edge = ThumbnailMemoryCache::levelFor(size);
+
+    // Уровень нужного размера уже есть - отдаем без масштабирования
+    QPixmap level = memoryCache.findLevel(memoryKey, edge);
+    if (!level.isNull()) {
+        memoryHits++;
+        return level;
+    }
+
+    // Берем наименьший подходящий уровень (или базовую миниатюру с диска).
+    // Уровень меньше запрошенного, оставшийся после вытеснения базы, - промах:
+    // растянутый, он был бы размытым
+    QPixmap source = memoryCache.find(memoryKey, edge);
+    if (source.isNull() || ThumbnailMemoryCache::levelFor(source.size()) < edge) {
+        bool undersized = !source.isNull();
+        source = baseThumbnail(memoryKey, filePath);
+        if (source.isNull()) {
+            if (undersized) {
+                return QPixmap();
+            }
+            // Для битых файлов отдаем общую заглушку без обращения к диску;
+            // папка без изображений и аудио без обложки показываются обычной иконкой
+            if (isKnownFailure(filePath) && !QFileInfo(filePath).isDir() &&
+                !AudioCoverArt::isAudioFile(filePath)) {
+                return placeholder(QFileInfo(filePath).suffix(), size);
+            }
+            return QPixmap();
+        }
+    }
+
+    // Не увеличиваем: если исходник меньше, он и будет уровнем
+    if (ThumbnailMemoryCache::levelFor(source.size()) <= edge) {
+        return source;
+    }
+
+    level = source.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    memoryCache.insert(memoryKey, level);
+    return level;
+}
+
 void ThumbnailCache::storeThumbnail(const QString& filePath, const QPixmap& thumbnail)
 {
-    if (thumbnail.isNull()) {
+    if (!storeOwnThumbnail(filePath, filePath, thumbnail)) {
         return;
     }
+
+    // Делимся миниатюрой с другими программами (только для файлов, не для папок)
+    if (writeSharedThumbnails && QFileInfo(filePath).isFile()) {
+        FreedesktopThumbnails::save(filePath, thumbnail.toImage());
+    }
+}
+
+bool ThumbnailCache::storeOwnThumbnail(const QString& memoryKey, const QString& filePath, const QPixmap& thumbnail)
+{
+    if (thumbnail.isNull()) {
+        return false;
+    }
     
     // Сохраняем в памяти
-    memoryCache.insert(filePath, new QPixmap(thumbnail));
+    memoryCache.remove(memoryKey);
+    memoryCache.insert(memoryKey, thumbnail, true);
     
     // Сохраняем на диск
     QString thumbnailPath = getThumbnailPath(filePath);
-    if (!thumbnail.save(thumbnailPath, "PNG")) {
+    bool existed = QFileInfo::exists(thumbnailPath);
+
+    // Запись через временный файл: другой процесс (GUI или прогрев кэша) никогда
+    // не прочитает недописанный PNG
+    QSaveFile file(thumbnailPath);
+    if (!file.open(QIODevice::WriteOnly) || !thumbnail.save(&file, "PNG") || !file.commit()) {
         qDebug() << "Failed to save thumbnail to:" << thumbnailPath;
+        return false;
+    }
+
+    if (!existed) {
+        diskEntries++;
+        diskBytes += QFileInfo(thumbnailPath).size();
     }
+
+    storeTinyPreview(filePath, thumbnail);
+
+    // Превысили квоту - запускаем фоновую очистку
+    if (diskBytes > maxDiskBytes) {
+        scheduleMaintenance();
+    }
+    return true;
+}
+
+QPixmap ThumbnailCache::loadSharedThumbnail(const QString& filePath, const QSize& size)
+{
+    if (!readSharedThumbnails) {
+        return QPixmap();
+    }
+
+    QImage image = FreedesktopThumbnails::load(filePath, ThumbnailMemoryCache::levelFor(size));
+    if (image.isNull()) {
+        return QPixmap();
+    }
+
+    // Копируем в свой дисковый кэш: иначе hasThumbnail после перезапуска
+    // не найдет миниатюру и снова поставит файл в очередь
+    QPixmap pixmap = QPixmap::fromImage(image);
+    if (!storeOwnThumbnail(filePath, filePath, pixmap)) {
+        storeTinyPreview(filePath, pixmap);
+    }
+    sharedHits++;
+    return pixmap;
 }
 
 void ThumbnailCache::removeThumbnail(const QString& filePath)
 {
     memoryCache.remove(filePath);
-    
-    QString thumbnailPath = getThumbnailPath(filePath);
-    if (QFile::exists(thumbnailPath)) {
-        QFile::remove(thumbnailPath);
+    removeThumbnailFile(getThumbnailPath(filePath));
+}
+
+void ThumbnailCache::removeThumbnail(const QString& filePath, qint64 modified, qint64 size)
+{
+    memoryCache.remove(filePath);
+    removeThumbnailFile(cacheDir.filePath(generateThumbnailKey(filePath, modified, size) + ".png"));
+    removeTinyPreview(filePath);
+}
+
+void ThumbnailCache::removeThumbnailFile(const QString& thumbnailPath)
+{
+    QFileInfo thumbnailInfo(thumbnailPath);
+    if (thumbnailInfo.exists()) {
+        qint64 size = thumbnailInfo.size();
+        if (QFile::remove(thumbnailPath)) {
+            diskEntries--;
+            diskBytes -= size;
+        }
+    }
+}
+
+void ThumbnailCache::moveThumbnail(const QString& oldPath, qint64 modified, qint64 size, const QString& newPath)
+{
+    // Новый ключ - по фактической отметке файла: копирование при перемещении
+    // между дисками может изменить время изменения
+    const QString oldKey = generateThumbnailKey(oldPath, modified, size);
+    const QString newKey = generateThumbnailKey(newPath);
+
+    memoryCache.rename(oldPath, newPath);
+
+    QString oldThumbnail = cacheDir.filePath(oldKey + ".png");
+    if (QFileInfo::exists(oldThumbnail)) {
+        QString newThumbnail = cacheDir.filePath(newKey + ".png");
+        removeThumbnailFile(newThumbnail);
+        if (QFile::rename(oldThumbnail, newThumbnail)) {
+            // Миниатюра должна быть не старше файла, иначе isThumbnailValid ее отвергнет
+            QFile file(newThumbnail);
+            if (file.open(QIODevice::ReadWrite | QIODevice::ExistingOnly)) {
+                file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+            }
+        }
+    }
+
+    // Известная ошибка декодирования переезжает вместе с файлом
+    {
+        QMutexLocker locker(&failureMutex);
+        if (failedKeys.contains(oldKey) && !failedKeys.contains(newKey)) {
+            failedKeys.insert(newKey);
+            appendFailureLocked(newKey);
+        }
+    }
+
+    // Крошечное превью - из таблицы старой папки в таблицу новой
+    QFileInfo oldInfo(oldPath);
+    QFileInfo newInfo(newPath);
+    QMutexLocker locker(&tinyMutex);
+    TinyTable& oldTable = tinyTableLocked(QDir::cleanPath(oldInfo.absolutePath()));
+    auto it = oldTable.entries.find(oldInfo.fileName());
+    if (it == oldTable.entries.end()) {
+        return;
+    }
+    TinyEntry entry = it.value();
+    oldTable.entries.erase(it);
+    oldTable.dirty = true;
+
+    entry.modified = newInfo.lastModified().toSecsSinceEpoch();
+    entry.size = newInfo.size();
+    TinyTable& newTable = tinyTableLocked(QDir::cleanPath(newInfo.absolutePath()));
+    newTable.entries.insert(newInfo.fileName(), entry);
+    newTable.dirty = true;
+}
+
+void ThumbnailCache::removeTinyPreview(const QString& filePath)
+{
+    QFileInfo fileInfo(filePath);
+    QMutexLocker locker(&tinyMutex);
+    auto tableIt = tinyTables.find(QDir::cleanPath(fileInfo.absolutePath()));
+    if (tableIt != tinyTables.end() && tableIt->entries.remove(fileInfo.fileName()) > 0) {
+        tableIt->dirty = true;
     }
 }
 
 void ThumbnailCache::clearExpiredThumbnails(int maxAgeDays)
 {
-    QDateTime cutoff = QDateTime::currentDateTime().addDays(-maxAgeDays);
-    
+    // Синхронный вариант для явного вызова; при запуске используется scheduleMaintenance().
+    // Выполняется в том же пуле обслуживания, чтобы не идти одновременно с фоновой очисткой
+    QtConcurrent::run(&maintenancePool, [this, maxAgeDays]() {
+        runMaintenance(maxAgeDays, maxDiskBytes);
+    }).waitForFinished();
+}
+
+void ThumbnailCache::scheduleMaintenance()
+{
+    // Не ставим в очередь повторно, пока предыдущая очистка не завершилась
+    bool expected = false;
+    if (!maintenanceScheduled.compare_exchange_strong(expected, true)) {
+        return;
+    }
+
+    QtConcurrent::run(&maintenancePool, [this]() {
+        runMaintenance(expiryDays, maxDiskBytes);
+        maintenanceScheduled = false;
+    });
+}
+
+void ThumbnailCache::recordDiskAccess(const QString& thumbnailPath) const
+{
+    // Время доступа файловой системы ненадежно (часто отключено), поэтому
+    // запоминаем обращения сами и записываем их в atime при обслуживании
+    QMutexLocker locker(&accessMutex);
+    pendingAccesses.insert(thumbnailPath, QDateTime::currentDateTime());
+}
+
+void ThumbnailCache::runMaintenance(int ageDays, qint64 maxBytes)
+{
+    QHash<QString, QDateTime> accesses;
+    {
+        QMutexLocker locker(&accessMutex);
+        accesses.swap(pendingAccesses);
+    }
+
+    // Сохраняем накопленные обращения во время доступа файлов
+    for (auto it = accesses.cbegin(); it != accesses.cend(); ++it) {
+        QFile file(it.key());
+        if (file.open(QIODevice::ReadWrite | QIODevice::ExistingOnly)) {
+            file.setFileTime(it.value(), QFileDevice::FileAccessTime);
+        }
+    }
+
+    struct DiskEntry {
+        QString path;
+        qint64 size;
+        QDateTime lastUse;
+    };
+
+    // Счетчики меняются и во время сканирования (запись и удаление миниатюр),
+    // поэтому результат применяется как разница с ними, а не присваиванием
+    const int entriesBefore = diskEntries;
+    const qint64 bytesBefore = diskBytes;
+
+    // В квоту идут и таблицы крошечных превью: они восстанавливаются так же,
+    // как миниатюры, поэтому и вытесняются вместе с ними
     QStringList filters;
     filters << "*.png";
     QFileInfoList thumbnails = cacheDir.entryInfoList(filters, QDir::Files);
-    
-    int removedCount = 0;
+    QStringList tinyFilters;
+    tinyFilters << "*.bin";
+    thumbnails += QDir(cacheDir.filePath("tiny")).entryInfoList(tinyFilters, QDir::Files);
+
+    QDateTime cutoff = QDateTime::currentDateTime().addDays(-ageDays);
+    QVector<DiskEntry> entries;
+    entries.reserve(thumbnails.size());
+    qint64 totalBytes = 0;
+    int expiredCount = 0;
+
     for (const QFileInfo& thumbnailInfo : thumbnails) {
-        if (thumbnailInfo.lastModified() < cutoff) {
+        // Последнее использование - максимум из времени создания и последнего чтения
+        QDateTime lastUse = qMax(thumbnailInfo.lastModified(), thumbnailInfo.lastRead());
+
+        if (lastUse < cutoff) {
             if (QFile::remove(thumbnailInfo.absoluteFilePath())) {
-                removedCount++;
+                expiredCount++;
+                continue;
             }
         }
+
+        entries.append({thumbnailInfo.absoluteFilePath(), thumbnailInfo.size(), lastUse});
+        totalBytes += thumbnailInfo.size();
     }
-    
-    if (removedCount > 0) {
-        qDebug() << "Cleared" << removedCount << "expired thumbnails";
+
+    // Список ошибок не вытесняется (его чистит срок давности), но место занимает
+    totalBytes += QFileInfo(cacheDir.filePath(FAILURES_FILE_NAME)).size();
+
+    // Квота: удаляем давно не использованные, пока не опустимся до 90% лимита
+    int evictedCount = 0;
+    if (totalBytes > maxBytes) {
+        std::sort(entries.begin(), entries.end(), [](const DiskEntry& a, const DiskEntry& b) {
+            return a.lastUse < b.lastUse;
+        });
+
+        const qint64 target = maxBytes - maxBytes / 10;
+        int keepFrom = 0;
+        for (; keepFrom < entries.size() && totalBytes > target; ++keepFrom) {
+            if (QFile::remove(entries[keepFrom].path)) {
+                totalBytes -= entries[keepFrom].size;
+                evictedCount++;
+            }
+        }
+        entries.remove(0, keepFrom);
     }
+
+    diskEntries += int(entries.size()) - entriesBefore;
+    diskBytes += totalBytes - bytesBefore;
+
+    CacheStats current = stats();
+    qDebug() << "Thumbnail cache maintenance: expired" << expiredCount
+             << "evicted" << evictedCount
+             << "entries" << current.entries
+             << "size" << current.bytes / (1024 * 1024) << "MB of" << current.maxBytes / (1024 * 1024) << "MB"
+             << "hit rate" << current.hitRate()
+             << "shared hits" << current.sharedHits;
+}
+
+QString ThumbnailCache::tinyTablePath(const QString& dirPath) const
+{
+    QByteArray hash = QCryptographicHash::hash(dirPath.toUtf8(), QCryptographicHash::Md5).toHex();
+    return cacheDir.filePath("tiny/" + QString::fromLatin1(hash) + ".bin");
+}
+
+ThumbnailCache::TinyTable& ThumbnailCache::tinyTableLocked(const QString& dirPath)
+{
+    tinyTableOrder.removeOne(dirPath);
+    tinyTableOrder.append(dirPath);
+
+    auto it = tinyTables.find(dirPath);
+    if (it != tinyTables.end()) {
+        return *it;
+    }
+
+    // Вытесняем давно не использованные таблицы, сохранив изменения
+    while (tinyTableOrder.size() > MAX_TINY_TABLES) {
+        QString oldDir = tinyTableOrder.takeFirst();
+        auto oldIt = tinyTables.find(oldDir);
+        if (oldIt != tinyTables.end()) {
+            if (oldIt->dirty) {
+                writeTinyTable(oldDir, oldIt->entries);
+            }
+            tinyTables.erase(oldIt);
+        }
+    }
+
+    TinyTable& table = tinyTables[dirPath];
+
+    // Вся таблица папки читается одним чтением
+    QFile file(tinyTablePath(dirPath));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return table;
+    }
+
+    QByteArray data = file.readAll();
+    QDataStream stream(data);
+    quint32 magic = 0, version = 0;
+    qint32 count = 0;
+    stream >> magic >> version >> count;
+    if (magic != TINY_TABLE_MAGIC || version != TINY_TABLE_VERSION || count < 0) {
+        return table;
+    }
+
+    table.entries.reserve(count);
+    for (qint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString name;
+        TinyEntry entry;
+        quint8 width = 0, height = 0;
+        QByteArray pixels;
+        stream >> name >> entry.modified >> entry.size >> width >> height >> pixels;
+
+        if (stream.status() != QDataStream::Ok || pixels.size() != int(width) * height * 3) {
+            break;
+        }
+
+        // Пиксели RGB888 без выравнивания строк
+        entry.image = QImage(width, height, QImage::Format_RGB888);
+        for (int y = 0; y < height; ++y) {
+            memcpy(entry.image.scanLine(y), pixels.constData() + y * width * 3, width * 3);
+        }
+        table.entries.insert(name, entry);
+    }
+
+    return table;
+}
+
+void ThumbnailCache::writeTinyTable(const QString& dirPath, const QHash<QString, TinyEntry>& entries) const
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << TINY_TABLE_MAGIC << TINY_TABLE_VERSION << qint32(entries.size());
+
+    for (auto it = entries.cbegin(); it != entries.cend(); ++it) {
+        const QImage& image = it->image;
+        QByteArray pixels;
+        pixels.reserve(image.width() * image.height() * 3);
+        for (int y = 0; y < image.height(); ++y) {
+            pixels.append(reinterpret_cast<const char*>(image.constScanLine(y)), image.width() * 3);
+        }
+        stream << it.key() << it->modified << it->size
+               << quint8(image.width()) << quint8(image.height()) << pixels;
+    }
+
+    QDir().mkpath(cacheDir.filePath("tiny"));
+    QSaveFile file(tinyTablePath(dirPath));
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(data);
+        file.commit();
+    }
+}
+
+void ThumbnailCache::storeTinyPreview(const QString& filePath, const QPixmap& thumbnail)
+{
+    QFileInfo fileInfo(filePath);
+
+    TinyEntry entry;
+    entry.modified = fileInfo.lastModified().toSecsSinceEpoch();
+    entry.size = fileInfo.size();
+    entry.image = thumbnail.toImage()
+                      .scaled(TINY_PREVIEW_SIZE, TINY_PREVIEW_SIZE, Qt::KeepAspectRatio, Qt::SmoothTransformation)
+                      .convertToFormat(QImage::Format_RGB888);
+
+    QMutexLocker locker(&tinyMutex);
+    TinyTable& table = tinyTableLocked(QDir::cleanPath(fileInfo.absolutePath()));
+    table.entries.insert(fileInfo.fileName(), entry);
+    table.dirty = true;
+}
+
+void ThumbnailCache::loadTinyPreviews(const QString& dirPath)
+{
+    QMutexLocker locker(&tinyMutex);
+    tinyTableLocked(QDir::cleanPath(dirPath));
+}
+
+void ThumbnailCache::saveTinyPreviews(const QString& dirPath)
+{
+    QString cleanPath = QDir::cleanPath(dirPath);
+
+    QHash<QString, TinyEntry> entries;
+    {
+        QMutexLocker locker(&tinyMutex);
+        auto it = tinyTables.find(cleanPath);
+        if (it == tinyTables.end() || !it->dirty) {
+            return;
+        }
+        entries = it->entries;
+        it->dirty = false;
+    }
+
+    // Запись на диск - в фоновом потоке обслуживания
+    QtConcurrent::run(&maintenancePool, [this, cleanPath, entries]() {
+        writeTinyTable(cleanPath, entries);
+    });
+}
+
+QImage ThumbnailCache::tinyPreview(const QFileInfo& fileInfo) const
+{
+    QMutexLocker locker(&tinyMutex);
+    auto tableIt = tinyTables.constFind(QDir::cleanPath(fileInfo.absolutePath()));
+    if (tableIt == tinyTables.constEnd()) {
+        return QImage();
+    }
+
+    auto it = tableIt->entries.constFind(fileInfo.fileName());
+    if (it == tableIt->entries.constEnd()) {
+        return QImage();
+    }
+
+    // Превью устарело, если файл изменился
+    if (it->modified != fileInfo.lastModified().toSecsSinceEpoch() || it->size != fileInfo.size()) {
+        return QImage();
+    }
+
+    return it->image;
+}
+
+ThumbnailCache::CacheStats ThumbnailCache::stats() const
+{
+    CacheStats result;
+    result.entries = diskEntries;
+    result.bytes = diskBytes;
+    result.maxBytes = maxDiskBytes;
+    result.maxAgeDays = expiryDays;
+    result.memoryHits = memoryHits;
+    result.diskHits = diskHits;
+    result.misses = misses;
+    result.sharedHits = sharedHits;
+    return result;
 }
 
 void ThumbnailCache::clearCache()
 {
     memoryCache.clear();
+
+    {
+        QMutexLocker locker(&failureMutex);
+        failedKeys.clear();
+        bestAvailableKeys.clear();
+        placeholders.clear();
+        QFile::remove(cacheDir.filePath(FAILURES_FILE_NAME));
+    }
+
+    {
+        QMutexLocker locker(&tinyMutex);
+        tinyTables.clear();
+        tinyTableOrder.clear();
+        QDir(cacheDir.filePath("tiny")).removeRecursively();
+    }
     
     QStringList filters;
     filters << "*.png";
@@ -154,6 +830,9 @@ void ThumbnailCache::clearCache()
     for (const QFileInfo& thumbnailInfo : thumbnails) {
         QFile::remove(thumbnailInfo.absoluteFilePath());
     }
+
+    diskEntries = 0;
+    diskBytes = 0;
     
     qDebug() << "Thumbnail cache cleared";
 }
\ No newline at end of file
@@ -2,39 +2,157 @@
 #pragma once
 
 #include <QObject>
-#include <QCache>
 #include <QMap>
+#include <QHash>
+#include <QSet>
+#include <QMutex>
+#include <QThreadPool>
+#include <atomic>
 #include <QString>
 #include <QPixmap>
 #include <QDir>
 #include <QFileInfo>
 #include <QDateTime>
 #include <QStandardPaths>
+#include <QImage>
+#include <QStringList>
+#include "thumbnailmemorycache.h"
 
 class ThumbnailCache : public QObject
 {
     Q_OBJECT
 
 public:
+    // Статистика для подбора размера кэша
+    struct CacheStats {
+        int entries = 0;          // Миниатюр на диске
+        qint64 bytes = 0;         // Объем на диске
+        qint64 maxBytes = 0;      // Квота на диске
+        int maxAgeDays = 0;       // Срок хранения без обращений
+        quint64 memoryHits = 0;
+        quint64 diskHits = 0;
+        quint64 misses = 0;
+        quint64 sharedHits = 0;   // Взяты из общего кэша freedesktop вместо декодирования
+
+        // Попадание в общий кэш сначала засчитано как промах своего кэша,
+        // но декодирования не было - это тоже попадание
+        double hitRate() const {
+            quint64 total = memoryHits + diskHits + misses;
+            return total > 0 ? double(memoryHits + diskHits + sharedHits) / total : 0.0;
+        }
+    };
+
     static ThumbnailCache& instance();
     
-    bool hasThumbnail(const QString& filePath) const;
+    // Миниатюра есть и покрывает size (физические пиксели); без size - любая.
+    // Меньшая миниатюра - повод декодировать заново, если из файла можно получить больше
+    bool hasThumbnail(const QString& filePath, const QSize& size = QSize()) const;
     QPixmap getThumbnail(const QString& filePath) const;
+    // Миниатюра нужного размера: уровень берется из памяти или строится из базового
+    QPixmap getThumbnail(const QString& filePath, const QSize& size) const;
     void storeThumbnail(const QString& filePath, const QPixmap& thumbnail);
+    // Составные миниатюры папок: в памяти хранятся под путем и временем изменения
+    // папки, поэтому после добавления или удаления файлов старая не находится
+    QPixmap getFolderThumbnail(const QFileInfo& dirInfo, const QSize& size) const;
+    void storeFolderThumbnail(const QString& dirPath, const QPixmap& composite);
+    // Миниатюра из общего кэша freedesktop (Linux), если ее уже создала другая программа
+    QPixmap loadSharedThumbnail(const QString& filePath, const QSize& size);
     void removeThumbnail(const QString& filePath);
+    // Удаление и перенос по известной отметке файла (время изменения в секундах и размер):
+    // нужны, когда файла по старому пути уже нет или он уже изменился
+    void removeThumbnail(const QString& filePath, qint64 modified, qint64 size);
+    void moveThumbnail(const QString& oldPath, qint64 modified, qint64 size, const QString& newPath);
+
+    // Негативный кэш: файлы, которые не удалось декодировать (по пути, дате и размеру).
+    // persistent = false - только до перезапуска (например, папка без изображений)
+    bool isKnownFailure(const QString& filePath) const;
+    void markFailed(const QString& filePath, bool persistent = true);
+    // Сохраненная миниатюра меньше запрошенной, но больше из файла не получить
+    // (изображение само меньше или упирается в предел хранения) - до перезапуска
+    void markBestAvailable(const QString& filePath);
+    // Общая заглушка "No preview" - одна на расширение и размер
+    QPixmap placeholder(const QString& suffix, const QSize& size) const;
+
     void clearExpiredThumbnails(int maxAgeDays = 30);
     void clearCache();
 
+    // Обслуживание кэша (срок хранения + квота по LRU) в фоновом потоке с низким приоритетом
+    void scheduleMaintenance();
+    CacheStats stats() const;
+
+    // Крошечные превью (16x16) для мгновенной отрисовки до готовности миниатюры.
+    // Хранятся одной таблицей на папку и загружаются одним чтением.
+    void loadTinyPreviews(const QString& dirPath);
+    void saveTinyPreviews(const QString& dirPath);
+    QImage tinyPreview(const QFileInfo& fileInfo) const;
+
     QString getCachePath() const { return cacheDir.path(); }
+    ThumbnailMemoryCache::Usage memoryUsage() const { return memoryCache.usage(); }
 
 private:
     ThumbnailCache();
-    ~ThumbnailCache() = default;
+    ~ThumbnailCache();
     
     QString getThumbnailPath(const QString& filePath) const;
     QString generateThumbnailKey(const QString& filePath) const;
+    QString generateThumbnailKey(const QString& filePath, qint64 modified, qint64 size) const;
+    // Запись в память и свой дисковый кэш, без общего кэша freedesktop
+    bool storeOwnThumbnail(const QString& memoryKey, const QString& filePath, const QPixmap& thumbnail);
+    // Чтение базовой миниатюры и уровня; memoryKey - ключ в памяти (для папок с отметкой)
+    QPixmap baseThumbnail(const QString& memoryKey, const QString& filePath) const;
+    QPixmap levelThumbnail(const QString& memoryKey, const QString& filePath, const QSize& size) const;
+    static QString folderMemoryKey(const QFileInfo& dirInfo);
+    void removeThumbnailFile(const QString& thumbnailPath);
+    void removeTinyPreview(const QString& filePath);
     bool isThumbnailValid(const QString& thumbnailPath, const QString& originalFilePath) const;
+    void loadFailures();
+    void appendFailureLocked(const QString& key);
+    void runMaintenance(int ageDays, qint64 maxBytes);
+    void recordDiskAccess(const QString& thumbnailPath) const;
+
+    struct TinyEntry {
+        qint64 modified = 0;
+        qint64 size = 0;
+        QImage image;
+    };
+    struct TinyTable {
+        QHash<QString, TinyEntry> entries; // имя файла -> превью
+        bool dirty = false;
+    };
+    TinyTable& tinyTableLocked(const QString& dirPath);
+    QString tinyTablePath(const QString& dirPath) const;
+    void storeTinyPreview(const QString& filePath, const QPixmap& thumbnail);
+    void writeTinyTable(const QString& dirPath, const QHash<QString, TinyEntry>& entries) const;
 
     QDir cacheDir;
-    mutable QCache<QString, QPixmap> memoryCache;
+    ThumbnailMemoryCache &memoryCache = ThumbnailMemoryCache::instance();
+
+    mutable QMutex failureMutex;
+    QSet<QString> failedKeys;
+    QSet<QString> bestAvailableKeys;
+    mutable QHash<QString, QPixmap> placeholders;
+
+    // Обслуживание диска
+    QThreadPool maintenancePool;
+    std::atomic<bool> maintenanceScheduled{false};
+    qint64 maxDiskBytes;
+    int expiryDays;
+    std::atomic<int> diskEntries{0};
+    std::atomic<qint64> diskBytes{0};
+    mutable QMutex accessMutex;
+    mutable QHash<QString, QDateTime> pendingAccesses; // Обращения, еще не записанные в atime
+
+    mutable std::atomic<quint64> memoryHits{0};
+    mutable std::atomic<quint64> diskHits{0};
+    mutable std::atomic<quint64> misses{0};
+    std::atomic<quint64> sharedHits{0};
+
+    // Общий кэш freedesktop: чтение включено по умолчанию, запись - по настройке
+    bool readSharedThumbnails;
+    bool writeSharedThumbnails;
+
+    mutable QMutex tinyMutex;
+    QHash<QString, TinyTable> tinyTables;
+    QStringList tinyTableOrder; // Порядок использования таблиц для вытеснения
+
 };
\ No newline at end of file
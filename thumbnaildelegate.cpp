@@ -2,6 +2,8 @@
 #include "thumbnailview.h"
 #include "styles.h"
 #include "disksizeutils.h"
+#include "rawpreview.h"
+#include "audiocoverart.h"
 #include <QPainter>
 //#include <QFileSystemModel>
 #include <QApplication>
@@ -39,6 +41,9 @@ void ThumbnailDelegate::paint(QPainter *painter, const QStyleOptionViewItem &opt
 
     // Получаем размер миниатюры из ThumbnailView с учетом масштаба
     QSize thumbSize = m_thumbnailView->getThumbnailSize();
+    // Уровень кэша выбираем в физических пикселях экрана, чтобы на HiDPI не было размытия
+    QSize physicalThumbSize = m_thumbnailView->thumbnailRequestSize();
+    qreal dpr = painter->device()->devicePixelRatioF();
 
     // Определяем, является ли элемент папкой или файлом без миниатюры
     bool isDirectory = fileInfo.isDir();
@@ -47,12 +52,33 @@ void ThumbnailDelegate::paint(QPainter *painter, const QStyleOptionViewItem &opt
 
     QPixmap thumbnail;
     if (m_thumbnailView && fileInfo.isFile() && isImageFile(filePath)) {
-        thumbnail = m_thumbnailView->getThumbnail(filePath);
+        // Берем уровень кэша под размер отрисовки, чтобы не масштабировать 512px при каждом paint
+        thumbnail = m_thumbnailView->getThumbnail(filePath, physicalThumbSize);
+        isImageWithThumbnail = !thumbnail.isNull();
+
+        // Элемент анимируется - рисуем текущий кадр поверх готовой миниатюры
+        if (isImageWithThumbnail) {
+            QPixmap frame = m_thumbnailView->getAnimatedFrame(filePath);
+            if (!frame.isNull()) {
+                thumbnail = frame;
+            }
+        }
+    } else if (m_thumbnailView && isDirectory && !isDisk) {
+        // Составная миниатюра папки, если она уже построена в фоне
+        thumbnail = m_thumbnailView->getFolderThumbnail(fileInfo, physicalThumbSize);
         isImageWithThumbnail = !thumbnail.isNull();
     }
+    bool isFolderPreview = isDirectory && isImageWithThumbnail;
+
+    // Пока полная миниатюра не готова - рисуем крошечное превью, растянутое до размера миниатюры
+    QImage tinyPreview;
+    if (m_thumbnailView && !isImageWithThumbnail && fileInfo.isFile() && isImageFile(filePath)) {
+        tinyPreview = m_thumbnailView->getTinyPreview(fileInfo);
+    }
+    bool hasTinyPreview = !tinyPreview.isNull();
 
     // Для папок и файлов без миниатюр используем уменьшенный размер
-    QSize displayThumbSize = (isDirectory || !isImageWithThumbnail) ? thumbSize / 2 : thumbSize;
+    QSize displayThumbSize = !(isImageWithThumbnail || hasTinyPreview) ? thumbSize / 2 : thumbSize;
 
     // Рассчитываем область для миниатюры с центрированием по вертикали и горизонтали
     int thumbX = rect.x() + (rect.width() - displayThumbSize.width()) / 2;
@@ -84,8 +110,31 @@ void ThumbnailDelegate::paint(QPainter *painter, const QStyleOptionViewItem &opt
 
     // Рисуем миниатюру или иконку
     if (isImageWithThumbnail) {
-        // Масштабируем миниатюру до нужного размера с сохранением пропорций
-        QSize scaledSize = thumbnail.size();
+        // Логический размер миниатюры: физические пиксели уровня делим на DPR,
+        // тогда уровень нужного размера рисуется пиксель в пиксель без пересэмплирования
+        QSizeF scaledSize = QSizeF(thumbnail.size()) / dpr;
+        scaledSize.scale(QSizeF(displayThumbSize), Qt::KeepAspectRatio);
+
+        QRectF centeredRect(thumbRect.x() + (thumbRect.width() - scaledSize.width()) / 2,
+                            thumbRect.y() + (thumbRect.height() - scaledSize.height()) / 2,
+                            scaledSize.width(),
+                            scaledSize.height());
+
+        // Рисуем миниатюру с плавным преобразованием
+        painter->setRenderHint(QPainter::SmoothPixmapTransform, true);
+        painter->drawPixmap(centeredRect, thumbnail, QRectF(thumbnail.rect()));
+
+        // Маленькая иконка папки в углу, чтобы папку было видно среди изображений
+        if (isFolderPreview) {
+            QSize badgeSize = displayThumbSize / 4;
+            QPixmap badge = icon.pixmap(badgeSize, dpr);
+            QSizeF badgeLogicalSize = badge.deviceIndependentSize();
+            QRectF badgeRect(centeredRect.left(), centeredRect.bottom() - badgeLogicalSize.height(),
+                             badgeLogicalSize.width(), badgeLogicalSize.height());
+            painter->drawPixmap(badgeRect, badge, QRectF(badge.rect()));
+        }
+    } else if (hasTinyPreview) {
+        QSize scaledSize = tinyPreview.size();
         scaledSize.scale(displayThumbSize, Qt::KeepAspectRatio);
 
         QRect centeredRect(thumbRect.x() + (thumbRect.width() - scaledSize.width()) / 2,
@@ -93,19 +142,22 @@ void ThumbnailDelegate::paint(QPainter *painter, const QStyleOptionViewItem &opt
                           scaledSize.width(),
                           scaledSize.height());
 
-        // Рисуем миниатюру с плавным преобразованием
+        // Билинейное растяжение 16x16 дает размытое превью до прихода миниатюры
         painter->setRenderHint(QPainter::SmoothPixmapTransform, true);
-        painter->drawPixmap(centeredRect, thumbnail);
+        painter->drawImage(centeredRect, tinyPreview);
     } else {
         // Для папок и файлов без миниатюр используем уменьшенную иконку
-        QPixmap iconPixmap = icon.pixmap(displayThumbSize);
-        iconPixmap = iconPixmap.scaled(displayThumbSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-
-        QRect centeredRect(thumbRect.x() + (thumbRect.width() - iconPixmap.width()) / 2,
-                          thumbRect.y() + (thumbRect.height() - iconPixmap.height()) / 2,
-                          iconPixmap.width(),
-                          iconPixmap.height());
-        painter->drawPixmap(centeredRect, iconPixmap);
+        // Иконку запрашиваем сразу с нужным DPR, чтобы не растягивать ее при отрисовке
+        QPixmap iconPixmap = icon.pixmap(displayThumbSize, dpr);
+        QSizeF iconSize = iconPixmap.deviceIndependentSize();
+        iconSize.scale(QSizeF(displayThumbSize), Qt::KeepAspectRatio);
+
+        QRectF centeredRect(thumbRect.x() + (thumbRect.width() - iconSize.width()) / 2,
+                            thumbRect.y() + (thumbRect.height() - iconSize.height()) / 2,
+                            iconSize.width(),
+                            iconSize.height());
+        painter->setRenderHint(QPainter::SmoothPixmapTransform, true);
+        painter->drawPixmap(centeredRect, iconPixmap, QRectF(iconPixmap.rect()));
     }
 
     // Рисуем текст (имя файла)
@@ -159,5 +211,6 @@ bool ThumbnailDelegate::isImageFile(const QString& filePath) const
 {
     QFileInfo fileInfo(filePath);
     QString suffix = fileInfo.suffix().toLower();
-    return SUPPORTED_IMAGE_FORMATS.contains(suffix);
+    return SUPPORTED_IMAGE_FORMATS.contains(suffix) || RawPreview::supportedSuffixes().contains(suffix) ||
+           AudioCoverArt::supportedSuffixes().contains(suffix);
 }
\ No newline at end of file
@@ -0,0 +1,485 @@
+#include "thumbnailgenerator.h"
+#include "imagedecoder.h"
+#include "rawpreview.h"
+#include "audiocoverart.h"
+#include <QPainter>
+#include <QFileInfo>
+#include <QSvgRenderer>
+#include <QDir>
+#include <QDirIterator>
+#include <QDebug>
+#include <QImageReader>
+#include <QFile>
+#include <QBuffer>
+#include <algorithm>
+
+#ifdef Q_OS_WIN
+// Windows includes
+#include <windows.h>
+#include <wincodec.h>
+#pragma comment(lib, "windowscodecs.lib")
+#endif
+
+// Поддерживаемые форматы изображений
+static const QStringList SUPPORTED_IMAGE_FORMATS = {
+    "png", "jpg", "jpeg", "bmp", "gif", "tiff", "tif",
+    "webp", "ico", "svg"
+};
+
+QPixmap ThumbnailGenerator::loadJPEGViaWIC(const QString& filePath, const QSize& size)
+{
+#ifdef Q_OS_WIN
+    QPixmap result;
+
+    // Инициализация COM
+    HRESULT hr = CoInitializeEx(NULL, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE);
+    if (FAILED(hr)) {
+        qDebug() << "COM initialization failed:" << hr;
+        return result;
+    }
+
+    IWICImagingFactory* pFactory = NULL;
+    IWICBitmapDecoder* pDecoder = NULL;
+    IWICBitmapFrameDecode* pFrame = NULL;
+    IWICFormatConverter* pConverter = NULL;
+    IWICBitmapScaler* pScaler = NULL;
+
+    // Создаем фабрику WIC
+    hr = CoCreateInstance(
+        CLSID_WICImagingFactory,
+        NULL,
+        CLSCTX_INPROC_SERVER,
+        IID_PPV_ARGS(&pFactory)
+    );
+
+    if (SUCCEEDED(hr)) {
+        // Конвертируем QString в wchar_t*
+        std::wstring filePathW = filePath.toStdWString();
+
+        // Создаем декодер для файла
+        hr = pFactory->CreateDecoderFromFilename(
+            filePathW.c_str(),
+            NULL,
+            GENERIC_READ,
+            WICDecodeMetadataCacheOnLoad,
+            &pDecoder
+        );
+
+        if (SUCCEEDED(hr)) {
+            // Получаем первый кадр (для JPEG всегда один кадр)
+            hr = pDecoder->GetFrame(0, &pFrame);
+
+            if (SUCCEEDED(hr)) {
+                // Уменьшаем на этапе декодирования: для JPEG скейлер WIC использует
+                // масштабирование DCT, и полный кадр в память не попадает
+                IWICBitmapSource* pSource = pFrame;
+                UINT frameWidth = 0, frameHeight = 0;
+                pFrame->GetSize(&frameWidth, &frameHeight);
+                QSize frameSize(int(frameWidth), int(frameHeight));
+                if (frameSize.width() > size.width() || frameSize.height() > size.height()) {
+                    QSize fit = frameSize.scaled(size, Qt::KeepAspectRatio).expandedTo(QSize(1, 1));
+                    if (SUCCEEDED(pFactory->CreateBitmapScaler(&pScaler)) &&
+                        SUCCEEDED(pScaler->Initialize(pFrame, fit.width(), fit.height(), WICBitmapInterpolationModeFant))) {
+                        pSource = pScaler;
+                    }
+                }
+
+                // Создаем конвертер формата
+                hr = pFactory->CreateFormatConverter(&pConverter);
+
+                if (SUCCEEDED(hr)) {
+                    // Инициализируем конвертер в формат 32bpp PBGRA (совместимый с QImage)
+                    hr = pConverter->Initialize(
+                        pSource,
+                        GUID_WICPixelFormat32bppPBGRA,
+                        WICBitmapDitherTypeNone,
+                        NULL,
+                        0.0,
+                        WICBitmapPaletteTypeCustom
+                    );
+
+                    if (SUCCEEDED(hr)) {
+                        // Получаем размеры изображения
+                        UINT width = 0, height = 0;
+                        pConverter->GetSize(&width, &height);
+
+                        // Буфер декодирования учитывается в общем бюджете памяти миниатюр
+                        qint64 decodeBytes = qint64(width) * height * 4;
+                        if (width > 0 && height > 0 && ThumbnailMemoryCache::instance().reserveDecode(decodeBytes)) {
+                            // Создаем QImage для хранения данных
+                            QImage image(width, height, QImage::Format_ARGB32);
+
+                            // Копируем пиксели в QImage
+                            hr = pConverter->CopyPixels(
+                                NULL,
+                                width * 4, // stride
+                                width * height * 4, // buffer size
+                                reinterpret_cast<BYTE*>(image.bits())
+                            );
+
+                            if (SUCCEEDED(hr)) {
+                                // Доводим до нужного размера, если скейлер недоступен
+                                if (image.width() > size.width() || image.height() > size.height()) {
+                                    image = image.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+                                }
+                                result = QPixmap::fromImage(image);
+                            } else {
+                                qDebug() << "WIC CopyPixels failed:" << hr;
+                            }
+                            ThumbnailMemoryCache::instance().releaseDecode(decodeBytes);
+                        }
+                    } else {
+                        qDebug() << "WIC format converter initialization failed:" << hr;
+                    }
+                }
+            } else {
+                qDebug() << "WIC GetFrame failed:" << hr;
+            }
+        } else {
+            qDebug() << "WIC CreateDecoderFromFilename failed:" << hr;
+        }
+    } else {
+        qDebug() << "WIC CoCreateInstance failed:" << hr;
+    }
+
+    // Освобождение ресурсов
+    if (pConverter) pConverter->Release();
+    if (pScaler) pScaler->Release();
+    if (pFrame) pFrame->Release();
+    if (pDecoder) pDecoder->Release();
+    if (pFactory) pFactory->Release();
+
+    CoUninitialize();
+
+    return result;
+#else
+    // WIC есть только в Windows - JPEG декодируется через Qt
+    Q_UNUSED(filePath)
+    Q_UNUSED(size)
+    return QPixmap();
+#endif
+}
+
+QPixmap ThumbnailGenerator::generateThumbnail(const QString& filePath, const QSize& size)
+{
+    // Одиночный файл вне очереди (например, для миниатюры папки) - сигнатуру читаем здесь
+    FileSignature::Kind kind = FileSignature::sniffBatch({filePath}).value(filePath, FileSignature::Unknown);
+    return generateThumbnail(filePath, size, kind);
+}
+
+QPixmap ThumbnailGenerator::generateThumbnail(const QString& filePath, const QSize& size, FileSignature::Kind kind)
+{
+    // Папки - составная миниатюра из изображений внутри
+    if (QFileInfo(filePath).isDir()) {
+        return generateFolderThumbnail(filePath, size);
+    }
+
+    // Сначала проверяем кэш. Миниатюра меньше нужного размера (вид увеличили
+    // или перенесли на экран с большим DPR) декодируется заново, если из файла
+    // можно получить больше; до тех пор она остается запасным вариантом
+    QPixmap cachedPixmap = thumbnailCache.getThumbnail(filePath);
+    if (!cachedPixmap.isNull() && thumbnailCache.hasThumbnail(filePath, size)) {
+        // Если есть в кэше, масштабируем до нужного размера
+        return cachedPixmap.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+
+    // Файл уже не удалось декодировать ранее - не пытаемся снова.
+    // Аудио без обложки показывается обычной иконкой типа файла
+    if (thumbnailCache.isKnownFailure(filePath)) {
+        if (AudioCoverArt::isAudioFile(filePath)) {
+            return QPixmap();
+        }
+        return thumbnailCache.placeholder(QFileInfo(filePath).suffix(), size);
+    }
+
+    // Миниатюру уже создала другая программа (общий кэш freedesktop) - не декодируем
+    QPixmap sharedPixmap = cachedPixmap.isNull() ? thumbnailCache.loadSharedThumbnail(filePath, size) : QPixmap();
+    if (!sharedPixmap.isNull() &&
+        ThumbnailMemoryCache::levelFor(sharedPixmap.size()) >= ThumbnailMemoryCache::levelFor(size)) {
+        if (sharedPixmap.width() > size.width() || sharedPixmap.height() > size.height()) {
+            return sharedPixmap.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        }
+        return sharedPixmap;
+    }
+
+    // Файл не открылся (занят другой программой, нет доступа, сеть недоступна) -
+    // это не ошибка декодирования: в негативный кэш не пишем, попробуем позже
+    if (kind == FileSignature::Unreadable) {
+        qDebug() << "File is not readable now, thumbnail deferred:" << filePath;
+        return QPixmap();
+    }
+
+    // Содержимое не похоже ни на один поддерживаемый формат (например, текст с
+    // расширением .jpg) - сразу в негативный кэш, без медленной попытки декодирования
+    if (kind == FileSignature::Unknown) {
+        qDebug() << "Unrecognized file signature, skipping thumbnail:" << filePath;
+        thumbnailCache.markFailed(filePath);
+        // mp3 без тега ID3 не распознается по сигнатуре, но обложки у него и нет
+        if (AudioCoverArt::isAudioFile(filePath)) {
+            return QPixmap();
+        }
+        return thumbnailCache.placeholder(QFileInfo(filePath).suffix(), size);
+    }
+
+    // Декодируем один раз в размере базовой миниатюры (в физических пикселях):
+    // уровни для любого масштаба и DPR строятся из нее без повторного декодирования
+    QSize decodeSize = size.expandedTo(QSize(BASE_THUMBNAIL_EDGE, BASE_THUMBNAIL_EDGE))
+                           .boundedTo(QSize(MAX_STORED_THUMBNAIL_EDGE, MAX_STORED_THUMBNAIL_EDGE));
+
+    QPixmap pixmap;
+    bool outOfBudget = false;
+    bool tooLarge = false;
+
+    try {
+        // Для SVG файлов
+        if (kind == FileSignature::Svg) {
+            QSvgRenderer renderer(filePath);
+            if (renderer.isValid()) {
+                QPixmap svgPixmap(decodeSize);
+                svgPixmap.fill(Qt::transparent);
+                QPainter painter(&svgPixmap);
+                renderer.render(&painter);
+                pixmap = svgPixmap;
+            }
+        }
+        // RAW-файлы камер: встроенное JPEG-превью без демозаики, дальше - путь JPEG
+        else if (kind == FileSignature::Raw) {
+            int orientation = 1;
+            QImage image = RawPreview::decodeLargestJpeg(filePath, [&](QByteArray& jpeg) {
+                // Бюджет занят - меньшие превью не пробуем, файл декодируем позже
+                if (outOfBudget) {
+                    return QImage();
+                }
+                QBuffer buffer(&jpeg);
+                buffer.open(QIODevice::ReadOnly);
+                QImage decoded = ImageDecoder::decodeBounded(&buffer, decodeSize);
+                outOfBudget = ImageDecoder::lastDecodeOutOfBudget();
+                tooLarge = ImageDecoder::lastDecodeTooLarge();
+                return decoded;
+            }, &orientation);
+            if (!image.isNull()) {
+                pixmap = QPixmap::fromImage(RawPreview::applyOrientation(image, orientation));
+            }
+        }
+        // Аудиофайлы: обложка из тегов (ID3v2, FLAC PICTURE, MP4 covr)
+        else if (kind == FileSignature::AudioId3 || kind == FileSignature::AudioFlac ||
+                 kind == FileSignature::AudioMp4) {
+            QByteArray cover = AudioCoverArt::extract(filePath);
+            if (!cover.isEmpty()) {
+                QBuffer buffer(&cover);
+                buffer.open(QIODevice::ReadOnly);
+                QImage image = ImageDecoder::decodeBounded(&buffer, decodeSize);
+                outOfBudget = ImageDecoder::lastDecodeOutOfBudget();
+                tooLarge = ImageDecoder::lastDecodeTooLarge();
+                if (!image.isNull()) {
+                    pixmap = QPixmap::fromImage(image);
+                }
+            }
+        }
+        // Для JPEG файлов используем WIC
+        else if (kind == FileSignature::Jpeg) {
+            pixmap = loadJPEGViaWIC(filePath, decodeSize);
+
+            if (pixmap.isNull()) {
+                // Резервный метод через Qt с ограничением памяти
+                QImage image = ImageDecoder::decodeBounded(filePath, decodeSize, "jpeg");
+                outOfBudget = ImageDecoder::lastDecodeOutOfBudget();
+                tooLarge = ImageDecoder::lastDecodeTooLarge();
+                if (!image.isNull()) {
+                    pixmap = QPixmap::fromImage(image);
+                }
+            }
+        }
+        // Для остальных форматов - декодирование с ограничением памяти:
+        // масштабированное чтение, чтение полосами или потоковое уменьшение.
+        // Формат задаем по сигнатуре, чтобы файл с чужим расширением читался своим обработчиком
+        else {
+            QImage image = ImageDecoder::decodeBounded(filePath, decodeSize, FileSignature::readerFormat(kind));
+            outOfBudget = ImageDecoder::lastDecodeOutOfBudget();
+            tooLarge = ImageDecoder::lastDecodeTooLarge();
+            if (!image.isNull()) {
+                pixmap = QPixmap::fromImage(image);
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        qDebug() << "Exception while generating thumbnail for" << filePath << ":" << e.what();
+    }
+    catch (...) {
+        qDebug() << "Unknown exception while generating thumbnail for" << filePath;
+    }
+
+    // Если все методы не сработали - запоминаем ошибку и отдаем общую заглушку,
+    // не записывая отдельную миниатюру на диск. Нехватка памяти под буфер
+    // декодирования - не ошибка файла: его декодируем, когда бюджет освободится
+    if (pixmap.isNull() && !cachedPixmap.isNull()) {
+        // Увеличенная миниатюра не получилась - остаемся на прежней; при нехватке
+        // памяти попробуем еще раз позже
+        if (!outOfBudget) {
+            thumbnailCache.markBestAvailable(filePath);
+        }
+        return cachedPixmap.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+    if (pixmap.isNull() && outOfBudget) {
+        qDebug() << "Decode budget exhausted, thumbnail deferred:" << filePath;
+        return QPixmap();
+    }
+    if (pixmap.isNull()) {
+        // Кадр больше всего бюджета - файл исправен, в постоянный список ошибок
+        // его не заносим: после перезапуска (например, с большим бюджетом) попробуем снова
+        thumbnailCache.markFailed(filePath, !tooLarge);
+        // Обложки нет - это обычный аудиофайл, а не битое изображение
+        if (kind == FileSignature::AudioId3 || kind == FileSignature::AudioFlac ||
+            kind == FileSignature::AudioMp4) {
+            return QPixmap();
+        }
+        return thumbnailCache.placeholder(QFileInfo(filePath).suffix(), size);
+    }
+
+    // Сохраняем в кэш базовую миниатюру (не больше MAX_STORED_THUMBNAIL_EDGE).
+    // Меньше запрошенной она только потому, что больше не получить, - повторно
+    // из-за размера файл в очередь не ставим
+    thumbnailCache.storeThumbnail(filePath, pixmap);
+    if (ThumbnailMemoryCache::levelFor(pixmap.size()) < ThumbnailMemoryCache::levelFor(size)) {
+        thumbnailCache.markBestAvailable(filePath);
+    }
+
+    // Возвращаем версию нужного размера
+    if (pixmap.width() > size.width() || pixmap.height() > size.height()) {
+        return pixmap.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+    return pixmap;
+}
+
+QPixmap ThumbnailGenerator::generateFolderThumbnail(const QString& dirPath, const QSize& size)
+{
+    // Составная миниатюра хранится в кэше под путем папки и датой ее изменения,
+    // поэтому добавление и удаление файлов делают ее устаревшей.
+    // Собрана она под конкретный уровень масштаба: меньшую при увеличении
+    // собираем заново, иначе она растягивается и мылится
+    QPixmap cachedPixmap = thumbnailCache.getFolderThumbnail(QFileInfo(dirPath), size);
+    if (thumbnailCache.isKnownFailure(dirPath)) {
+        return cachedPixmap;
+    }
+    if (!cachedPixmap.isNull() &&
+        ThumbnailMemoryCache::levelFor(cachedPixmap.size()) >= ThumbnailMemoryCache::levelFor(size)) {
+        return cachedPixmap;
+    }
+
+    QStringList nameFilters;
+    for (const QString& suffix : SUPPORTED_IMAGE_FORMATS) {
+        nameFilters << "*." + suffix;
+    }
+    for (const QString& suffix : RawPreview::supportedSuffixes()) {
+        nameFilters << "*." + suffix;
+    }
+
+    // Имена читаем все, а сортируем только первые MAX_FOLDER_SCAN_ENTRIES: в превью
+    // должны попасть первые по имени файлы, а не первые в порядке файловой системы
+    QStringList names;
+    QDirIterator it(dirPath, nameFilters, QDir::Files | QDir::Readable);
+    while (it.hasNext()) {
+        it.next();
+        names.append(it.fileName());
+    }
+    const qsizetype scanned = qMin<qsizetype>(names.size(), MAX_FOLDER_SCAN_ENTRIES);
+    std::partial_sort(names.begin(), names.begin() + scanned, names.end(),
+                      [](const QString& a, const QString& b) {
+                          return a.compare(b, Qt::CaseInsensitive) < 0;
+                      });
+
+    const QDir dir(dirPath);
+    QStringList candidates;
+    for (qsizetype i = 0; i < scanned; ++i) {
+        candidates.append(dir.filePath(names[i]));
+    }
+
+    const int gap = qMax(2, qMax(size.width(), size.height()) / 64);
+    const QSize cellSize((size.width() - gap) / 2, (size.height() - gap) / 2);
+
+    QList<QPixmap> tiles;
+    int decodes = 0;
+    for (const QString& filePath : candidates) {
+        if (tiles.size() >= MAX_FOLDER_PREVIEW_IMAGES) {
+            break;
+        }
+        if (thumbnailCache.isKnownFailure(filePath)) {
+            continue;
+        }
+
+        // Сначала готовые миниатюры (память или диск), декодируем только недостающие
+        QPixmap tile = thumbnailCache.getThumbnail(filePath, cellSize);
+        if (tile.isNull() && decodes < MAX_FOLDER_DECODES) {
+            decodes++;
+            tile = generateThumbnail(filePath, cellSize);
+            if (thumbnailCache.isKnownFailure(filePath)) {
+                continue;
+            }
+        }
+        if (!tile.isNull()) {
+            tiles.append(tile);
+        }
+    }
+
+    // Изображений нет - запоминаем до перезапуска, чтобы не сканировать папку снова
+    // до ее изменения; в файл ошибок декодирования папка не попадает
+    if (tiles.isEmpty()) {
+        thumbnailCache.markFailed(dirPath, false);
+        return QPixmap();
+    }
+
+    // Раскладка: одно изображение - целиком, два - рядом, три-четыре - сеткой 2x2
+    QList<QRect> cells;
+    if (tiles.size() == 1) {
+        cells << QRect(QPoint(0, 0), size);
+    } else if (tiles.size() == 2) {
+        cells << QRect(0, 0, cellSize.width(), size.height())
+              << QRect(cellSize.width() + gap, 0, cellSize.width(), size.height());
+    } else {
+        for (int i = 0; i < tiles.size(); ++i) {
+            cells << QRect((i % 2) * (cellSize.width() + gap), (i / 2) * (cellSize.height() + gap),
+                           cellSize.width(), cellSize.height());
+        }
+    }
+
+    QPixmap composite(size);
+    composite.fill(Qt::transparent);
+    QPainter painter(&composite);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
+    for (int i = 0; i < tiles.size(); ++i) {
+        const QPixmap& tile = tiles[i];
+        const QRect& cell = cells[i];
+
+        // Обрезаем по центру, чтобы заполнить ячейку без искажения пропорций
+        QSizeF sourceSize = QSizeF(cell.size()).scaled(QSizeF(tile.size()), Qt::KeepAspectRatio);
+        QRectF source((tile.width() - sourceSize.width()) / 2, (tile.height() - sourceSize.height()) / 2,
+                      sourceSize.width(), sourceSize.height());
+        painter.drawPixmap(QRectF(cell), tile, source);
+    }
+    painter.end();
+
+    thumbnailCache.storeFolderThumbnail(dirPath, composite);
+    return composite;
+}
+
+bool ThumbnailGenerator::isThumbnailSuffix(const QString& suffix)
+{
+    QString lowerSuffix = suffix.toLower();
+    return SUPPORTED_IMAGE_FORMATS.contains(lowerSuffix) || RawPreview::supportedSuffixes().contains(lowerSuffix) ||
+           AudioCoverArt::supportedSuffixes().contains(lowerSuffix);
+}
+
+bool ThumbnailGenerator::isPreviewFolder(const QString& filePath)
+{
+    // Корни дисков показываем иконкой с размером диска
+    QFileInfo fileInfo(filePath);
+    return fileInfo.isDir() && !QDir(filePath).isRoot();
+}
+
+bool ThumbnailGenerator::isThumbnailFile(const QString& filePath)
+{
+    QFileInfo fileInfo(filePath);
+    if (!fileInfo.isFile()) return false;
+
+    return isThumbnailSuffix(fileInfo.suffix());
+}
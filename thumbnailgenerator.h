@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QPixmap>
+#include <QSize>
+#include <QString>
+#include "thumbnailcache.h"
+#include "filesignature.h"
+
+// Генерация миниатюр без виджетов: выбор декодера по сигнатуре, составные
+// миниатюры папок и запись в ThumbnailCache. Используется ThumbnailView
+// и консольным режимом прогрева кэша; методы можно вызывать из разных потоков.
+class ThumbnailGenerator
+{
+public:
+    QPixmap generateThumbnail(const QString& filePath, const QSize& size);
+    // Декодер выбирается по сигнатуре содержимого, а не по расширению
+    QPixmap generateThumbnail(const QString& filePath, const QSize& size, FileSignature::Kind kind);
+    QPixmap generateFolderThumbnail(const QString& dirPath, const QSize& size);
+
+    static bool isThumbnailFile(const QString& filePath);
+    static bool isThumbnailSuffix(const QString& suffix);
+    static bool isPreviewFolder(const QString& filePath);
+
+private:
+    QPixmap loadJPEGViaWIC(const QString& filePath, const QSize& size);
+
+    ThumbnailCache &thumbnailCache = ThumbnailCache::instance();
+
+    // Базовая миниатюра в кэше (физические пиксели): покрывает 1x-2x DPR при обычном масштабе
+    const int BASE_THUMBNAIL_EDGE = 512;
+    const int MAX_STORED_THUMBNAIL_EDGE = 1024;
+
+    // Составные миниатюры папок
+    const int MAX_FOLDER_PREVIEW_IMAGES = 4;
+    const int MAX_FOLDER_SCAN_ENTRIES = 256; // Сколько файлов папки просматривать
+    const int MAX_FOLDER_DECODES = 8;        // Сколько изображений декодировать, если их нет в кэше
+};
@@ -0,0 +1,302 @@
+#include "thumbnailmemorycache.h"
+#include <QMutexLocker>
+#include <QSettings>
+#include <QDebug>
+#include <QVector>
+#include <algorithm>
+#include <iterator>
+
+ThumbnailMemoryCache& ThumbnailMemoryCache::instance()
+{
+    static ThumbnailMemoryCache instance;
+    return instance;
+}
+
+ThumbnailMemoryCache::ThumbnailMemoryCache()
+{
+    // Бюджет настраивается одним значением в мегабайтах
+    QSettings settings;
+    qint64 budgetMb = settings.value("thumbnailCache/memoryBudgetMB", DEFAULT_BUDGET_MB).toLongLong();
+    budgetBytes = qMax<qint64>(16, budgetMb) * 1024 * 1024;
+
+    qDebug() << "Thumbnail memory budget:" << budgetBytes / (1024 * 1024) << "MB";
+}
+
+qint64 ThumbnailMemoryCache::pixmapBytes(const QPixmap& pixmap)
+{
+    if (pixmap.isNull()) {
+        return 0;
+    }
+    // Реальный объем пикселей с учетом глубины цвета
+    return qint64(pixmap.width()) * pixmap.height() * qMax(1, pixmap.depth()) / 8;
+}
+
+void ThumbnailMemoryCache::setBudget(qint64 bytes)
+{
+    QMutexLocker locker(&mutex);
+    budgetBytes = qMax<qint64>(16 * 1024 * 1024, bytes);
+    evictLocked(0);
+}
+
+qint64 ThumbnailMemoryCache::budget() const
+{
+    QMutexLocker locker(&mutex);
+    return budgetBytes;
+}
+
+bool ThumbnailMemoryCache::contains(const QString& key) const
+{
+    QMutexLocker locker(&mutex);
+    return entries.contains(key);
+}
+
+int ThumbnailMemoryCache::topLevel(const QString& key) const
+{
+    QMutexLocker locker(&mutex);
+    auto it = entries.constFind(key);
+    if (it == entries.constEnd() || it->isEmpty()) {
+        return 0;
+    }
+    return it->lastKey();
+}
+
+QPixmap ThumbnailMemoryCache::find(const QString& key, int minEdge)
+{
+    QMutexLocker locker(&mutex);
+    auto it = entries.find(key);
+    if (it == entries.end() || it->isEmpty()) {
+        return QPixmap();
+    }
+
+    // Наименьший уровень, не меньше запрошенного, иначе самый большой
+    auto levelIt = it->lowerBound(minEdge);
+    if (levelIt == it->end()) {
+        levelIt = std::prev(it->end());
+    }
+    levelIt->lastUse = ++useCounter;
+    return levelIt->pixmap;
+}
+
+QPixmap ThumbnailMemoryCache::findLevel(const QString& key, int edge)
+{
+    QMutexLocker locker(&mutex);
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        return QPixmap();
+    }
+
+    auto levelIt = it->find(edge);
+    if (levelIt == it->end()) {
+        return QPixmap();
+    }
+    levelIt->lastUse = ++useCounter;
+    return levelIt->pixmap;
+}
+
+QPixmap ThumbnailMemoryCache::findBase(const QString& key)
+{
+    QMutexLocker locker(&mutex);
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        return QPixmap();
+    }
+
+    for (auto levelIt = it->begin(); levelIt != it->end(); ++levelIt) {
+        if (levelIt->base) {
+            levelIt->lastUse = ++useCounter;
+            return levelIt->pixmap;
+        }
+    }
+    return QPixmap();
+}
+
+void ThumbnailMemoryCache::insert(const QString& key, const QPixmap& pixmap, bool base)
+{
+    if (pixmap.isNull()) {
+        return;
+    }
+
+    QMutexLocker locker(&mutex);
+
+    int level = levelFor(pixmap.size());
+    removeLevelLocked(key, level);
+
+    Entry entry;
+    entry.pixmap = pixmap;
+    entry.bytes = pixmapBytes(pixmap);
+    entry.lastUse = ++useCounter;
+    entry.base = base;
+
+    // Миниатюра больше всего бюджета не кэшируется
+    if (entry.bytes > budgetBytes) {
+        return;
+    }
+
+    evictLocked(entry.bytes);
+
+    entries[key].insert(level, entry);
+    usedBytes += entry.bytes;
+    levelCount++;
+}
+
+void ThumbnailMemoryCache::remove(const QString& key)
+{
+    QMutexLocker locker(&mutex);
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        return;
+    }
+
+    for (const Entry& entry : *it) {
+        usedBytes -= entry.bytes;
+        levelCount--;
+    }
+    entries.erase(it);
+}
+
+void ThumbnailMemoryCache::rename(const QString& oldKey, const QString& newKey)
+{
+    QMutexLocker locker(&mutex);
+    auto it = entries.find(oldKey);
+    if (it == entries.end() || oldKey == newKey) {
+        return;
+    }
+
+    QMap<int, Entry> levels = it.value();
+    entries.erase(it);
+
+    // Уровни, оставшиеся от прежнего файла с новым именем, больше не нужны
+    auto existing = entries.find(newKey);
+    if (existing != entries.end()) {
+        for (const Entry& entry : *existing) {
+            usedBytes -= entry.bytes;
+            levelCount--;
+        }
+        entries.erase(existing);
+    }
+
+    entries.insert(newKey, levels);
+}
+
+void ThumbnailMemoryCache::clear()
+{
+    QMutexLocker locker(&mutex);
+    entries.clear();
+    usedBytes = 0;
+    levelCount = 0;
+}
+
+bool ThumbnailMemoryCache::reserveDecode(qint64 bytes)
+{
+    QMutexLocker locker(&mutex);
+    if (bytes > budgetBytes) {
+        return false;
+    }
+
+    evictLocked(bytes);
+    decodeBytes += bytes;
+    return true;
+}
+
+void ThumbnailMemoryCache::releaseDecode(qint64 bytes)
+{
+    QMutexLocker locker(&mutex);
+    decodeBytes = qMax<qint64>(0, decodeBytes - bytes);
+}
+
+bool ThumbnailMemoryCache::reservePooled(qint64 bytes)
+{
+    QMutexLocker locker(&mutex);
+    // Пул занимает только запас, который вытеснение и так оставляет свободным
+    const qint64 limit = budgetBytes - budgetBytes / 10;
+    if (usedBytes + decodeBytes + pooledBytes + bytes > limit) {
+        return false;
+    }
+    pooledBytes += bytes;
+    return true;
+}
+
+void ThumbnailMemoryCache::releasePooled(qint64 bytes)
+{
+    QMutexLocker locker(&mutex);
+    pooledBytes = qMax<qint64>(0, pooledBytes - bytes);
+}
+
+ThumbnailMemoryCache::Usage ThumbnailMemoryCache::usage() const
+{
+    QMutexLocker locker(&mutex);
+    Usage result;
+    result.budgetBytes = budgetBytes;
+    result.pixmapBytes = usedBytes;
+    result.decodeBytes = decodeBytes;
+    result.pooledBytes = pooledBytes;
+    result.entries = entries.size();
+    result.levels = levelCount;
+    result.evictions = evictionCount;
+    return result;
+}
+
+void ThumbnailMemoryCache::removeLevelLocked(const QString& key, int level)
+{
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        return;
+    }
+
+    auto levelIt = it->find(level);
+    if (levelIt != it->end()) {
+        usedBytes -= levelIt->bytes;
+        levelCount--;
+        it->erase(levelIt);
+    }
+
+    if (it->isEmpty()) {
+        entries.erase(it);
+    }
+}
+
+void ThumbnailMemoryCache::evictLocked(qint64 incomingBytes)
+{
+    if (usedBytes + decodeBytes + pooledBytes + incomingBytes <= budgetBytes) {
+        return;
+    }
+
+    // Освобождаем с запасом (до 90% бюджета), чтобы не вытеснять на каждой вставке
+    const qint64 target = budgetBytes - budgetBytes / 10;
+
+    struct Candidate {
+        QString key;
+        int level;
+        quint64 lastUse;
+        bool largerLevel;
+    };
+
+    QVector<Candidate> candidates;
+    candidates.reserve(levelCount);
+    for (auto it = entries.cbegin(); it != entries.cend(); ++it) {
+        const int smallestLevel = it->firstKey();
+        for (auto levelIt = it->cbegin(); levelIt != it->cend(); ++levelIt) {
+            candidates.append({it.key(), levelIt.key(), levelIt->lastUse, levelIt.key() != smallestLevel});
+        }
+    }
+
+    // Сначала крупные уровни (их легко восстановить из меньших/диска),
+    // внутри каждой группы - давно не использованные
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        if (a.largerLevel != b.largerLevel) {
+            return a.largerLevel;
+        }
+        if (a.largerLevel && a.level != b.level) {
+            return a.level > b.level;
+        }
+        return a.lastUse < b.lastUse;
+    });
+
+    for (const Candidate& candidate : candidates) {
+        if (usedBytes + decodeBytes + pooledBytes + incomingBytes <= target) {
+            break;
+        }
+        removeLevelLocked(candidate.key, candidate.level);
+        evictionCount++;
+    }
+}
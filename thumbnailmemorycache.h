@@ -0,0 +1,89 @@
+#pragma once
+
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QPixmap>
+#include <QSize>
+#include <QString>
+
+// Единый менеджер памяти для миниатюр: учитывает реальный размер в байтах
+// для всех уровней масштаба (mip-уровней) и временных буферов декодирования.
+class ThumbnailMemoryCache
+{
+public:
+    struct Usage {
+        qint64 budgetBytes = 0;   // Настроенный бюджет
+        qint64 pixmapBytes = 0;   // Занято миниатюрами (все уровни)
+        qint64 decodeBytes = 0;   // Зарезервировано буферами декодирования
+        qint64 pooledBytes = 0;   // Свободные буферы в пуле декодирования
+        int entries = 0;          // Количество файлов в кэше
+        int levels = 0;           // Количество уровней масштаба
+        quint64 evictions = 0;    // Сколько уровней вытеснено с момента запуска
+    };
+
+    static ThumbnailMemoryCache& instance();
+
+    void setBudget(qint64 bytes);
+    qint64 budget() const;
+
+    bool contains(const QString& key) const;
+    // Размер стороны наибольшего уровня; 0 - уровней нет
+    int topLevel(const QString& key) const;
+    // Возвращает наименьший уровень, покрывающий minEdge (или наибольший имеющийся)
+    QPixmap find(const QString& key, int minEdge = 0);
+    // Возвращает уровень точно заданного размера стороны
+    QPixmap findLevel(const QString& key, int edge);
+    // Возвращает базовую миниатюру, из которой строятся уровни
+    QPixmap findBase(const QString& key);
+    // base - миниатюра в полном разрешении кэша (с диска или после декодирования)
+    void insert(const QString& key, const QPixmap& pixmap, bool base = false);
+    void remove(const QString& key);
+    // Переносит все уровни на новый ключ (файл переименован или перемещен)
+    void rename(const QString& oldKey, const QString& newKey);
+    void clear();
+
+    // Учет временных буферов декодирования. reserveDecode может вытеснить
+    // миниатюры, чтобы освободить место; возвращает false, если буфер
+    // больше всего бюджета.
+    bool reserveDecode(qint64 bytes);
+    void releaseDecode(qint64 bytes);
+
+    // Учет свободных буферов пула декодирования: они тоже занимают бюджет,
+    // но ради них миниатюры не вытесняются. false - места нет, буфер
+    // нужно вернуть в malloc
+    bool reservePooled(qint64 bytes);
+    void releasePooled(qint64 bytes);
+
+    Usage usage() const;
+
+    static qint64 pixmapBytes(const QPixmap& pixmap);
+    static int levelFor(const QSize& size) { return qMax(size.width(), size.height()); }
+
+private:
+    ThumbnailMemoryCache();
+    ~ThumbnailMemoryCache() = default;
+
+    struct Entry {
+        QPixmap pixmap;
+        qint64 bytes = 0;
+        quint64 lastUse = 0;
+        bool base = false;
+    };
+
+    void evictLocked(qint64 incomingBytes);
+    void removeLevelLocked(const QString& key, int level);
+
+    // ключ файла -> (размер стороны уровня -> уровень)
+    QHash<QString, QMap<int, Entry>> entries;
+    qint64 budgetBytes;
+    qint64 usedBytes = 0;
+    qint64 decodeBytes = 0;
+    qint64 pooledBytes = 0;
+    int levelCount = 0;
+    quint64 useCounter = 0;
+    quint64 evictionCount = 0;
+    mutable QMutex mutex;
+
+    static constexpr qint64 DEFAULT_BUDGET_MB = 256;
+};
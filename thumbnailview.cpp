@@ -5,6 +5,7 @@
 #include <QPainter>
 #include <QFuture>
 #include <QtConcurrent>
+#include <QPromise>
 #include <QFileInfo>
 #include <QMimeDatabase>
 #include <QSvgRenderer>
@@ -16,22 +17,15 @@
 #include <QFile>
 #include <QBuffer>
 #include <QWheelEvent>
+#include <QMouseEvent>
 #include <QSettings>
-
-// Windows includes
-#include <windows.h>
-#include <wincodec.h>
-#pragma comment(lib, "windowscodecs.lib")
-
-// Поддерживаемые форматы изображений
-static const QStringList SUPPORTED_IMAGE_FORMATS = {
-    "png", "jpg", "jpeg", "bmp", "gif", "tiff", "tif",
-    "webp", "ico", "svg"
-};
+#include <QtMath>
 
 ThumbnailView::ThumbnailView(QWidget *parent)
     : QListView(parent)
     , delegate(new ThumbnailDelegate(this, this))
+    , fileWatcher(new ThumbnailWatcher(this))
+    , animatedPreviews(new AnimatedPreviews(this))
 {
     setViewMode(QListView::IconMode);
     setResizeMode(QListView::Adjust);
@@ -48,9 +42,6 @@ ThumbnailView::ThumbnailView(QWidget *parent)
     // Устанавливаем кастомный делегат
     setItemDelegate(delegate);
 
-    // Увеличиваем лимит кэша pixmap для больших изображений
-    QPixmapCache::setCacheLimit(51200); // 50MB вместо стандартных 10MB
-
     // Таймер для отложенной загрузки миниатюр
     loadTimer = new QTimer(this);
     loadTimer->setSingleShot(true);
@@ -65,6 +56,15 @@ ThumbnailView::ThumbnailView(QWidget *parent)
     // Подключаем скроллинг для динамической загрузки
     connect(verticalScrollBar(), &QScrollBar::valueChanged, this, &ThumbnailView::onScroll);
 
+    // Изменения файлов в папке: переименованные миниатюры переносятся в кэше,
+    // измененные и новые файлы сразу ставятся в очередь
+    connect(fileWatcher, &ThumbnailWatcher::thumbnailsInvalidated, this, &ThumbnailView::onThumbnailsInvalidated);
+    connect(fileWatcher, &ThumbnailWatcher::thumbnailsMoved, viewport(), qOverload<>(&QWidget::update));
+
+    // Анимированные превью - для элемента под курсором и выделенных
+    setMouseTracking(true);
+    connect(animatedPreviews, &AnimatedPreviews::frameChanged, this, &ThumbnailView::onAnimatedFrameChanged);
+
     // Диагностика доступных форматов
     qDebug() << "Available image formats:" << QImageReader::supportedImageFormats();
 }
@@ -87,6 +87,11 @@ ThumbnailView::~ThumbnailView()
     }
     activeWatchers.clear();
 
+    // Сохраняем крошечные превью текущей папки
+    if (!currentPath.isEmpty()) {
+        thumbnailCache.saveTinyPreviews(currentPath);
+    }
+
     delete delegate;
 }
 
@@ -96,6 +101,99 @@ void ThumbnailView::resizeEvent(QResizeEvent *event)
     updateGridSize();
 }
 
+void ThumbnailView::hideEvent(QHideEvent *event)
+{
+    QListView::hideEvent(event);
+    // Невидимые анимации не должны тратить процессор
+    animatedPreviews->clear();
+}
+
+void ThumbnailView::mouseMoveEvent(QMouseEvent *event)
+{
+    QListView::mouseMoveEvent(event);
+
+    QModelIndex index = indexAt(event->position().toPoint());
+    if (hoveredIndex != index) {
+        hoveredIndex = index;
+        updateAnimatedPreviews();
+    }
+}
+
+void ThumbnailView::leaveEvent(QEvent *event)
+{
+    QListView::leaveEvent(event);
+
+    if (hoveredIndex.isValid()) {
+        hoveredIndex = QPersistentModelIndex();
+        updateAnimatedPreviews();
+    }
+}
+
+void ThumbnailView::selectionChanged(const QItemSelection &selected, const QItemSelection &deselected)
+{
+    QListView::selectionChanged(selected, deselected);
+    updateAnimatedPreviews();
+}
+
+void ThumbnailView::updateAnimatedPreviews()
+{
+    QFileSystemModel *fsModel = qobject_cast<QFileSystemModel*>(model());
+    if (!fsModel || !isVisible() || animatedPreviews->maxActive() <= 0) {
+        return;
+    }
+
+    // Приоритет у элемента под курсором, затем выделенные - только видимые на экране
+    QStringList targets;
+    QRect viewportRect = viewport()->rect();
+    auto consider = [&](const QModelIndex& index) {
+        if (!index.isValid() || !viewportRect.intersects(visualRect(index))) {
+            return;
+        }
+        QString filePath = fsModel->filePath(index);
+        if (AnimatedPreviews::isAnimatedSuffix(QFileInfo(filePath).suffix()) && !targets.contains(filePath)) {
+            targets.append(filePath);
+        }
+    };
+
+    consider(hoveredIndex);
+
+    // Выделенные ищем среди видимых строк, а не перебором всего выделения:
+    // при наведении список выделенных иначе строился бы заново на каждое движение
+    QItemSelectionModel *selection = selectionModel();
+    if (selection && selection->hasSelection()) {
+        QModelIndex rootIdx = rootIndex();
+        int rowCount = fsModel->rowCount(rootIdx);
+        QModelIndex firstVisible = indexAt(viewportRect.topLeft());
+        for (int row = firstVisible.isValid() ? firstVisible.row() : 0;
+             row < rowCount && targets.size() < animatedPreviews->maxActive(); ++row) {
+            QModelIndex index = fsModel->index(row, 0, rootIdx);
+            QRect rect = visualRect(index);
+            if (rect.top() > viewportRect.bottom()) {
+                break;
+            }
+            if (selection->isSelected(index)) {
+                consider(index);
+            }
+        }
+    }
+
+    animatedPreviews->setTargets(targets, thumbnailRequestSize());
+    animatedPreviews->setPaused(false);
+}
+
+void ThumbnailView::onAnimatedFrameChanged(const QString& filePath)
+{
+    // Перерисовываем только ячейку анимированного элемента
+    QFileSystemModel *fsModel = qobject_cast<QFileSystemModel*>(model());
+    if (!fsModel) {
+        return;
+    }
+    QModelIndex index = fsModel->index(filePath);
+    if (index.isValid()) {
+        viewport()->update(visualRect(index));
+    }
+}
+
 void ThumbnailView::showEvent(QShowEvent *event)
 {
     QListView::showEvent(event);
@@ -107,6 +205,24 @@ void ThumbnailView::showEvent(QShowEvent *event)
     }
 }
 
+bool ThumbnailView::event(QEvent *event)
+{
+    // Окно перенесли на экран с другим масштабом - догружаем уровни под новый DPR
+    if (event->type() == QEvent::DevicePixelRatioChange) {
+        viewport()->update();
+        if (isVisible()) {
+            loadTimer->start();
+        }
+    }
+    return QListView::event(event);
+}
+
+QSize ThumbnailView::thumbnailRequestSize() const
+{
+    qreal dpr = viewport()->devicePixelRatioF();
+    return QSize(qCeil(thumbnailSize.width() * dpr), qCeil(thumbnailSize.height() * dpr));
+}
+
 void ThumbnailView::wheelEvent(QWheelEvent *event)
 {
     if (event->modifiers() & Qt::ControlModifier) {
@@ -149,6 +265,11 @@ void ThumbnailView::setThumbnailScaleFactor(double factor)
     // Обновляем отображение
     viewport()->update();
 
+    // При увеличении видимые миниатюры могут оказаться меньше нужного - догружаем
+    if (isVisible()) {
+        loadTimer->start();
+    }
+
     qDebug() << "Thumbnail scale factor changed to:" << thumbnailScaleFactor;
 }
 
@@ -184,8 +305,21 @@ void ThumbnailView::updateGridSize()
 
 void ThumbnailView::onDirectoryLoaded(const QString &path)
 {
+    // Сохраняем крошечные превью предыдущей папки и загружаем таблицу новой одним чтением
+    if (path != currentPath) {
+        if (!currentPath.isEmpty()) {
+            thumbnailCache.saveTinyPreviews(currentPath);
+        }
+        thumbnailCache.loadTinyPreviews(path);
+    }
+
+    // Анимации предыдущей папки больше не видны
+    animatedPreviews->clear();
+    hoveredIndex = QPersistentModelIndex();
+
     // Сохраняем текущий путь
     currentPath = path;
+    fileWatcher->setDirectory(path);
 
     // Загружаем масштаб для этой папки
     loadThumbnailScaleFactor();
@@ -216,6 +350,10 @@ void ThumbnailView::onDirectoryLoaded(const QString &path)
 
 void ThumbnailView::onScroll()
 {
+    // Во время прокрутки анимации стоят, чтобы она оставалась плавной;
+    // продолжатся после остановки вместе с загрузкой видимых миниатюр
+    animatedPreviews->setPaused(true);
+
     // При скроллинге загружаем видимые миниатюры
     if (isVisible()) {
         loadTimer->start(Styles::ScrollLoadDelay);
@@ -232,6 +370,26 @@ void ThumbnailView::addToQueue(const QStringList& files)
     }
 }
 
+void ThumbnailView::onThumbnailsInvalidated(const QStringList& filePaths)
+{
+    // Файл мог быть в работе со старым содержимым - ставим его в очередь заново
+    for (const QString& filePath : filePaths) {
+        if (!thumbnailQueue.contains(filePath)) {
+            pendingThumbnails.remove(filePath);
+        }
+    }
+    addToQueue(filePaths);
+
+    // Измененный файл мог стать анимированным (или перестать им быть)
+    animatedPreviews->invalidate(filePaths);
+    updateAnimatedPreviews();
+
+    if (isVisible() && !queueTimer->isActive()) {
+        queueTimer->start();
+    }
+    viewport()->update();
+}
+
 void ThumbnailView::processThumbnailQueue()
 {
     // Если уже есть максимальное количество активных загрузок, ждем
@@ -256,8 +414,8 @@ void ThumbnailView::processThumbnailQueue()
     QStringList filesToLoad;
     for (int i = 0; i < BATCH_SIZE && !thumbnailQueue.isEmpty(); ++i) {
         QString filePath = thumbnailQueue.dequeue();
-        // Проверяем, нет ли уже миниатюры в кэше
-        if (!thumbnailCache.hasThumbnail(filePath)) {
+        // Проверяем, нет ли уже миниатюры нужного размера в кэше
+        if (!thumbnailCache.hasThumbnail(filePath, thumbnailRequestSize())) {
             filesToLoad.append(filePath);
         } else {
             pendingThumbnails.remove(filePath);
@@ -266,14 +424,32 @@ void ThumbnailView::processThumbnailQueue()
 
     if (!filesToLoad.isEmpty()) {
         // Загружаем миниатюры асинхронно с обработкой исключений
-        QFuture<QPair<QString, QPixmap>> future = QtConcurrent::mapped(
-            filesToLoad,
-            [this](const QString& filePath) -> QPair<QString, QPixmap> {
-                try {
-                    return qMakePair(filePath, generateThumbnail(filePath, thumbnailSize));
-                }
-                catch (...) {
-                    return qMakePair(filePath, QPixmap());
+        // Размер запрашиваем в физических пикселях экрана, на котором находится вид
+        QSize requestSize = thumbnailRequestSize();
+        QFuture<QPair<QString, QPixmap>> future = QtConcurrent::run(
+            [this, filesToLoad, requestSize](QPromise<QPair<QString, QPixmap>>& promise) {
+                // Сначала один последовательный проход по пачке: первые байты каждого файла
+                const QHash<QString, FileSignature::Kind> kinds = FileSignature::sniffBatch(filesToLoad);
+
+                // Затем параллельное декодирование - каждый файл своим декодером
+                const QList<QPair<QString, QPixmap>> results = QtConcurrent::blockingMapped<QList<QPair<QString, QPixmap>>>(
+                    filesToLoad,
+                    [this, &promise, &kinds, requestSize](const QString& filePath) -> QPair<QString, QPixmap> {
+                        if (promise.isCanceled()) {
+                            return qMakePair(filePath, QPixmap());
+                        }
+                        try {
+                            FileSignature::Kind kind = kinds.value(filePath, FileSignature::Unknown);
+                            return qMakePair(filePath, generator.generateThumbnail(filePath, requestSize, kind));
+                        }
+                        catch (...) {
+                            return qMakePair(filePath, QPixmap());
+                        }
+                    }
+                );
+
+                for (const auto& result : results) {
+                    promise.addResult(result);
                 }
             }
         );
@@ -316,17 +492,32 @@ void ThumbnailView::loadVisibleThumbnails()
         endRow = qMin(rowCount - 1, lastVisible.row() + 5);
     }
 
-    // Собираем файлы для загрузки
+    // Собираем файлы для загрузки; миниатюры меньше нужного (после увеличения
+    // или смены DPR) тоже ставятся в очередь
+    const QSize requestSize = thumbnailRequestSize();
     QStringList filesToLoad;
+    QStringList visibleFiles;
     for (int row = startRow; row <= endRow; ++row) {
         QModelIndex index = fsModel->index(row, 0, rootIdx);
         QString filePath = fsModel->filePath(index);
 
-        if (isImageFile(filePath) && !thumbnailCache.hasThumbnail(filePath) && !pendingThumbnails.contains(filePath)) {
+        bool isThumbnailFile = ThumbnailGenerator::isThumbnailFile(filePath);
+        if (isThumbnailFile) {
+            visibleFiles.append(filePath);
+        }
+
+        if ((isThumbnailFile || ThumbnailGenerator::isPreviewFolder(filePath)) &&
+            !thumbnailCache.hasThumbnail(filePath, requestSize) && !pendingThumbnails.contains(filePath)) {
             filesToLoad.append(filePath);
         }
     }
 
+    // Видимые файлы отслеживаем и на изменение содержимого без смены имени
+    fileWatcher->setVisibleFiles(visibleFiles);
+
+    // Ушедшие с экрана анимации останавливаем, остальные продолжаем
+    updateAnimatedPreviews();
+
     // Добавляем в очередь вместо немедленной загрузки
     if (!filesToLoad.isEmpty()) {
         addToQueue(filesToLoad);
@@ -342,12 +533,14 @@ void ThumbnailView::loadThumbnails()
     int rowCount = fsModel->rowCount(rootIdx);
 
     // Собираем все файлы для загрузки
+    const QSize requestSize = thumbnailRequestSize();
     QStringList filesToLoad;
     for (int row = 0; row < rowCount; ++row) {
         QModelIndex index = fsModel->index(row, 0, rootIdx);
         QString filePath = fsModel->filePath(index);
 
-        if (isImageFile(filePath) && !thumbnailCache.hasThumbnail(filePath) && !pendingThumbnails.contains(filePath)) {
+        if ((ThumbnailGenerator::isThumbnailFile(filePath) || ThumbnailGenerator::isPreviewFolder(filePath)) &&
+            !thumbnailCache.hasThumbnail(filePath, requestSize) && !pendingThumbnails.contains(filePath)) {
             filesToLoad.append(filePath);
         }
     }
@@ -358,263 +551,6 @@ void ThumbnailView::loadThumbnails()
     }
 }
 
-QString ThumbnailView::checkFileSignature(const QString& filePath) {
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly)) {
-        return "Cannot open file";
-    }
-
-    QByteArray header = file.read(8);
-    file.close();
-
-    if (header.size() < 2) return "File too small";
-
-    QString signature;
-
-    // Проверяем JPEG сигнатуру
-    if (header.startsWith("\xFF\xD8")) {
-        signature = "JPEG (FF D8)";
-        if (header.size() >= 4) {
-            if (header.startsWith("\xFF\xD8\xFF\xE0")) signature = "JPEG (JFIF)";
-            else if (header.startsWith("\xFF\xD8\xFF\xE1")) signature = "JPEG (Exif)";
-        }
-    } else if (header.startsWith("\x89PNG")) {
-        signature = "PNG";
-    } else if (header.startsWith("BM")) {
-        signature = "BMP";
-    } else if (header.startsWith("GIF8")) {
-        signature = "GIF";
-    } else {
-        signature = "Unknown";
-    }
-
-    return signature;
-}
-
-QPixmap ThumbnailView::loadJPEGViaWIC(const QString& filePath, const QSize& size)
-{
-    QPixmap result;
-
-    // Инициализация COM
-    HRESULT hr = CoInitializeEx(NULL, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE);
-    if (FAILED(hr)) {
-        qDebug() << "COM initialization failed:" << hr;
-        return result;
-    }
-
-    IWICImagingFactory* pFactory = NULL;
-    IWICBitmapDecoder* pDecoder = NULL;
-    IWICBitmapFrameDecode* pFrame = NULL;
-    IWICFormatConverter* pConverter = NULL;
-
-    // Создаем фабрику WIC
-    hr = CoCreateInstance(
-        CLSID_WICImagingFactory,
-        NULL,
-        CLSCTX_INPROC_SERVER,
-        IID_PPV_ARGS(&pFactory)
-    );
-
-    if (SUCCEEDED(hr)) {
-        // Конвертируем QString в wchar_t*
-        std::wstring filePathW = filePath.toStdWString();
-
-        // Создаем декодер для файла
-        hr = pFactory->CreateDecoderFromFilename(
-            filePathW.c_str(),
-            NULL,
-            GENERIC_READ,
-            WICDecodeMetadataCacheOnLoad,
-            &pDecoder
-        );
-
-        if (SUCCEEDED(hr)) {
-            // Получаем первый кадр (для JPEG всегда один кадр)
-            hr = pDecoder->GetFrame(0, &pFrame);
-
-            if (SUCCEEDED(hr)) {
-                // Создаем конвертер формата
-                hr = pFactory->CreateFormatConverter(&pConverter);
-
-                if (SUCCEEDED(hr)) {
-                    // Инициализируем конвертер в формат 32bpp PBGRA (совместимый с QImage)
-                    hr = pConverter->Initialize(
-                        pFrame,
-                        GUID_WICPixelFormat32bppPBGRA,
-                        WICBitmapDitherTypeNone,
-                        NULL,
-                        0.0,
-                        WICBitmapPaletteTypeCustom
-                    );
-
-                    if (SUCCEEDED(hr)) {
-                        // Получаем размеры изображения
-                        UINT width = 0, height = 0;
-                        pConverter->GetSize(&width, &height);
-
-                        if (width > 0 && height > 0) {
-                            // Создаем QImage для хранения данных
-                            QImage image(width, height, QImage::Format_ARGB32);
-
-                            // Копируем пиксели в QImage
-                            hr = pConverter->CopyPixels(
-                                NULL,
-                                width * 4, // stride
-                                width * height * 4, // buffer size
-                                reinterpret_cast<BYTE*>(image.bits())
-                            );
-
-                            if (SUCCEEDED(hr)) {
-                                // Масштабируем до нужного размера
-                                result = QPixmap::fromImage(image.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation));
-                            } else {
-                                qDebug() << "WIC CopyPixels failed:" << hr;
-                            }
-                        }
-                    } else {
-                        qDebug() << "WIC format converter initialization failed:" << hr;
-                    }
-                }
-            } else {
-                qDebug() << "WIC GetFrame failed:" << hr;
-            }
-        } else {
-            qDebug() << "WIC CreateDecoderFromFilename failed:" << hr;
-        }
-    } else {
-        qDebug() << "WIC CoCreateInstance failed:" << hr;
-    }
-
-    // Освобождение ресурсов
-    if (pConverter) pConverter->Release();
-    if (pFrame) pFrame->Release();
-    if (pDecoder) pDecoder->Release();
-    if (pFactory) pFactory->Release();
-
-    CoUninitialize();
-
-    return result;
-}
-
-QPixmap ThumbnailView::generateThumbnail(const QString& filePath, const QSize& size)
-{
-    // Сначала проверяем кэш
-    QPixmap cachedPixmap = thumbnailCache.getThumbnail(filePath);
-    if (!cachedPixmap.isNull()) {
-        // Если есть в кэше, масштабируем до нужного размера
-        return cachedPixmap.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-    }
-
-    QPixmap pixmap;
-
-    try {
-        // Для SVG файлов
-        if (filePath.toLower().endsWith(".svg")) {
-            QSvgRenderer renderer(filePath);
-            if (renderer.isValid()) {
-                QPixmap svgPixmap(size);
-                svgPixmap.fill(Qt::transparent);
-                QPainter painter(&svgPixmap);
-                renderer.render(&painter);
-                pixmap = svgPixmap;
-            }
-        }
-        // Для JPEG файлов используем WIC
-        else if (filePath.toLower().endsWith(".jpg") || filePath.toLower().endsWith(".jpeg")) {
-            pixmap = loadJPEGViaWIC(filePath, size);
-
-            if (pixmap.isNull()) {
-                // Резервный метод через Qt
-                QImageReader reader(filePath);
-                if (reader.canRead()) {
-                    QImage image = reader.read();
-                    if (!image.isNull()) {
-                        pixmap = QPixmap::fromImage(image.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation));
-                    }
-                }
-            }
-        }
-        // Для остальных форматов используем стандартные методы Qt
-        else {
-            QImageReader reader(filePath);
-            if (reader.canRead()) {
-                QSize imageSize = reader.size();
-                if (imageSize.isValid()) {
-                    // Ограничиваем размер загружаемого изображения для экономии памяти
-                    QSize loadSize = imageSize;
-                    if (loadSize.width() > 1024 || loadSize.height() > 1024) {
-                        loadSize.scale(1024, 1024, Qt::KeepAspectRatio);
-                        reader.setScaledSize(loadSize);
-                    }
-
-                    QImage image = reader.read();
-                    if (!image.isNull()) {
-                        pixmap = QPixmap::fromImage(image.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation));
-                    }
-                }
-            }
-
-            // Резервный метод с ограничением памяти
-            if (pixmap.isNull()) {
-                QImage image(filePath);
-                if (!image.isNull()) {
-                    // Ограничиваем размер для экономии памяти
-                    if (image.width() > 800 || image.height() > 800) {
-                        image = image.scaled(800, 800, Qt::KeepAspectRatio, Qt::FastTransformation);
-                    }
-                    pixmap = QPixmap::fromImage(image.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation));
-                }
-            }
-        }
-    }
-    catch (const std::exception& e) {
-        qDebug() << "Exception while generating thumbnail for" << filePath << ":" << e.what();
-    }
-    catch (...) {
-        qDebug() << "Unknown exception while generating thumbnail for" << filePath;
-    }
-
-    // Финальная заглушка если все методы не сработали
-    if (pixmap.isNull()) {
-        QImage placeholder(size, QImage::Format_RGB32);
-        placeholder.fill(QColor(200, 200, 200));
-
-        QPainter painter(&placeholder);
-        painter.setPen(Qt::darkGray);
-        QFont font = painter.font();
-        font.setPointSize(8);
-        painter.setFont(font);
-        painter.drawText(placeholder.rect(), Qt::AlignCenter, "No preview\n" + QFileInfo(filePath).suffix().toUpper());
-
-        pixmap = QPixmap::fromImage(placeholder);
-    }
-
-    // Сохраняем в кэш оригинальный размер (максимальный для качественного масштабирования)
-    if (!pixmap.isNull()) {
-        // Сохраняем в максимальном размере для последующего качественного масштабирования
-        QSize maxSize(512, 512);
-        QPixmap originalPixmap = pixmap;
-        if (pixmap.width() > maxSize.width() || pixmap.height() > maxSize.height()) {
-            originalPixmap = pixmap.scaled(maxSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-        }
-        thumbnailCache.storeThumbnail(filePath, originalPixmap);
-
-        // Возвращаем версию нужного размера
-        return pixmap;
-    }
-
-    return QPixmap();
-}
-
-bool ThumbnailView::isImageFile(const QString& filePath)
-{
-    QFileInfo fileInfo(filePath);
-    if (!fileInfo.isFile()) return false;
-
-    QString suffix = fileInfo.suffix().toLower();
-    return SUPPORTED_IMAGE_FORMATS.contains(suffix);
-}
-
 void ThumbnailView::onThumbnailBatchGenerated(QFutureWatcher<QPair<QString, QPixmap>>* watcher)
 {
     if (watcher->isFinished()) {
@@ -641,6 +577,11 @@ void ThumbnailView::onThumbnailBatchGenerated(QFutureWatcher<QPair<QString, QPix
         // Очищаем watcher
         activeWatchers.removeAll(watcher);
         watcher->deleteLater();
+
+        // Очередь опустела - сохраняем новые крошечные превью папки
+        if (activeWatchers.isEmpty() && thumbnailQueue.isEmpty() && !currentPath.isEmpty()) {
+            thumbnailCache.saveTinyPreviews(currentPath);
+        }
     }
 }
 
@@ -3,7 +3,6 @@
 #include <QListView>
 #include <QFileSystemModel>
 #include <QFutureWatcher>
-#include <QPixmapCache>
 #include <QHash>
 #include <QSvgRenderer>
 #include <QTimer>
@@ -11,6 +10,9 @@
 #include <QQueue>
 #include <QSettings>
 #include "thumbnailcache.h"
+#include "thumbnailgenerator.h"
+#include "thumbnailwatcher.h"
+#include "animatedpreviews.h"
 
 class ThumbnailDelegate;
 
@@ -25,10 +27,26 @@ public:
     QPixmap getThumbnail(const QString& filePath) const {
         return thumbnailCache.getThumbnail(filePath);
     }
+    QPixmap getThumbnail(const QString& filePath, const QSize& size) const {
+        return thumbnailCache.getThumbnail(filePath, size);
+    }
+    // Составная миниатюра папки (до четырех изображений из нее) или пустой QPixmap
+    QPixmap getFolderThumbnail(const QFileInfo& dirInfo, const QSize& size) const {
+        return thumbnailCache.getFolderThumbnail(dirInfo, size);
+    }
+    QImage getTinyPreview(const QFileInfo& fileInfo) const {
+        return thumbnailCache.tinyPreview(fileInfo);
+    }
+    // Текущий кадр анимированного превью, если элемент сейчас анимируется
+    QPixmap getAnimatedFrame(const QString& filePath) const {
+        return animatedPreviews->currentFrame(filePath);
+    }
 
     void setThumbnailScaleFactor(double factor);
     double getThumbnailScaleFactor() const { return thumbnailScaleFactor; }
     QSize getThumbnailSize() const { return thumbnailSize; }
+    // Размер миниатюры в физических пикселях с учетом devicePixelRatio
+    QSize thumbnailRequestSize() const;
     QSize getGridSize() const { return gridSize(); }
 
     ThumbnailDelegate* getDelegate() const { return delegate; }
@@ -39,30 +57,38 @@ public slots:
     void loadVisibleThumbnails();
 
 protected:
+    bool event(QEvent *event) override;
     void resizeEvent(QResizeEvent *event) override;
     void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
     void wheelEvent(QWheelEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void leaveEvent(QEvent *event) override;
+    void selectionChanged(const QItemSelection &selected, const QItemSelection &deselected) override;
 
 private slots:
     void onScroll();
     void onThumbnailBatchGenerated(QFutureWatcher<QPair<QString, QPixmap>>* watcher);
     void processThumbnailQueue();
+    void onThumbnailsInvalidated(const QStringList& filePaths);
+    void onAnimatedFrameChanged(const QString& filePath);
 
 private:
     void updateGridSize();
-    QPixmap generateThumbnail(const QString& filePath, const QSize& size);
-    bool isImageFile(const QString& filePath);
     void addToQueue(const QStringList& files);
-    QPixmap loadJPEGViaWIC(const QString& filePath, const QSize& size);
-    QString checkFileSignature(const QString& filePath);
+    void updateAnimatedPreviews();
     void saveThumbnailScaleFactor();
     void loadThumbnailScaleFactor();
 
     QSize thumbnailSize;
     ThumbnailCache &thumbnailCache = ThumbnailCache::instance();
+    ThumbnailGenerator generator;
     QSet<QString> pendingThumbnails;
     QList<QFutureWatcher<QPair<QString, QPixmap>>*> activeWatchers;
     ThumbnailDelegate *delegate;
+    ThumbnailWatcher *fileWatcher;
+    AnimatedPreviews *animatedPreviews;
+    QPersistentModelIndex hoveredIndex;
     QTimer *loadTimer;
     QTimer *queueTimer;
     QQueue<QString> thumbnailQueue;
@@ -78,6 +104,4 @@ private:
     const double SCALE_STEP = 0.1;
 
     const int MAX_QUEUE_SIZE = 100;
-    const int MAX_IMAGE_DIMENSION = 2048;
-    const int MAX_CACHE_SIZE_MB = 100;
 };
\ No newline at end of file
@@ -0,0 +1,276 @@
+#include "thumbnailwarmer.h"
+#include "filesignature.h"
+#include "decodebufferpool.h"
+#include "styles.h"
+#include <QCommandLineParser>
+#include <QtConcurrent>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QThread>
+#include <cstdio>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+namespace {
+    // Пиковый объем памяти процесса - для сравнения запусков с пулом буферов и без
+    qint64 peakResidentBytes()
+    {
+#if defined(Q_OS_WIN)
+        PROCESS_MEMORY_COUNTERS counters;
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+            return qint64(counters.PeakWorkingSetSize);
+        }
+#elif defined(Q_OS_LINUX)
+        QFile status("/proc/self/status");
+        if (status.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            while (!status.atEnd()) {
+                QByteArray line = status.readLine();
+                if (line.startsWith("VmHWM:")) {
+                    return line.mid(6).trimmed().split(' ').value(0).toLongLong() * 1024;
+                }
+            }
+        }
+#endif
+        return 0;
+    }
+}
+
+int ThumbnailWarmer::run(const QStringList& args)
+{
+#ifdef Q_OS_WIN
+    // Приложение собрано как GUI - подключаемся к консоли, из которой нас запустили
+    if (AttachConsole(ATTACH_PARENT_PROCESS)) {
+        freopen("CONOUT$", "w", stdout);
+        freopen("CONOUT$", "w", stderr);
+    }
+#endif
+
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Thumbnail cache warming");
+    QCommandLineOption warmOption("warm-thumbnails", "Directory tree to pre-generate thumbnails for", "dir");
+    QCommandLineOption jobsOption("jobs", "Number of worker threads", "N");
+    QCommandLineOption sizesOption("sizes", "Comma-separated thumbnail edges in physical pixels", "sizes");
+    QCommandLineOption noPoolOption("no-buffer-pool", "Allocate decode buffers with malloc instead of the per-thread pool");
+
+    parser.addOption(warmOption);
+    parser.addOption(jobsOption);
+    parser.addOption(sizesOption);
+    parser.addOption(noPoolOption);
+
+    if (!parser.parse(args) || parser.value(warmOption).isEmpty()) {
+        err << "Usage: QFiles --warm-thumbnails <dir> [--jobs N] [--sizes 150,300] [--no-buffer-pool]\n";
+        return 1;
+    }
+
+    QFileInfo rootInfo(parser.value(warmOption));
+    if (!rootInfo.isDir()) {
+        err << "Not a directory: " << rootInfo.filePath() << "\n";
+        return 1;
+    }
+
+    int jobs = QThread::idealThreadCount();
+    if (parser.isSet(jobsOption)) {
+        bool ok = false;
+        jobs = parser.value(jobsOption).toInt(&ok);
+        if (!ok || jobs < 1) {
+            err << "Invalid --jobs value: " << parser.value(jobsOption) << "\n";
+            return 1;
+        }
+    }
+
+    // По умолчанию - обычный размер и размер для экранов 200%. На диск пишется
+    // одна базовая миниатюра, покрывающая наибольший размер; меньшие уровни
+    // GUI строит из нее без декодирования
+    int maxEdge = Styles::ThumbnailWidth * 2;
+    if (parser.isSet(sizesOption)) {
+        maxEdge = 0;
+        const QStringList sizes = parser.value(sizesOption).split(',', Qt::SkipEmptyParts);
+        for (const QString& size : sizes) {
+            bool ok = false;
+            int edge = size.trimmed().toInt(&ok);
+            if (!ok || edge < 16) {
+                err << "Invalid --sizes value: " << size << "\n";
+                return 1;
+            }
+            maxEdge = qMax(maxEdge, edge);
+        }
+    }
+
+    // Явный выбор на время прогрева, чтобы запуски можно было сравнивать
+    DecodeBufferPool::setEnabled(!parser.isSet(noPoolOption));
+
+    ThumbnailWarmer warmer(QSize(maxEdge, maxEdge), jobs);
+    warmer.warm(QDir::cleanPath(rootInfo.absoluteFilePath()));
+    return 0;
+}
+
+ThumbnailWarmer::ThumbnailWarmer(const QSize& requestSize, int jobs)
+    : requestSize(requestSize)
+{
+    pool.setMaxThreadCount(jobs);
+}
+
+void ThumbnailWarmer::warm(const QString& rootPath)
+{
+    QTextStream out(stdout);
+    out << "Warming thumbnails in " << rootPath << " (" << pool.maxThreadCount() << " jobs, "
+        << requestSize.width() << " px) into " << thumbnailCache.getCachePath() << "\n";
+    out.flush();
+
+    timer.start();
+
+    // Фаза 1: параллельный обход дерева и миниатюры файлов
+    pool.start([this, rootPath]() { walkDirectory(rootPath); });
+    while (!pool.waitForDone(PROGRESS_INTERVAL_MS)) {
+        printProgress(false);
+    }
+
+    // Фаза 2: составные миниатюры папок - из уже готовых миниатюр файлов
+    processFolders();
+
+    printProgress(true);
+}
+
+void ThumbnailWarmer::walkDirectory(const QString& dirPath)
+{
+    directories++;
+
+    // Символьные ссылки на папки не обходим, чтобы не зациклиться
+    QDir dir(dirPath);
+    const QFileInfoList entries = dir.entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks,
+                                                    QDir::Name);
+
+    QStringList batch;
+    for (const QFileInfo& entry : entries) {
+        QString path = entry.absoluteFilePath();
+
+        if (entry.isDir()) {
+            {
+                QMutexLocker locker(&mutex);
+                folders.append(path);
+            }
+            pool.start([this, path]() { walkDirectory(path); });
+            continue;
+        }
+
+        if (!ThumbnailGenerator::isThumbnailSuffix(entry.suffix())) {
+            continue;
+        }
+
+        filesSeen++;
+        batch.append(path);
+        if (batch.size() >= BATCH_SIZE) {
+            pool.start([this, batch]() { processFiles(batch); });
+            batch.clear();
+        }
+    }
+
+    // Остаток обрабатываем в текущей задаче
+    if (!batch.isEmpty()) {
+        processFiles(batch);
+    }
+}
+
+void ThumbnailWarmer::processFiles(const QStringList& filePaths)
+{
+    // Как в ThumbnailView: сначала сигнатуры всей пачки, затем декодирование
+    const QHash<QString, FileSignature::Kind> kinds = FileSignature::sniffBatch(filePaths);
+
+    for (const QString& filePath : filePaths) {
+        // Уже в кэше (или известная ошибка) - пропускаем
+        if (thumbnailCache.hasThumbnail(filePath)) {
+            alreadyCached++;
+            continue;
+        }
+
+        QPixmap pixmap = generator.generateThumbnail(filePath, requestSize,
+                                                     kinds.value(filePath, FileSignature::Unknown));
+        sourceBytes += QFileInfo(filePath).size();
+
+        // Пустой результат - временная ошибка (файл занят, нет памяти), в кэш не попал
+        if (pixmap.isNull() || thumbnailCache.isKnownFailure(filePath)) {
+            failed++;
+            QMutexLocker locker(&mutex);
+            failures.append(filePath);
+        } else {
+            generated++;
+        }
+    }
+}
+
+void ThumbnailWarmer::processFolders()
+{
+    QStringList pending;
+    {
+        QMutexLocker locker(&mutex);
+        pending = folders;
+    }
+
+    QFuture<void> future = QtConcurrent::map(&pool, pending, [this](const QString& dirPath) {
+        if (!thumbnailCache.hasThumbnail(dirPath) &&
+            !generator.generateFolderThumbnail(dirPath, requestSize).isNull()) {
+            folderPreviews++;
+        }
+    });
+
+    QElapsedTimer sinceProgress;
+    sinceProgress.start();
+    while (!future.isFinished()) {
+        QThread::msleep(100);
+        if (sinceProgress.elapsed() >= PROGRESS_INTERVAL_MS) {
+            printProgress(false);
+            sinceProgress.restart();
+        }
+    }
+}
+
+void ThumbnailWarmer::printProgress(bool final)
+{
+    QTextStream out(stdout);
+
+    const double seconds = qMax<qint64>(1, timer.elapsed()) / 1000.0;
+    const int processed = generated + failed;
+
+    out << (final ? "Done: " : "Progress: ")
+        << directories << " dirs, "
+        << filesSeen << " files, "
+        << generated << " generated, "
+        << alreadyCached << " already cached, "
+        << failed << " failed, "
+        << folderPreviews << " folder previews; "
+        << QString::number(processed / seconds, 'f', 1) << " files/s, "
+        << QString::number(sourceBytes / seconds / (1024 * 1024), 'f', 1) << " MB/s\n";
+
+    if (final) {
+        ThumbnailCache::CacheStats stats = thumbnailCache.stats();
+        out << "Elapsed " << QString::number(seconds, 'f', 1) << " s; cache "
+            << stats.bytes / (1024 * 1024) << " MB of " << stats.maxBytes / (1024 * 1024) << " MB quota, "
+            << stats.entries << " entries\n";
+
+        DecodeBufferPool::Stats pool = DecodeBufferPool::stats();
+        ThumbnailMemoryCache::Usage memory = ThumbnailMemoryCache::instance().usage();
+        out << "Decode buffers: " << (DecodeBufferPool::isEnabled() ? "pooled" : "malloc") << ", "
+            << pool.hits << " reused, " << pool.misses << " allocated, "
+            << pool.peakIdleBytes / (1024 * 1024) << " MB peak idle, "
+            << memory.pooledBytes / (1024 * 1024) << " MB of " << memory.budgetBytes / (1024 * 1024)
+            << " MB memory budget held by the pool; peak RSS "
+            << peakResidentBytes() / (1024 * 1024) << " MB\n";
+
+        QMutexLocker locker(&mutex);
+        for (int i = 0; i < failures.size() && i < MAX_REPORTED_FAILURES; ++i) {
+            out << "Failed: " << failures[i] << "\n";
+        }
+        if (failures.size() > MAX_REPORTED_FAILURES) {
+            out << "... and " << failures.size() - MAX_REPORTED_FAILURES << " more failures\n";
+        }
+    }
+
+    out.flush();
+}
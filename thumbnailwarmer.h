@@ -0,0 +1,51 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QSize>
+#include <QStringList>
+#include <QThreadPool>
+#include <atomic>
+#include "thumbnailgenerator.h"
+
+// Консольный режим прогрева кэша миниатюр:
+//   QFiles --warm-thumbnails <dir> [--jobs N] [--sizes 150,300] [--no-buffer-pool]
+// Обходит дерево папок параллельно, генерирует миниатюры тем же кодом, что
+// и ThumbnailView, и выводит счетчики, скорость и список ошибок. Виджеты не
+// создаются; запись в кэш атомарная, поэтому запуск безопасен при открытом GUI.
+class ThumbnailWarmer
+{
+public:
+    static int run(const QStringList& args);
+
+private:
+    ThumbnailWarmer(const QSize& requestSize, int jobs);
+
+    void warm(const QString& rootPath);
+    void walkDirectory(const QString& dirPath);
+    void processFiles(const QStringList& filePaths);
+    void processFolders();
+    void printProgress(bool final);
+
+    QThreadPool pool;
+    ThumbnailGenerator generator;
+    ThumbnailCache &thumbnailCache = ThumbnailCache::instance();
+    QSize requestSize;
+    QElapsedTimer timer;
+
+    std::atomic<int> directories{0};
+    std::atomic<int> filesSeen{0};
+    std::atomic<int> generated{0};
+    std::atomic<int> alreadyCached{0};
+    std::atomic<int> failed{0};
+    std::atomic<int> folderPreviews{0};
+    std::atomic<qint64> sourceBytes{0};
+
+    QMutex mutex;
+    QStringList folders;
+    QStringList failures;
+
+    const int BATCH_SIZE = 16;
+    const int MAX_REPORTED_FAILURES = 50;
+    const int PROGRESS_INTERVAL_MS = 2000;
+};
@@ -0,0 +1,226 @@
+#include "thumbnailwatcher.h"
+#include "thumbnailgenerator.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QtConcurrent>
+#include <QDebug>
+
+ThumbnailWatcher::ThumbnailWatcher(QObject *parent)
+    : QObject(parent)
+    , watcher(new QFileSystemWatcher(this))
+    , rescanTimer(new QTimer(this))
+{
+    rescanTimer->setSingleShot(true);
+    rescanTimer->setInterval(RESCAN_DELAY_MS);
+    connect(rescanTimer, &QTimer::timeout, this, &ThumbnailWatcher::rescan);
+
+    // Любое событие - повод просмотреть папку и сравнить со снимком
+    connect(watcher, &QFileSystemWatcher::directoryChanged, rescanTimer, qOverload<>(&QTimer::start));
+    connect(watcher, &QFileSystemWatcher::fileChanged, rescanTimer, qOverload<>(&QTimer::start));
+}
+
+void ThumbnailWatcher::setDirectory(const QString& dirPath)
+{
+    QString cleanPath = QDir::cleanPath(dirPath);
+    if (cleanPath == directory) {
+        return;
+    }
+
+    rescanTimer->stop();
+    scanGeneration++;
+    scanRunning = false;
+    rescanPending = false;
+    if (!watcher->directories().isEmpty()) {
+        watcher->removePaths(watcher->directories());
+    }
+    if (!watcher->files().isEmpty()) {
+        watcher->removePaths(watcher->files());
+    }
+    visibleFiles.clear();
+
+    directory = cleanPath;
+    snapshot.clear();
+    snapshotReady = false;
+    if (directory.isEmpty()) {
+        return;
+    }
+
+    watcher->addPath(directory);
+    startScan();
+}
+
+void ThumbnailWatcher::setVisibleFiles(const QStringList& filePaths)
+{
+    visibleFiles.clear();
+    for (const QString& filePath : filePaths) {
+        if (visibleFiles.size() >= MAX_WATCHED_FILES) {
+            break;
+        }
+        visibleFiles.insert(filePath);
+    }
+    updateFileWatches();
+}
+
+void ThumbnailWatcher::updateFileWatches()
+{
+    // Снимаем слежение с ушедших из вида файлов и добавляем новые. Файлы,
+    // замененные при сохранении, watcher забывает - они добавятся снова
+    const QStringList watched = watcher->files();
+    QStringList toRemove;
+    for (const QString& filePath : watched) {
+        if (!visibleFiles.contains(filePath)) {
+            toRemove.append(filePath);
+        }
+    }
+    if (!toRemove.isEmpty()) {
+        watcher->removePaths(toRemove);
+    }
+
+    QStringList toAdd;
+    for (const QString& filePath : visibleFiles) {
+        if (!watched.contains(filePath) && QFileInfo::exists(filePath)) {
+            toAdd.append(filePath);
+        }
+    }
+    if (!toAdd.isEmpty()) {
+        watcher->addPaths(toAdd);
+    }
+}
+
+ThumbnailWatcher::Scan ThumbnailWatcher::scanDirectory(const QString& dirPath)
+{
+    Scan result;
+    result.exists = QFileInfo(dirPath).isDir();
+    if (!result.exists) {
+        return result;
+    }
+
+    const QFileInfoList entries = QDir(dirPath).entryInfoList(QDir::Files | QDir::NoDotAndDotDot);
+    result.stamps.reserve(entries.size());
+    for (const QFileInfo& entry : entries) {
+        if (ThumbnailGenerator::isThumbnailSuffix(entry.suffix())) {
+            result.stamps.insert(entry.fileName(), {entry.lastModified().toSecsSinceEpoch(), entry.size()});
+        }
+    }
+    return result;
+}
+
+void ThumbnailWatcher::startScan()
+{
+    scanRunning = true;
+    rescanPending = false;
+
+    const QString dirPath = directory;
+    const int generation = scanGeneration;
+    auto *scanWatcher = new QFutureWatcher<Scan>(this);
+    connect(scanWatcher, &QFutureWatcher<Scan>::finished, this, [this, scanWatcher, generation]() {
+        const Scan scan = scanWatcher->result();
+        scanWatcher->deleteLater();
+        if (generation != scanGeneration) {
+            return;
+        }
+
+        scanRunning = false;
+        applyScan(scan);
+        if (rescanPending) {
+            startScan();
+        }
+    });
+    scanWatcher->setFuture(QtConcurrent::run([dirPath]() { return scanDirectory(dirPath); }));
+}
+
+void ThumbnailWatcher::rescan()
+{
+    if (directory.isEmpty()) {
+        return;
+    }
+    if (scanRunning) {
+        rescanPending = true;
+        return;
+    }
+    startScan();
+}
+
+void ThumbnailWatcher::applyScan(const Scan& scan)
+{
+    // Первый просмотр папки - только снимок, сравнивать не с чем
+    if (!snapshotReady) {
+        snapshot = scan.stamps;
+        snapshotReady = true;
+        return;
+    }
+
+    // Папку удалили или переименовали - дальше следить не за чем
+    if (!scan.exists) {
+        snapshot.clear();
+        return;
+    }
+
+    const QHash<QString, Stamp>& current = scan.stamps;
+    QDir dir(directory);
+
+    QStringList invalidated;
+    QStringList removed;
+    QStringList added;
+    bool moved = false;
+
+    for (auto it = current.cbegin(); it != current.cend(); ++it) {
+        auto old = snapshot.constFind(it.key());
+        if (old == snapshot.cend()) {
+            added.append(it.key());
+        } else if (old.value() != it.value()) {
+            // Изменен на месте - старая миниатюра больше не нужна
+            thumbnailCache.removeThumbnail(dir.filePath(it.key()), old->modified, old->size);
+            invalidated.append(dir.filePath(it.key()));
+        }
+    }
+    for (auto it = snapshot.cbegin(); it != snapshot.cend(); ++it) {
+        if (!current.contains(it.key())) {
+            removed.append(it.key());
+        }
+    }
+
+    // Переименование: исчезнувший и появившийся файл с одинаковой отметкой.
+    // Совпадение должно быть однозначным, иначе считаем удалением и добавлением
+    QMultiHash<qint64, QString> addedBySize;
+    for (const QString& name : added) {
+        addedBySize.insert(current.value(name).size, name);
+    }
+
+    for (const QString& oldName : removed) {
+        const Stamp stamp = snapshot.value(oldName);
+
+        QStringList candidates;
+        const QList<QString> sameSize = addedBySize.values(stamp.size);
+        for (const QString& name : sameSize) {
+            if (current.value(name) == stamp) {
+                candidates.append(name);
+            }
+        }
+
+        if (candidates.size() == 1) {
+            const QString& newName = candidates.first();
+            qDebug() << "Thumbnail follows rename:" << oldName << "->" << newName;
+            thumbnailCache.moveThumbnail(dir.filePath(oldName), stamp.modified, stamp.size, dir.filePath(newName));
+            addedBySize.remove(stamp.size, newName);
+            added.removeOne(newName);
+        } else {
+            thumbnailCache.removeThumbnail(dir.filePath(oldName), stamp.modified, stamp.size);
+        }
+        moved = true;
+    }
+
+    // Новые файлы - сразу в очередь, не дожидаясь прокрутки
+    for (const QString& name : added) {
+        invalidated.append(dir.filePath(name));
+    }
+
+    snapshot = current;
+    updateFileWatches();
+
+    if (!invalidated.isEmpty()) {
+        emit thumbnailsInvalidated(invalidated);
+    } else if (moved) {
+        emit thumbnailsMoved();
+    }
+}
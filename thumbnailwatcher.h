@@ -0,0 +1,77 @@
+#pragma once
+
+#include <QObject>
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+#include "thumbnailcache.h"
+
+// Следит за текущей папкой и видимыми файлами и поддерживает кэш миниатюр
+// в актуальном состоянии по событиям файловой системы, без опроса:
+// переименование переносит миниатюру, изменение или удаление - удаляет ее.
+class ThumbnailWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ThumbnailWatcher(QObject *parent = nullptr);
+
+    void setDirectory(const QString& dirPath);
+    // Видимые файлы: для них отслеживается и изменение содержимого на месте
+    void setVisibleFiles(const QStringList& filePaths);
+
+signals:
+    // Миниатюры этих файлов нужно сгенерировать (изменились или появились)
+    void thumbnailsInvalidated(const QStringList& filePaths);
+    // Миниатюры перенесены или удалены - достаточно перерисовать
+    void thumbnailsMoved();
+
+private slots:
+    void rescan();
+
+private:
+    struct Stamp {
+        qint64 modified = 0;
+        qint64 size = 0;
+
+        bool operator==(const Stamp& other) const {
+            return modified == other.modified && size == other.size;
+        }
+        bool operator!=(const Stamp& other) const { return !(*this == other); }
+    };
+
+    struct Scan {
+        bool exists = false;
+        QHash<QString, Stamp> stamps; // имя файла -> отметка
+    };
+
+    // Просмотр папки идет в пуле потоков (сетевая папка может отвечать
+    // секундами), результат применяется в потоке интерфейса
+    static Scan scanDirectory(const QString& dirPath);
+    void startScan();
+    void applyScan(const Scan& scan);
+    void updateFileWatches();
+
+    QFileSystemWatcher *watcher;
+    QTimer *rescanTimer;
+    ThumbnailCache &thumbnailCache = ThumbnailCache::instance();
+
+    QString directory;
+    QHash<QString, Stamp> snapshot; // имя файла -> отметка на момент последнего просмотра
+    bool snapshotReady = false;
+    QSet<QString> visibleFiles;
+
+    // Одновременно идет один просмотр; события во время него - повод для еще одного.
+    // Поколение отбрасывает результат просмотра папки, которую уже сменили
+    bool scanRunning = false;
+    bool rescanPending = false;
+    int scanGeneration = 0;
+
+    // События приходят пачками (сохранение через временный файл, копирование) -
+    // обрабатываем их одним просмотром папки
+    const int RESCAN_DELAY_MS = 250;
+    const int MAX_WATCHED_FILES = 256;
+};
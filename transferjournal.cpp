@@ -0,0 +1,253 @@
+#include "transferjournal.h"
+#include "copyengine.h"
+#include <QDir>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardPaths>
+#include <QDebug>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+    // Пачка отметок о скопированных файлах: один сброс данных и один fsync
+    // журнала на столько файлов или на столько времени
+    constexpr int FINISHED_BATCH_FILES = 256;
+    constexpr qint64 FINISHED_BATCH_MS = 2000;
+
+    void syncToDisk(QFile& file)
+    {
+#ifdef Q_OS_WIN
+        FlushFileBuffers(reinterpret_cast<HANDLE>(_get_osfhandle(file.handle())));
+#else
+        ::fsync(file.handle());
+#endif
+    }
+}
+
+QString TransferJournal::journalDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/transfers";
+}
+
+QString TransferJournal::journalPath(const QString& jobId)
+{
+    return journalDirectory() + "/" + jobId + ".journal";
+}
+
+QStringList TransferJournal::pendingJobs()
+{
+    QStringList jobs;
+    const QFileInfoList entries = QDir(journalDirectory()).entryInfoList({"*.journal"}, QDir::Files, QDir::Time | QDir::Reversed);
+    for (const QFileInfo& entry : entries) {
+        jobs.append(entry.completeBaseName());
+    }
+    return jobs;
+}
+
+bool TransferJournal::load(const QString& jobId, State& state)
+{
+    QFile journal(journalPath(jobId));
+    if (!journal.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QJsonObject header = QJsonDocument::fromJson(journal.readLine()).object();
+    if (!header.contains("operations")) {
+        qDebug() << "Corrupted transfer journal:" << journal.fileName();
+        return false;
+    }
+
+    state = State();
+    state.jobId = jobId;
+    state.title = header.value("title").toString();
+    state.operations = header.value("operations").toArray();
+
+    // Последняя строка могла остаться недописанной - такие просто пропускаем
+    while (!journal.atEnd()) {
+        QJsonObject record = QJsonDocument::fromJson(journal.readLine()).object();
+        if (record.contains("plan")) {
+            state.operations = record.value("plan").toArray();
+            state.conflictRules = record.value("rules").toObject();
+            state.planResolved = true;
+        } else if (record.contains("done")) {
+            // Пачка файлов - массив; старые журналы отмечали по одному
+            QJsonValue done = record.value("done");
+            const QJsonArray sources = done.isArray() ? done.toArray() : QJsonArray{done};
+            for (const QJsonValue& value : sources) {
+                QString source = value.toString();
+                state.finishedFiles.insert(source);
+                state.partialFiles.remove(source);
+            }
+        } else if (record.contains("partial")) {
+            // В старых журналах размера и времени нет - такой файл копируется заново
+            PartialFile partial;
+            partial.offset = qint64(record.value("offset").toDouble());
+            partial.sourceSize = qint64(record.value("size").toDouble(-1));
+            partial.sourceModified = qint64(record.value("modified").toDouble(-1));
+            state.partialFiles.insert(record.value("partial").toString(), partial);
+        } else if (record.contains("operation")) {
+            state.finishedOperations.insert(record.value("operation").toInt());
+        }
+    }
+    return true;
+}
+
+void TransferJournal::discard(const QString& jobId)
+{
+    QFile::remove(journalPath(jobId));
+}
+
+TransferJournal::~TransferJournal()
+{
+    if (file.isOpen()) {
+        file.close();
+    }
+}
+
+bool TransferJournal::create(const QString& jobId, const QString& title, const QJsonArray& operations)
+{
+    QDir().mkpath(journalDirectory());
+
+    file.setFileName(journalPath(jobId));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered)) {
+        qDebug() << "Cannot create transfer journal:" << file.fileName() << file.errorString();
+        return false;
+    }
+
+    QJsonObject header;
+    header.insert("title", title);
+    header.insert("operations", operations);
+    append(QJsonDocument(header).toJson(QJsonDocument::Compact));
+
+    // План должен пережить и сбой питания, иначе продолжать будет нечего
+    syncToDisk(file);
+    return true;
+}
+
+bool TransferJournal::reopen(const QString& jobId)
+{
+    file.setFileName(journalPath(jobId));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Unbuffered)) {
+        qDebug() << "Cannot reopen transfer journal:" << file.fileName() << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+void TransferJournal::planResolved(const QJsonArray& operations, const QJsonObject& conflictRules)
+{
+    QJsonObject record;
+    record.insert("plan", operations);
+    if (!conflictRules.isEmpty()) {
+        record.insert("rules", conflictRules);
+    }
+    append(QJsonDocument(record).toJson(QJsonDocument::Compact), true);
+}
+
+void TransferJournal::fileFinished(const QString& sourcePath, const QString& destinationPath)
+{
+    QList<FinishedFile> batch;
+    {
+        QMutexLocker locker(&mutex);
+        if (!file.isOpen()) {
+            return;
+        }
+        if (pendingFinished.isEmpty()) {
+            pendingTimer.start();
+        }
+        pendingFinished.append({sourcePath, destinationPath});
+        if (pendingFinished.size() < FINISHED_BATCH_FILES && pendingTimer.elapsed() < FINISHED_BATCH_MS) {
+            return;
+        }
+        batch.swap(pendingFinished);
+    }
+    commitFinished(batch);
+}
+
+void TransferJournal::flushFinished()
+{
+    QList<FinishedFile> batch;
+    {
+        QMutexLocker locker(&mutex);
+        batch.swap(pendingFinished);
+    }
+    if (!batch.isEmpty()) {
+        commitFinished(batch);
+    }
+}
+
+void TransferJournal::commitFinished(const QList<FinishedFile>& files)
+{
+    // Данные сбрасываются без блокировки журнала: остальные потоки пула
+    // продолжают копировать и отмечать свои файлы
+    QStringList destinations;
+    destinations.reserve(files.size());
+    for (const FinishedFile& finished : files) {
+        destinations.append(finished.destinationPath);
+    }
+    const QStringList unflushed = CopyEngine::flushFiles(destinations);
+
+    // Файл, который не удалось сбросить, не отмечаем - при продолжении он сверится заново
+    QJsonArray sources;
+    for (const FinishedFile& finished : files) {
+        if (!unflushed.contains(finished.destinationPath)) {
+            sources.append(finished.sourcePath);
+        }
+    }
+    if (sources.isEmpty()) {
+        return;
+    }
+
+    QJsonObject record;
+    record.insert("done", sources);
+    append(QJsonDocument(record).toJson(QJsonDocument::Compact), true);
+}
+
+void TransferJournal::filePartial(const QString& sourcePath, const PartialFile& partial)
+{
+    QJsonObject record;
+    record.insert("partial", sourcePath);
+    record.insert("offset", double(partial.offset));
+    record.insert("size", double(partial.sourceSize));
+    record.insert("modified", double(partial.sourceModified));
+    append(QJsonDocument(record).toJson(QJsonDocument::Compact), true);
+}
+
+void TransferJournal::operationFinished(int index)
+{
+    // Операция отмечается завершенной, только когда все ее файлы на диске
+    flushFinished();
+
+    QJsonObject record;
+    record.insert("operation", index);
+    append(QJsonDocument(record).toJson(QJsonDocument::Compact), true);
+}
+
+void TransferJournal::remove()
+{
+    QMutexLocker locker(&mutex);
+    pendingFinished.clear();
+    if (file.isOpen()) {
+        file.close();
+    }
+    if (!file.fileName().isEmpty()) {
+        QFile::remove(file.fileName());
+    }
+}
+
+void TransferJournal::append(const QByteArray& line, bool sync)
+{
+    // Одна запись - один write(), строки из разных потоков не перемешиваются
+    QMutexLocker locker(&mutex);
+    if (file.isOpen()) {
+        file.write(line + '\n');
+        if (sync) {
+            syncToDisk(file);
+        }
+    }
+}
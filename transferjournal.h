@@ -0,0 +1,90 @@
+#pragma once
+
+#include <QFile>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+// Журнал задания вставки в AppDataLocation/transfers/<id>.journal.
+// Первая строка - план (список операций), записывается при постановке задания
+// в очередь. Дальше по строке JSON на событие: план с решенными конфликтами,
+// файл скопирован, файл скопирован до смещения, операция завершена.
+// Строки дописываются сразу (без буфера процесса) и сбрасываются на диск;
+// данные файла сбрасываются до записи о нем, поэтому и после сбоя питания
+// известно, что уже сделано. Скопированные файлы отмечаются пачками: запись
+// о файле, не дошедшая до диска, не страшна - при продолжении копия сверяется
+// с источником по размеру и времени. Журнал удаляется, когда задание
+// завершено или отменено; оставшиеся журналы - прерванные задания.
+class TransferJournal
+{
+public:
+    // Файл, скопированный до смещения. Размер и время источника нужны, чтобы
+    // не дописывать к старой части файла данные изменившегося источника
+    struct PartialFile {
+        qint64 offset = 0;
+        qint64 sourceSize = -1;
+        qint64 sourceModified = -1;     // мс с начала эпохи
+    };
+
+    struct State {
+        QString jobId;
+        QString title;
+        QJsonArray operations;
+        bool planResolved = false;        // Конфликты решены, operations - решенный план
+        QJsonObject conflictRules;        // Правила для слияния папок; пусто - конфликтов не было
+        QSet<int> finishedOperations;
+        QSet<QString> finishedFiles;      // Пути источников
+        QHash<QString, PartialFile> partialFiles; // Путь источника -> докуда скопирован
+    };
+
+    static QString journalDirectory();
+    // Идентификаторы заданий, журналы которых остались с прошлого запуска
+    static QStringList pendingJobs();
+    static bool load(const QString& jobId, State& state);
+    // Удаление журнала, который нельзя продолжить
+    static void discard(const QString& jobId);
+
+    TransferJournal() = default;
+    ~TransferJournal();
+
+    bool create(const QString& jobId, const QString& title, const QJsonArray& operations);
+    // Продолжение записи в журнал прерванного задания
+    bool reopen(const QString& jobId);
+
+    // План после решения конфликтов заменяет исходный при продолжении;
+    // правила нужны и дальше - по ним решаются файлы внутри сливаемых папок
+    void planResolved(const QJsonArray& operations, const QJsonObject& conflictRules);
+    // Файл скопирован. Данные пачки сбрасываются на диск разом, когда в ней
+    // набралось достаточно файлов или прошло достаточно времени
+    void fileFinished(const QString& sourcePath, const QString& destinationPath);
+    // Отметить накопленные файлы сейчас, не дожидаясь полной пачки
+    void flushFinished();
+    void filePartial(const QString& sourcePath, const PartialFile& partial);
+    void operationFinished(int index);
+
+    // Задание завершено или отменено - журнал больше не нужен
+    void remove();
+
+    bool isOpen() const { return file.isOpen(); }
+
+private:
+    struct FinishedFile {
+        QString sourcePath;
+        QString destinationPath;
+    };
+
+    void append(const QByteArray& line, bool sync = false);
+    void commitFinished(const QList<FinishedFile>& files);
+    static QString journalPath(const QString& jobId);
+
+    QFile file;
+    QMutex mutex;
+    // Скопированные, но еще не отмеченные файлы; под mutex
+    QList<FinishedFile> pendingFinished;
+    QElapsedTimer pendingTimer;
+};
@@ -0,0 +1,124 @@
+#include "transferprogress.h"
+#include "disksizeutils.h"
+#include <QFileInfo>
+
+void TransferProgress::reset(int operationCount)
+{
+    QMutexLocker locker(&mutex);
+    totalBytes = 0;
+    totalFiles = 0;
+    totalsKnown = false;
+    bytesDone = 0;
+    filesDone = 0;
+    operationsDone = 0;
+    operations = operationCount;
+    currentFile.clear();
+    timer.start();
+    lastReportMs = -REPORT_INTERVAL_MS;
+    lastReportBytes = 0;
+    bytesPerSecond = 0;
+}
+
+void TransferProgress::addTotals(qint64 bytes, int files)
+{
+    totalBytes += bytes;
+    totalFiles += files;
+}
+
+void TransferProgress::setTotalsKnown()
+{
+    totalsKnown = true;
+}
+
+void TransferProgress::addBytes(qint64 bytes)
+{
+    bytesDone += bytes;
+}
+
+void TransferProgress::fileFinished()
+{
+    filesDone++;
+}
+
+void TransferProgress::operationFinished()
+{
+    operationsDone++;
+}
+
+void TransferProgress::setCurrentFile(const QString& fileName)
+{
+    QMutexLocker locker(&mutex);
+    currentFile = fileName;
+}
+
+bool TransferProgress::shouldReport(bool force)
+{
+    QMutexLocker locker(&mutex);
+
+    qint64 now = timer.elapsed();
+    qint64 interval = now - lastReportMs;
+    if (!force && interval < REPORT_INTERVAL_MS) {
+        return false;
+    }
+
+    // Скорость за интервал сглаживаем, чтобы ETA не прыгал от файла к файлу
+    qint64 done = bytesDone;
+    if (interval > 0 && lastReportMs >= 0) {
+        double instant = (done - lastReportBytes) * 1000.0 / interval;
+        bytesPerSecond = bytesPerSecond <= 0 ? instant
+                                             : SPEED_SMOOTHING * instant + (1 - SPEED_SMOOTHING) * bytesPerSecond;
+    }
+    lastReportMs = now;
+    lastReportBytes = done;
+    return true;
+}
+
+int TransferProgress::percent() const
+{
+    qint64 total = totalBytes;
+    if (totalsKnown && total > 0) {
+        return int(qBound<qint64>(0, bytesDone * 100 / total, 100));
+    }
+    return operations > 0 ? qMin(100, operationsDone * 100 / operations) : 0;
+}
+
+QString TransferProgress::describe(const QString& action) const
+{
+    QMutexLocker locker(&mutex);
+
+    QString text = action;
+    if (!currentFile.isEmpty()) {
+        text += ": " + QFileInfo(currentFile).fileName();
+    }
+
+    qint64 done = bytesDone;
+    qint64 total = totalBytes;
+    if (done == 0 && (!totalsKnown || total == 0)) {
+        return text;
+    }
+
+    // Не " - ": после него NotificationWidget дописывает процент
+    text += ", " + DiskSizeUtils::formatSize(done);
+    if (totalsKnown) {
+        text += " из " + DiskSizeUtils::formatSize(total);
+    } else {
+        text += ", подсчет...";
+    }
+
+    if (bytesPerSecond > 0) {
+        text += QString(", %1/с").arg(DiskSizeUtils::formatSize(qint64(bytesPerSecond)));
+
+        if (totalsKnown && total > done) {
+            qint64 seconds = qint64((total - done) / bytesPerSecond);
+            text += seconds >= 3600
+                ? QString(", осталось %1:%2:%3").arg(seconds / 3600).arg(seconds / 60 % 60, 2, 10, QChar('0'))
+                      .arg(seconds % 60, 2, 10, QChar('0'))
+                : QString(", осталось %1:%2").arg(seconds / 60).arg(seconds % 60, 2, 10, QChar('0'));
+        }
+    }
+
+    if (totalsKnown && totalFiles > 1) {
+        text += QString(" (%1 из %2 файлов)").arg(int(filesDone)).arg(int(totalFiles));
+    }
+    return text;
+}
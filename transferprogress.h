@@ -0,0 +1,51 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QString>
+#include <atomic>
+
+// Прогресс переноса файлов по байтам. Общий объем считает предварительный
+// обход (параллельно с началом копирования); пока он не закончен, процент
+// считается по числу операций. Скорость сглаживается экспоненциальным
+// средним, отчеты ограничены по частоте. Методы можно вызывать из разных потоков.
+class TransferProgress
+{
+public:
+    void reset(int operationCount);
+
+    // Предварительный обход
+    void addTotals(qint64 bytes, int files);
+    void setTotalsKnown();
+
+    void addBytes(qint64 bytes);
+    void fileFinished();
+    void operationFinished();
+    void setCurrentFile(const QString& fileName);
+
+    // true - пора отправить отчет (не чаще REPORT_INTERVAL_MS, force - сразу)
+    bool shouldReport(bool force = false);
+
+    int percent() const;
+    // "Копирование: файл, 1.2 ГБ из 5.0 ГБ, 85.3 МБ/с, осталось 1:23"
+    QString describe(const QString& action) const;
+
+private:
+    std::atomic<qint64> totalBytes{0};
+    std::atomic<int> totalFiles{0};
+    std::atomic<bool> totalsKnown{false};
+    std::atomic<qint64> bytesDone{0};
+    std::atomic<int> filesDone{0};
+    std::atomic<int> operationsDone{0};
+    int operations = 0;
+
+    mutable QMutex mutex;
+    QString currentFile;
+    QElapsedTimer timer;
+    qint64 lastReportMs = 0;
+    qint64 lastReportBytes = 0;
+    double bytesPerSecond = 0;
+
+    const int REPORT_INTERVAL_MS = 100;
+    const double SPEED_SMOOTHING = 0.3;
+};
@@ -0,0 +1,171 @@
+#include "transferscheduler.h"
+#include "deviceinfo.h"
+#include <QDebug>
+
+TransferScheduler& TransferScheduler::instance()
+{
+    static TransferScheduler instance;
+    return instance;
+}
+
+QSet<QString> TransferScheduler::devicesFor(const QStringList& paths)
+{
+    QSet<QString> devices;
+    for (const QString& path : paths) {
+        QString device = DeviceInfo::deviceId(path);
+        if (!device.isEmpty()) {
+            devices.insert(device);
+        }
+    }
+    return devices;
+}
+
+void TransferScheduler::enqueue(const QString& jobId, const QSet<QString>& devices, const std::function<void()>& start)
+{
+    queue.append({jobId, devices, start});
+    qDebug() << "Transfer job queued:" << jobId << "devices:" << devices.size() << "queue:" << queue.size();
+    schedule();
+    emit queueChanged();
+}
+
+void TransferScheduler::finish(const QString& jobId)
+{
+    if (running.contains(jobId)) {
+        if (!suspended.remove(jobId)) {
+            release(running.value(jobId));
+        }
+        running.remove(jobId);
+        qDebug() << "Transfer job finished:" << jobId;
+        schedule();
+        emit queueChanged();
+    } else {
+        remove(jobId);
+    }
+}
+
+bool TransferScheduler::remove(const QString& jobId)
+{
+    for (int i = 0; i < queue.size(); ++i) {
+        if (queue[i].id == jobId) {
+            queue.removeAt(i);
+            // Снятое задание могло придерживать тома для следующих
+            schedule();
+            emit queueChanged();
+            return true;
+        }
+    }
+    return false;
+}
+
+void TransferScheduler::prioritize(const QString& jobId)
+{
+    move(jobId, 0);
+}
+
+void TransferScheduler::move(const QString& jobId, int position)
+{
+    for (int i = 0; i < queue.size(); ++i) {
+        if (queue[i].id == jobId) {
+            queue.move(i, qBound(0, position, queue.size() - 1));
+            schedule();
+            emit queueChanged();
+            return;
+        }
+    }
+}
+
+void TransferScheduler::setSuspended(const QString& jobId, bool suspend)
+{
+    if (!running.contains(jobId) || suspended.contains(jobId) == suspend) {
+        return;
+    }
+
+    if (suspend) {
+        suspended.insert(jobId);
+        release(running.value(jobId));
+        schedule();
+        emit queueChanged();
+    } else {
+        // Продолжение по команде пользователя не ждет очереди, даже если
+        // тома уже заняты запущенными за время паузы заданиями
+        suspended.remove(jobId);
+        acquire(running.value(jobId));
+    }
+}
+
+bool TransferScheduler::isQueued(const QString& jobId) const
+{
+    return queuePosition(jobId) > 0;
+}
+
+int TransferScheduler::queuePosition(const QString& jobId) const
+{
+    for (int i = 0; i < queue.size(); ++i) {
+        if (queue[i].id == jobId) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+QStringList TransferScheduler::queuedJobs() const
+{
+    QStringList jobs;
+    for (const Job& job : queue) {
+        jobs.append(job.id);
+    }
+    return jobs;
+}
+
+bool TransferScheduler::devicesFree(const QSet<QString>& devices) const
+{
+    for (const QString& device : devices) {
+        if (busyDevices.value(device) > 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TransferScheduler::acquire(const QSet<QString>& devices)
+{
+    for (const QString& device : devices) {
+        busyDevices[device]++;
+    }
+}
+
+void TransferScheduler::release(const QSet<QString>& devices)
+{
+    for (const QString& device : devices) {
+        if (--busyDevices[device] <= 0) {
+            busyDevices.remove(device);
+        }
+    }
+}
+
+void TransferScheduler::schedule()
+{
+    // Задание, которое ждет, придерживает свои тома: иначе поток мелких
+    // заданий на один из них откладывал бы его бесконечно
+    QSet<QString> reserved;
+    QList<Job> ready;
+
+    for (int i = 0; i < queue.size();) {
+        const Job& job = queue[i];
+        if (devicesFree(job.devices) && !job.devices.intersects(reserved)) {
+            acquire(job.devices);
+            running.insert(job.id, job.devices);
+            ready.append(queue.takeAt(i));
+            continue;
+        }
+        reserved.unite(job.devices);
+        ++i;
+    }
+
+    // Запускаем после обновления очереди: start может сам обратиться к планировщику
+    for (const Job& job : std::as_const(ready)) {
+        qDebug() << "Transfer job started:" << job.id;
+        emit jobStarted(job.id);
+        job.start();
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+// Общая очередь заданий переноса. Задание занимает тома источника и
+// назначения; задания на свободных томах идут параллельно, а задания,
+// делящие хотя бы один том, - по очереди: три вставки на одну флешку
+// подряд быстрее, чем одновременно. Приостановленное задание тома
+// освобождает. Работает в потоке интерфейса.
+class TransferScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    static TransferScheduler& instance();
+
+    // Тома, которые занимает перенос между путями (пустые идентификаторы отбрасываются)
+    static QSet<QString> devicesFor(const QStringList& paths);
+
+    // start вызывается, когда все тома задания свободны (возможно, сразу)
+    void enqueue(const QString& jobId, const QSet<QString>& devices, const std::function<void()>& start);
+    // Задание завершено - его тома освобождаются
+    void finish(const QString& jobId);
+    // Убрать задание из очереди, пока оно не запущено; false - уже запущено
+    bool remove(const QString& jobId);
+
+    // Порядок очереди
+    void prioritize(const QString& jobId);
+    void move(const QString& jobId, int position);
+
+    // Пауза запущенного задания: пока оно стоит, его тома отдаются очереди
+    void setSuspended(const QString& jobId, bool suspended);
+
+    bool isQueued(const QString& jobId) const;
+    // Место в очереди, начиная с 1; 0 - не в очереди
+    int queuePosition(const QString& jobId) const;
+    QStringList queuedJobs() const;
+
+signals:
+    void jobStarted(const QString& jobId);
+    // Очередь изменилась - места ожидающих заданий могли сдвинуться
+    void queueChanged();
+
+private:
+    TransferScheduler() = default;
+
+    struct Job {
+        QString id;
+        QSet<QString> devices;
+        std::function<void()> start;
+    };
+
+    bool devicesFree(const QSet<QString>& devices) const;
+    void acquire(const QSet<QString>& devices);
+    void release(const QSet<QString>& devices);
+    // Запуск всех заданий из очереди, тома которых свободны
+    void schedule();
+
+    QList<Job> queue;
+    QHash<QString, QSet<QString>> running;   // Задание -> занятые тома
+    QSet<QString> suspended;
+    QHash<QString, int> busyDevices;         // Том -> число заданий на нем
+};